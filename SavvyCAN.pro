@@ -6,7 +6,7 @@
 
 QT       += core gui serialbus
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets serialport printsupport qml
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets serialport printsupport qml concurrent
 
 CONFIG(release, debug|release):DEFINES += QT_NO_DEBUG_OUTPUT
 
@@ -20,6 +20,13 @@ TEMPLATE = app
 SOURCES += main.cpp\
     mainwindow.cpp \
     canframemodel.cpp \
+    canframestore.cpp \
+    canframetimeindex.cpp \
+    mappedfileallocator.cpp \
+    canidfilter.cpp \
+    canidcatalog.cpp \
+    canframequery.cpp \
+    framedatadelegate.cpp \
     utility.cpp \
     qcustomplot.cpp \
     frameplaybackwindow.cpp \
@@ -37,7 +44,9 @@ SOURCES += main.cpp\
     connections/serialbusconnection.cpp \
     connections/canconfactory.cpp \
     connections/gvretserial.cpp \
+    connections/simulatedconnection.cpp \
     connections/canconmanager.cpp \
+    connections/canconingest.cpp \
     re/sniffer/snifferitem.cpp \
     re/sniffer/sniffermodel.cpp \
     re/sniffer/snifferwindow.cpp \
@@ -69,6 +78,13 @@ SOURCES += main.cpp\
 HEADERS  += mainwindow.h \
     can_structs.h \
     canframemodel.h \
+    canframestore.h \
+    canframetimeindex.h \
+    mappedfileallocator.h \
+    canidfilter.h \
+    canidcatalog.h \
+    canframequery.h \
+    framedatadelegate.h \
     utility.h \
     qcustomplot.h \
     frameplaybackwindow.h \
@@ -88,7 +104,9 @@ HEADERS  += mainwindow.h \
     connections/serialbusconnection.h \
     connections/canconfactory.h \
     connections/gvretserial.h \
+    connections/simulatedconnection.h \
     connections/canconmanager.h \
+    connections/canconingest.h \
     re/sniffer/snifferitem.h \
     re/sniffer/sniffermodel.h \
     re/sniffer/snifferwindow.h \
@@ -153,3 +171,8 @@ RESOURCES += \
 win32 {
    LIBS += opengl32.lib
 }
+
+linux {
+   SOURCES += connections/socketcan.cpp
+   HEADERS += connections/socketcan.h
+}
@@ -7,13 +7,14 @@
 #include <QDebug>
 #include <algorithm>
 
-BisectWindow::BisectWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+BisectWindow::BisectWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::BisectWindow)
 {
     ui->setupUi(this);
 
     modelFrames = frames;
+    knownIds = 0;
 
     connect(MainWindow::getReference(), SIGNAL(framesUpdated(int)), this, SLOT(updatedFrames(int)));
     connect(ui->btnCalculate, &QAbstractButton::clicked, this, &BisectWindow::handleCalculateButton);
@@ -41,22 +42,27 @@ void BisectWindow::showEvent(QShowEvent* event)
 
 void BisectWindow::refreshIDList()
 {
-    int id;
-    for (int i = 0; i < modelFrames->count(); i++)
-    {
-        id = modelFrames->at(i).ID;
-        if (!foundID.contains(id))
-        {
-            foundID.append(id);
-        }
-    }
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
 
+    //the lists are rebuilt, keep what was picked
+    QString lower = ui->cbIDLower->currentText();
+    QString upper = ui->cbIDUpper->currentText();
+
+    foundID.clear();
+    foreach (quint32 id, ids) foundID.append(id);
     std::sort(foundID.begin(), foundID.end());
 
+    ui->cbIDLower->clear();
+    ui->cbIDUpper->clear();
     foreach (int id, foundID) {
         ui->cbIDLower->addItem(Utility::formatNumber(id));
         ui->cbIDUpper->addItem(Utility::formatNumber(id));
     }
+
+    if (!lower.isEmpty()) ui->cbIDLower->setCurrentText(lower);
+    if (!upper.isEmpty()) ui->cbIDUpper->setCurrentText(upper);
 }
 
 void BisectWindow::refreshFrameNumbers()
@@ -79,7 +85,10 @@ void BisectWindow::updatedFrames(int numFrames)
     }
     else //just got some new frames. See if they are relevant.
     {
-
+        refreshFrameNumbers();
+        //only redo the ID lists when the catalog got a new ID
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        if (model->getIdCatalog()->count() != knownIds) refreshIDList();
     }
 }
 
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include "can_structs.h"
+#include "canframestore.h"
 
 namespace Ui {
 class BisectWindow;
@@ -13,7 +14,7 @@ class BisectWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit BisectWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit BisectWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~BisectWindow();
     void showEvent(QShowEvent*);
 
@@ -33,8 +34,9 @@ private slots:
 
 private:
     Ui::BisectWindow *ui;
-    const QVector<CANFrame> *modelFrames;
-    QVector<CANFrame> splitFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
+    CANFrameStore splitFrames;
     QList<int> foundID;
 
     void refreshIDList();
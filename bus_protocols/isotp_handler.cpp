@@ -119,9 +119,8 @@ void ISOTP_HANDLER::updatedFrames(int numFrames)
     }
 }
 
-void ISOTP_HANDLER::rapidFrames(const CANConnection* conn, const QVector<CANFrame>& pFrames)
+void ISOTP_HANDLER::rapidFrames(const QVector<CANFrame>& pFrames)
 {
-    Q_UNUSED(conn)
     if (pFrames.length() <= 0) return;
 
     qDebug() << "received messages in ISOTP handler";
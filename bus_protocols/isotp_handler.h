@@ -29,7 +29,7 @@ public:
 
 public slots:
     void updatedFrames(int);
-    void rapidFrames(const CANConnection* conn, const QVector<CANFrame>& pFrames);
+    void rapidFrames(const QVector<CANFrame>& pFrames);
     void frameTimerTick();
 
 signals:
@@ -39,7 +39,7 @@ private:
     QList<ISOTP_MESSAGE> messageBuffer;
     QList<CANFrame> sendingFrames;
     QList<CANFilter> filters;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     bool useExtendedAddressing;
     bool isReceiving;
     bool waitingForFlow;
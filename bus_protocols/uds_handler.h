@@ -111,7 +111,7 @@ signals:
 
 private:
     QList<ISOTP_MESSAGE> messageBuffer;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     bool isReceiving;
     bool useExtendedAddressing;
 
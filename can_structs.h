@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QVector>
 #include <stdint.h>
+#include <string.h>
 
 struct CANFrame
 {
@@ -17,6 +18,85 @@ public:
     uint64_t timestamp;
 };
 
+/*
+ * Packed form of a CANFrame, this is what captures are stored as.
+ * 24 bytes instead of 40, frames are converted back to CANFrame when they are handed out.
+ */
+struct CANFrameRecord
+{
+public:
+    uint64_t timestamp;
+    uint32_t ID;
+    uint8_t  len        : 4;
+    uint8_t  extended   : 1;
+    uint8_t  isReceived : 1;
+    uint8_t  bus;
+    unsigned char data[8];
+
+    static CANFrameRecord fromFrame(const CANFrame& pFrame)
+    {
+        CANFrameRecord rec;
+        rec.timestamp   = pFrame.timestamp;
+        rec.ID          = pFrame.ID;
+        rec.len         = (pFrame.len > 8) ? 8 : pFrame.len;
+        rec.extended    = pFrame.extended;
+        rec.isReceived  = pFrame.isReceived;
+        rec.bus         = pFrame.bus;
+        memcpy(rec.data, pFrame.data, 8);
+        return rec;
+    }
+
+    CANFrame toFrame() const
+    {
+        CANFrame frame;
+        frame.timestamp  = timestamp;
+        frame.ID         = ID;
+        frame.len        = len;
+        frame.extended   = extended;
+        frame.isReceived = isReceived;
+        frame.bus        = bus;
+        memcpy(frame.data, data, 8);
+        return frame;
+    }
+};
+
+Q_STATIC_ASSERT(sizeof(CANFrameRecord) <= 24);
+
+/*
+ * Read only sequence of frames, this is how the capture is handed to windows and file savers.
+ * Frames are returned by value, they are not necessarily stored as CANFrame.
+ */
+class CANFrameList
+{
+public:
+    virtual ~CANFrameList() {}
+
+    virtual int count() const = 0;
+    virtual CANFrame at(int pIdx) const = 0;
+
+    int length() const { return count(); }
+    int size() const { return count(); }
+    bool isEmpty() const { return count() == 0; }
+    CANFrame first() const { return at(0); }
+    CANFrame last() const { return at(count() - 1); }
+
+    QVector<CANFrame> toVector() const
+    {
+        QVector<CANFrame> frames;
+        frames.reserve(count());
+        for (int i = 0; i < count(); i++) frames.append(at(i));
+        return frames;
+    }
+};
+
+/* a receive filter: a frame matches if (frame.ID & mask) == (id & mask) */
+class CANFlt
+{
+public:
+    quint32 id;
+    quint32 mask;
+};
+
 class CANFltObserver
 {
 public:
@@ -4,13 +4,116 @@
 #include <QApplication>
 #include <QPalette>
 #include <QDateTime>
+#include <QSharedPointer>
+#include <QtConcurrent/QtConcurrentMap>
 #include "utility.h"
 
+//below this many frames a filter refresh is quick enough to stay on the GUI thread
+#define PARALLEL_REFRESH_MIN    200000
+//rows kept formatted, a few screens worth
+#define RENDER_CACHE_ROWS       1024
+
+/* run of contiguous records checked by one task of a parallel refresh */
+struct FilterChunk
+{
+    const CANFrameRecord* records;
+    int first; //index in frames of records[0]
+    int count;
+};
+
+/* map step of the parallel refresh, runs on the global thread pool against a copy of the filters and query */
+class FilterChunkJob
+{
+public:
+    typedef CANFilterResult result_type;
+
+    FilterChunkJob(QSharedPointer<const CANIdFilter> pFilter, QSharedPointer<const CANFrameQuery> pQuery) :
+        mFilter(pFilter), mQuery(pQuery) {}
+
+    CANFilterResult operator()(const FilterChunk& pChunk) const
+    {
+        CANFilterResult result;
+        if (mQuery->isEmpty())
+        {
+            for (int i = 0; i < pChunk.count; i++)
+            {
+                quint32 id = pChunk.records[i].ID;
+                if (mFilter->isShown(id)) result.rows.append(pChunk.first + i);
+                else if (!mFilter->contains(id)) result.unknownIds.insert(id);
+            }
+            return result;
+        }
+
+        //the query goes through every frame, then the filters keep the rows of the IDs shown
+        QVector<quint32> matches;
+        result.records = pChunk.records;
+        result.first = pChunk.first;
+        result.query = mQuery;
+        result.filter = mFilter;
+        mQuery->filter(pChunk.records, pChunk.count, pChunk.first, &result.last, &matches,
+                       mQuery->usesHistory() ? &result.pending : NULL);
+        for (int i = 0; i < matches.count(); i++)
+        {
+            if (mFilter->isShown(pChunk.records[matches.at(i) - pChunk.first].ID)) result.rows.append(matches.at(i));
+        }
+        for (int i = 0; i < pChunk.count; i++)
+        {
+            if (!mFilter->contains(pChunk.records[i].ID)) result.unknownIds.insert(pChunk.records[i].ID);
+        }
+        return result;
+    }
+
+private:
+    QSharedPointer<const CANIdFilter> mFilter;
+    QSharedPointer<const CANFrameQuery> mQuery;
+};
+
+/* reduce step, called in chunk order */
+static void reduceFilterChunk(CANFilterResult& pTotal, const CANFilterResult& pChunk)
+{
+    pTotal.unknownIds += pChunk.unknownIds;
+    if (pChunk.pending.isEmpty() && pChunk.last.isEmpty())
+    {
+        pTotal.rows += pChunk.rows;
+        return;
+    }
+
+    //first frames of each ID in the chunk, against the last frames of the chunks before
+    QVector<quint32> resolved;
+    for (int i = 0; i < pChunk.pending.count(); i++)
+    {
+        const CANFrameRecord& rec = pChunk.records[pChunk.pending.at(i) - pChunk.first];
+        QHash<quint32, CANFrameRecord>::const_iterator it = pTotal.last.constFind(rec.ID);
+        if (pChunk.filter->isShown(rec.ID) && pChunk.query->matches(rec, (it == pTotal.last.constEnd()) ? NULL : &it.value()))
+            resolved.append(pChunk.pending.at(i));
+    }
+
+    //both lists are in order
+    int r = 0;
+    for (int i = 0; i < pChunk.rows.count(); i++)
+    {
+        while (r < resolved.count() && resolved.at(r) < pChunk.rows.at(i)) pTotal.rows.append(resolved.at(r++));
+        pTotal.rows.append(pChunk.rows.at(i));
+    }
+    while (r < resolved.count()) pTotal.rows.append(resolved.at(r++));
+
+    for (QHash<quint32, CANFrameRecord>::const_iterator it = pChunk.last.constBegin(); it != pChunk.last.constEnd(); ++it)
+    {
+        pTotal.last.insert(it.key(), it.value());
+    }
+}
+
+/* moves pPos_p along the sorted matches of a query, true if pIdx is one of them */
+static bool isMatch(const QVector<quint32>& pMatches, int* pPos_p, int pIdx)
+{
+    while (*pPos_p < pMatches.count() && pMatches.at(*pPos_p) < (quint32) pIdx) (*pPos_p)++;
+    return *pPos_p < pMatches.count() && pMatches.at(*pPos_p) == (quint32) pIdx;
+}
+
 
 CANFrameModel::~CANFrameModel()
 {
-    frames.clear();
-    filteredFrames.clear();
+    cancelFilterRefresh();
     filters.clear();
 }
 
@@ -18,16 +121,7 @@ CANFrameModel::~CANFrameModel()
 int CANFrameModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    if (filteredFrames.data())
-    {
-        int rows = filteredFrames.count();
-        return rows;
-    }
-
-     //just in case somehow data is invalid which I have seen before.
-    //But, this should not happen so issue a debugging message too
-    qDebug() << "Invalid data for filteredFrames. Returning 0.";
-    return 0;
+    return visibleRows;
 }
 
 int CANFrameModel::totalFrameCount()
@@ -44,31 +138,28 @@ int CANFrameModel::columnCount(const QModelIndex &index) const
 }
 
 CANFrameModel::CANFrameModel(QObject *parent)
-    : QAbstractTableModel(parent)
+    : QAbstractTableModel(parent),
+      filteredFrames(&frames),
+      timeIndex(&frames)
 {
-
-    if (QSysInfo::WordSize > 32)
-    {
-        qDebug() << "64 bit OS detected. Requesting a large preallocation";
-        preallocSize = 10000000;
-    }
-    else //if compiling for 32 bit you can't ask for gigabytes of preallocation so tone it down.
-    {
-        qDebug() << "32 bit OS detected. Requesting a much restricted prealloc";
-        preallocSize = 2000000;
-    }
-
-    frames.reserve(preallocSize);
-    filteredFrames.reserve(preallocSize); //the goal is to prevent a reallocation from ever happening
-
+    //frames and filteredFrames grow by blocks as frames come in, nothing to preallocate
     dbcHandler = DBCHandler::getReference();
     interpretFrames = false;
     overwriteDups = false;
     useHexMode = true;
     timeSeconds = false;
-    timeOffset = 0;
     needFilterRefresh = false;
     lastUpdateNumFrames = 0;
+    maxFrames = 0;
+    maxSpan = 0;
+    filterRefreshRunning = false;
+    visibleRows = 0;
+    removedRows = 0;
+    connect(&filterWatcher, &QFutureWatcher<CANFilterResult>::finished, this, &CANFrameModel::filterRefreshFinished);
+    connect(dbcHandler, &DBCHandler::filesChanged, this, &CANFrameModel::dbcFilesChanged);
+    renderCache.setMaxCost(RENDER_CACHE_ROWS);
+    //every setting shown in the table resets the model, so does any rebuild of the rows
+    connect(this, &QAbstractItemModel::modelAboutToBeReset, this, &CANFrameModel::clearRenderCache);
     timeFormat =  "MMM-dd HH:mm:ss.zzz";
 }
 
@@ -122,46 +213,141 @@ void CANFrameModel::setTimeFormat(QString format)
     endResetModel();
 }
 
+//the stored timestamps are left alone, the offset is applied as frames are read
 void CANFrameModel::normalizeTiming()
 {
     mutex.lock();
-    if (frames.count() == 0) return;
-    timeOffset = frames[0].timestamp;
-    for (int i = 0; i < frames.count(); i++)
+    if (frames.count() > 0)
     {
-        frames[i].timestamp -= timeOffset;
+        frames.setTimeOffset(frames.record(0).timestamp);
+        query.setTimeOffset(frames.timeOffset());
+        this->beginResetModel();
+        this->endResetModel();
     }
-    this->beginResetModel();
-    for (int i = 0; i < filteredFrames.count(); i++)
+    mutex.unlock();
+    //times typed in the query are the ones shown
+    if (query.usesTime()) sendRefresh();
+}
+
+void CANFrameModel::restoreTiming()
+{
+    mutex.lock();
+    if (frames.timeOffset() != 0)
     {
-        filteredFrames[i].timestamp -= timeOffset;
+        frames.setTimeOffset(0);
+        query.setTimeOffset(0);
+        this->beginResetModel();
+        this->endResetModel();
     }
-    this->endResetModel();
     mutex.unlock();
+    if (query.usesTime()) sendRefresh();
+}
+
+bool CANFrameModel::isTimingNormalized() const
+{
+    return frames.timeOffset() != 0;
 }
 
 void CANFrameModel::setOverwriteMode(bool mode)
 {
+    cancelFilterRefresh();
+    mutex.lock();
     beginResetModel();
     overwriteDups = mode;
+    overwriteRows.clear();
+    //frames get overwritten in place in overwrite mode, the time index can't follow
+    if (overwriteDups) timeIndex.clear();
+    else timeIndex.rebuild();
+    if (overwriteDups)
+    {
+        //new frames overwrite the first one received with the same ID
+        for (int i = 0; i < frames.count(); i++)
+        {
+            if (!overwriteRows.contains(frames.record(i).ID)) overwriteRows.insert(frames.record(i).ID, i);
+        }
+    }
+    syncRows();
     endResetModel();
+    mutex.unlock();
 }
 
 void CANFrameModel::setFilterState(unsigned int ID, bool state)
 {
     if (!filters.contains(ID)) return;
-    filters[ID] = state;
+    filters.insert(ID, state);
     sendRefresh();
 }
 
 void CANFrameModel::setAllFilters(bool state)
 {
-    QMap<int, bool>::iterator it;
-    for (it = filters.begin(); it != filters.end(); ++it)
+    filters.setAll(state);
+    sendRefresh();
+}
+
+bool CANFrameModel::setQuery(QString text, QString *error)
+{
+    cancelFilterRefresh();
+    mutex.lock();
+    bool ok = query.compile(text, dbcHandler, error);
+    mutex.unlock();
+    if (ok) sendRefresh();
+    return ok;
+}
+
+QString CANFrameModel::getQuery() const
+{
+    return query.text();
+}
+
+//signals of the query are looked up again before any other frame goes through it
+void CANFrameModel::dbcFilesChanged()
+{
+    //decoded rows take their text and colors from the DBC files, format them again
+    if (interpretFrames)
     {
-        it.value() = state;
+        renderCache.clear();
+        if (rowCount() > 0) emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount(QModelIndex()) - 1));
     }
+
+    if (query.isEmpty()) return;
+
+    QString error;
+    cancelFilterRefresh();
+    mutex.lock();
+    bool ok = query.compile(query.text(), dbcHandler, &error);
+    if (!ok) query.clear();
+    mutex.unlock();
     sendRefresh();
+    if (!ok) emit queryFailed(error);
+}
+
+//for frames that come one at a time, in order, keeps the history of the query up to date
+bool CANFrameModel::queryAccepts(const CANFrameRecord &rec)
+{
+    if (query.isEmpty()) return true;
+    if (!query.usesHistory()) return query.matches(rec, NULL);
+
+    QHash<quint32, CANFrameRecord>::iterator it = queryHistory.find(rec.ID);
+    if (it == queryHistory.end())
+    {
+        queryHistory.insert(rec.ID, rec);
+        return query.matches(rec, NULL);
+    }
+    bool match = query.matches(rec, &it.value());
+    it.value() = rec;
+    return match;
+}
+
+//runs the query from frame first to the end of the capture, a block of the store at a time
+void CANFrameModel::runQuery(int first, QVector<quint32> *rows)
+{
+    int count = frames.count();
+    int len;
+    for (int i = first; i < count; i += len)
+    {
+        const CANFrameRecord *recs = frames.contiguous(i, &len);
+        query.filter(recs, len, i, &queryHistory, rows, NULL);
+    }
 }
 
 void CANFrameModel::recalcOverwrite()
@@ -170,150 +356,147 @@ void CANFrameModel::recalcOverwrite()
 
     qDebug() << "recalcOverwrite called in model";
 
-    int lastUnique = 0;
-    bool found;
+    int numUnique = 0;
 
+    cancelFilterRefresh();
     mutex.lock();
     beginResetModel();
-    for (int i = 1; i < frames.count(); i++)
+    overwriteRows.clear();
+    //each ID keeps the place of its first frame and the content of its last one
+    for (int i = 0; i < frames.count(); i++)
     {
-        found = false;
-        for (int j = 0; j <= lastUnique; j++)
+        QHash<quint32, int>::const_iterator it = overwriteRows.constFind(frames.record(i).ID);
+        if (it != overwriteRows.constEnd())
         {
-            if (frames[i].ID == frames[j].ID)
-            {
-                frames.replace(j, frames[i]);
-                found = true;
-                break;
-            }
+            frames.replace(it.value(), frames.record(i));
         }
-        if (!found)
+        else
         {
-            lastUnique++;
-            frames.replace(lastUnique, frames[i]);
+            if (numUnique != i) frames.replace(numUnique, frames.record(i));
+            overwriteRows.insert(frames.record(numUnique).ID, numUnique);
+            numUnique++;
         }
     }
 
-    while (frames.count() > lastUnique) frames.removeLast();
+    while (frames.count() > numUnique) frames.removeLast();
+    frames.squeeze();
 
     filteredFrames.clear();
-    filteredFrames.reserve(preallocSize);
+    queryHistory.clear();
 
     for (int i = 0; i < frames.count(); i++)
     {
-        if (filters[frames[i].ID])
+        bool match = queryAccepts(frames.record(i));
+        if (filters.check(frames.record(i).ID, false) && match)
         {
-            filteredFrames.append(frames[i]);
+            filteredFrames.append(i);
         }
     }
 
+    syncRows();
     endResetModel();
     mutex.unlock();
 }
 
 QVariant CANFrameModel::data(const QModelIndex &index, int role) const
 {
-    int dLen;
-    QString tempString;
-    CANFrame thisFrame;
-
     if (!index.isValid())
         return QVariant();
 
-    if (index.row() >= (filteredFrames.count()))
+    //rows evicted since the last bulk refresh are still at the top of the view
+    int row = index.row() - removedRows;
+    if (row < 0 || row >= filteredFrames.count())
         return QVariant();
 
-    thisFrame = filteredFrames.at(index.row());
-
-    if (role == Qt::BackgroundColorRole)
+    if (role == Qt::BackgroundColorRole) return renderRow(row)->background;
+    if (role == Qt::TextColorRole) return renderRow(row)->foreground;
+    if (role == Qt::DisplayRole)
     {
-        if (dbcHandler != NULL && interpretFrames)
-        {
-            DBC_MESSAGE *msg = dbcHandler->findMessage(thisFrame);
-            if (msg != NULL)
-            {
-                return msg->bgColor;
-            }
-        }
-        //return QApplication::palette().color(QPalette::Button);
-        return QColor(Qt::white);
+        if (index.column() < 0 || index.column() >= 7) return QVariant();
+        return renderRow(row)->text[index.column()];
+    }
+    if (role == BytesRole && index.column() == 6)
+    {
+        const CANRenderedRow *rendered = renderRow(row);
+        if (rendered->bytes.isNull()) return QVariant();
+        return rendered->bytes;
     }
 
-    if (role == Qt::TextColorRole)
+    return QVariant();
+}
+
+/*
+ * Text and colors of a row, formatted the first time the row is asked for and then served
+ * from an LRU cache holding a few screens of rows. Every paint asks for the colors and
+ * the text of each cell, filling the row at once does a single DBC lookup for all of them.
+ * Entries are keyed on the place of the frame in the capture, they stay valid when rows
+ * are added or evicted and are dropped whenever the model is reset or the DBC files change.
+ */
+const CANRenderedRow *CANFrameModel::renderRow(int row) const
+{
+    quint32 key = (quint32) (filteredFrames.sourceIndex(row) + frames.evictedCount());
+    CANRenderedRow *rendered = renderCache.object(key);
+    if (rendered) return rendered;
+
+    CANFrame thisFrame = filteredFrames.at(row);
+    DBC_MESSAGE *msg = NULL;
+    if (dbcHandler != NULL && interpretFrames) msg = dbcHandler->findMessage(thisFrame);
+
+    rendered = new CANRenderedRow;
+    if (msg != NULL)
     {
-        if (dbcHandler != NULL && interpretFrames)
-        {
-            DBC_MESSAGE *msg = dbcHandler->findMessage(thisFrame);
-            if (msg != NULL)
-            {
-                return msg->fgColor;
-            }
-        }
-        return QApplication::palette().color(QPalette::WindowText);
+        rendered->background = msg->bgColor;
+        rendered->foreground = msg->fgColor;
+    }
+    else
+    {
+        //rendered->background = QApplication::palette().color(QPalette::Button);
+        rendered->background = QColor(Qt::white);
+        rendered->foreground = QApplication::palette().color(QPalette::WindowText);
     }
 
-    if (role == Qt::DisplayRole) {
-        switch (index.column())
+    if (!useSystemTime) {
+        if (!timeSeconds) rendered->text[0] = QString::number(thisFrame.timestamp);
+        else rendered->text[0] = QString::number((double)thisFrame.timestamp / 1000000.0, 'f', 6);
+    }
+    else rendered->text[0] = QDateTime::fromMSecsSinceEpoch(thisFrame.timestamp / 1000).toString(timeFormat);
+    rendered->text[1] = Utility::formatNumber(thisFrame.ID);
+    rendered->text[2] = QString::number(thisFrame.extended);
+    if (thisFrame.isReceived) rendered->text[3] = QString(tr("Rx"));
+    else rendered->text[3] = QString(tr("Tx"));
+    rendered->text[4] = QString::number(thisFrame.bus);
+    rendered->text[5] = QString::number(thisFrame.len);
+
+    int dLen = thisFrame.len;
+    if (dLen < 0) dLen = 0;
+    if (dLen > 8) dLen = 8;
+    rendered->text[6] = Utility::formatBytes(thisFrame.data, dLen);
+    //now, if we're supposed to interpret the data and the DBC handler is loaded then use it
+    if (msg != NULL)
+    {
+        QString &tempString = rendered->text[6];
+        tempString.append("\n");
+        tempString.append(msg->name + "\n" + msg->comment + "\n");
+        for (int j = 0; j < msg->sigHandler->getCount(); j++)
         {
-        case 0: //timestamp
-            if (!useSystemTime) {
-                if (!timeSeconds) return QString::number(thisFrame.timestamp);
-                else return QString::number((double)thisFrame.timestamp / 1000000.0, 'f', 6);
-            }
-            else return QDateTime::fromMSecsSinceEpoch(thisFrame.timestamp / 1000).toString(timeFormat);
-            break;
-        case 1: //id
-            return Utility::formatNumber(thisFrame.ID);
-            break;
-        case 2: //ext
-            return QString::number(thisFrame.extended);
-            break;
-        case 3: //direction
-            if (thisFrame.isReceived) return QString(tr("Rx"));
-            else return QString(tr("Tx"));
-            break;
-        case 4: //bus
-            return QString::number(thisFrame.bus);
-            break;
-        case 5: //len
-            return QString::number(thisFrame.len);
-            break;
-        case 6: //data
-            dLen = thisFrame.len;
-            if (dLen < 0) dLen = 0;
-            if (dLen > 8) dLen = 8;
-            for (int i = 0; i < dLen; i++)
+            QString sigString;
+            if (msg->sigHandler->findSignalByIdx(j)->processAsText(thisFrame, sigString))
             {
-                tempString.append(Utility::formatNumber(thisFrame.data[i]));
-                tempString.append(" ");
+                tempString.append(sigString);
+                tempString.append("\n");
             }
-            //now, if we're supposed to interpret the data and the DBC handler is loaded then use it
-            if (dbcHandler != NULL && interpretFrames)
-            {
-                DBC_MESSAGE *msg = dbcHandler->findMessage(thisFrame);
-                if (msg != NULL)
-                {
-                    tempString.append("\n");
-                    tempString.append(msg->name + "\n" + msg->comment + "\n");
-                    for (int j = 0; j < msg->sigHandler->getCount(); j++)
-                    {
-                        QString sigString;
-                        if (msg->sigHandler->findSignalByIdx(j)->processAsText(thisFrame, sigString))
-                        {
-                            tempString.append(sigString);
-                            tempString.append("\n");
-                        }
-                    }
-                }
-            }
-            return tempString;
-            break;
-        default:
-            return QVariant();
         }
     }
+    //plain payload, FrameDataDelegate paints it straight from the bytes
+    else rendered->bytes = QByteArray((const char *) thisFrame.data, dLen);
 
-    return QVariant();
+    renderCache.insert(key, rendered);
+    return rendered;
+}
+
+void CANFrameModel::clearRenderCache()
+{
+    renderCache.clear();
 }
 
 QVariant CANFrameModel::headerData(int section, Qt::Orientation orientation,
@@ -363,58 +546,51 @@ void CANFrameModel::addFrame(const CANFrame& frame, bool autoRefresh = false)
     mutex.lock();
     CANFrame tempFrame;
     tempFrame = frame;
-    tempFrame.timestamp -= timeOffset;
 
     lastUpdateNumFrames++;
 
     //if this ID isn't found in the filters list then add it and show it by default
-    if (!filters.contains(tempFrame.ID))
-    {
-        filters.insert(tempFrame.ID, true);
-        needFilterRefresh = true;
-    }
+    bool added;
+    bool shown = filters.check(tempFrame.ID, true, &added);
+    if (added) needFilterRefresh = true;
+
+    CANFrameRecord rec = CANFrameRecord::fromFrame(tempFrame);
+    idCatalog.add(rec);
+    //a replaced frame keeps its row, the query only decides for new rows
+    if (!queryAccepts(rec)) shown = false;
 
     if (!overwriteDups)
     {
-        frames.append(tempFrame);
-        if (filters[tempFrame.ID])
-        {
-            if (autoRefresh) beginInsertRows(QModelIndex(), filteredFrames.count() + 1, filteredFrames.count() + 1);
-            filteredFrames.append(tempFrame);
-            if (autoRefresh) endInsertRows();
-        }
+        frames.append(rec);
+        timeIndex.append(frames.count() - 1);
+        if (shown) filteredFrames.append(frames.count() - 1);
+        evictFrames(framesToEvict());
+        if (autoRefresh) publishRows();
     }
     else //yes, overwrite dups
     {
-        bool found = false;
-        for (int i = 0; i < frames.count(); i++)
+        QHash<quint32, int>::const_iterator it = overwriteRows.constFind(tempFrame.ID);
+        if (it == overwriteRows.constEnd())
         {
-            if (frames[i].ID == tempFrame.ID)
-            {
-                frames.replace(i, tempFrame);
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            frames.append(tempFrame);
-            if (filters[tempFrame.ID])
-            {
-                if (autoRefresh) beginInsertRows(QModelIndex(), filteredFrames.count() + 1, filteredFrames.count() + 1);
-                filteredFrames.append(tempFrame);
-                if (autoRefresh) endInsertRows();
-            }
+            frames.append(rec);
+            overwriteRows.insert(tempFrame.ID, frames.count() - 1);
+            if (shown) filteredFrames.append(frames.count() - 1);
+            if (autoRefresh) publishRows();
         }
         else
         {
-            for (int j = 0; j < filteredFrames.count(); j++)
+            //the catalog counts the frames held, the replaced one goes
+            idCatalog.remove(frames.record(it.value()));
+            frames.replace(it.value(), rec);
+            renderCache.remove((quint32) (it.value() + frames.evictedCount()));
+            //the filtered view points at the replaced frame already, only its row has to be repainted
+            if (autoRefresh && shown)
             {
-                if (filteredFrames[j].ID == tempFrame.ID)
+                int row = filteredFrames.rowOf(it.value());
+                if (row > -1 && row + removedRows < visibleRows)
                 {
-                    if (autoRefresh) beginResetModel();
-                    filteredFrames.replace(j, tempFrame);
-                    if (autoRefresh) endResetModel();
+                    row += removedRows;
+                    emit dataChanged(index(row, 0), index(row, columnCount(QModelIndex()) - 1));
                 }
             }
         }
@@ -424,42 +600,182 @@ void CANFrameModel::addFrame(const CANFrame& frame, bool autoRefresh = false)
 }
 
 
-void CANFrameModel::addFrames(const CANConnection*, const QVector<CANFrame>& pFrames)
+/*
+ * Batch path for the frames coming from the connections.
+ * The whole batch goes in under a single lock, straight from CANFrame to the packed records,
+ * and the views only hear about it with the next bulk refresh.
+ */
+void CANFrameModel::addFrames(const QVector<CANFrame>& pFrames)
 {
-    foreach(const CANFrame& frame, pFrames)
+    //in overwrite mode rows are updated one by one as frames come in
+    if (overwriteDups)
     {
-        addFrame(frame);
+        foreach(const CANFrame& frame, pFrames)
+        {
+            addFrame(frame, true);
+        }
+        return;
     }
-    if (overwriteDups) //if in overwrite mode we'll update every time frames come in
+
+    int num = pFrames.count();
+    bool newIds = false;
+    QVector<quint32> shown; //with a query, frames the filters let through
+
+    mutex.lock();
+    int first = frames.count();
+    frames.reserve(frames.count() + num);
+    filteredFrames.reserve(filteredFrames.count() + num);
+    for (int i = 0; i < num; i++)
     {
-        beginResetModel();
-        endResetModel();
+        CANFrameRecord rec = CANFrameRecord::fromFrame(pFrames.at(i));
+
+        //IDs not found in the filters list are added and shown by default
+        bool added;
+        if (filters.check(rec.ID, true, &added))
+        {
+            if (query.isEmpty()) filteredFrames.append(frames.count());
+            else shown.append(frames.count());
+        }
+        newIds |= added;
+
+        frames.append(rec);
+        timeIndex.append(frames.count() - 1);
+        idCatalog.add(rec);
+    }
+    //the query runs over the whole batch at once
+    if (!query.isEmpty())
+    {
+        QVector<quint32> matches;
+        int matchPos = 0;
+        runQuery(first, &matches);
+        for (int i = 0; i < shown.count(); i++)
+        {
+            if (isMatch(matches, &matchPos, shown.at(i))) filteredFrames.append(shown.at(i));
+        }
     }
+    lastUpdateNumFrames += num;
+    evictFrames(framesToEvict());
+    //the filter list is rebuilt by the next GUI tick, once for all the IDs found since the last one
+    if (newIds) needFilterRefresh = true;
+    mutex.unlock();
 }
 
+/*
+ * Rebuilds the filtered view after a filter change.
+ * Large captures are scanned in parallel, one task per block of the store, and the view is
+ * swapped in by filterRefreshFinished() once all tasks are done. The GUI keeps running in the
+ * meantime with the previous view. A new call cancels a refresh still running.
+ */
 void CANFrameModel::sendRefresh()
 {
-    qDebug() << "Sending mass refresh";
-    QVector<CANFrame> tempContainer;
+    cancelFilterRefresh();
+
     int count = frames.count();
+    if (!overwriteDups && count >= PARALLEL_REFRESH_MIN)
+    {
+        //the tasks read a snapshot, frames keep coming in and going out while they run
+        mutex.lock();
+        filterSnapshot = frames.snapshot();
+        mutex.unlock();
+        count = filterSnapshot.count();
+
+        QVector<FilterChunk> chunks;
+        for (int i = 0; i < count; i += chunks.last().count)
+        {
+            FilterChunk chunk;
+            chunk.records = filterSnapshot.contiguous(i, &chunk.count);
+            chunk.first = i;
+            chunks.append(chunk);
+        }
+
+        filterRefreshRunning = true;
+        QSharedPointer<const CANIdFilter> filterCopy(new CANIdFilter(filters));
+        QSharedPointer<const CANFrameQuery> queryCopy(new CANFrameQuery(query));
+        filterWatcher.setFuture(QtConcurrent::mappedReduced(chunks, FilterChunkJob(filterCopy, queryCopy), reduceFilterChunk,
+                                                            QtConcurrent::OrderedReduce));
+        return;
+    }
+
+    qDebug() << "Sending mass refresh";
+    QVector<quint32> matches;
+    int matchPos = 0;
+    queryHistory.clear();
+    if (!query.isEmpty()) runQuery(0, &matches);
+    CANFrameIndexView tempIndices(&frames);
+    tempIndices.setAllocator(filteredFrames.allocator());
     for (int i = 0; i < count; i++)
     {
-        if (filters[frames[i].ID])
+        if (filters.check(frames.record(i).ID, false) && (query.isEmpty() || isMatch(matches, &matchPos, i)))
         {
-            tempContainer.append(frames[i]);
+            tempIndices.append(i);
         }
     }
     mutex.lock();
     beginResetModel();
-    filteredFrames.clear();
-    filteredFrames.reserve(preallocSize);
-    filteredFrames.append(tempContainer);
+    filteredFrames.swap(tempIndices);
+    syncRows();
 
     lastUpdateNumFrames = 0;
     endResetModel();
     mutex.unlock();
 }
 
+void CANFrameModel::filterRefreshFinished()
+{
+    if (!filterRefreshRunning || filterWatcher.isCanceled()) return;
+    filterRefreshRunning = false;
+
+    CANFilterResult result = filterWatcher.result();
+
+    mutex.lock();
+    foreach (quint32 id, result.unknownIds)
+    {
+        filters.check(id, false);
+    }
+    if (!result.unknownIds.isEmpty()) needFilterRefresh = true;
+
+    //rows are indices in the snapshot, the frames evicted since then are gone from the store
+    int evicted = (int) (frames.evictedCount() - filterSnapshot.evictedCount());
+    int tail = qMax(filterSnapshot.count() - evicted, 0);
+    filterSnapshot = CANFrameSnapshot();
+
+    CANFrameIndexView tempIndices(&frames);
+    tempIndices.setAllocator(filteredFrames.allocator());
+    for (int i = 0; i < result.rows.count(); i++)
+    {
+        if ((int) result.rows.at(i) >= evicted) tempIndices.append(result.rows.at(i) - evicted);
+    }
+    //frames that came in while the refresh was running, the query picks up where the tasks stopped
+    QVector<quint32> matches;
+    int matchPos = 0;
+    queryHistory = result.last;
+    if (!query.isEmpty()) runQuery(tail, &matches);
+    for (int i = tail; i < frames.count(); i++)
+    {
+        if (filters.check(frames.record(i).ID, false) && (query.isEmpty() || isMatch(matches, &matchPos, i))) tempIndices.append(i);
+    }
+
+    beginResetModel();
+    filteredFrames.swap(tempIndices);
+    syncRows();
+    lastUpdateNumFrames = 0;
+    endResetModel();
+
+    if (!overwriteDups) evictFrames(framesToEvict());
+    publishRows();
+    mutex.unlock();
+}
+
+//stops a running parallel refresh and waits for the tasks in progress, frames can be modified afterwards
+void CANFrameModel::cancelFilterRefresh()
+{
+    if (!filterRefreshRunning) return;
+    filterWatcher.cancel();
+    filterWatcher.waitForFinished();
+    filterRefreshRunning = false;
+    filterSnapshot = CANFrameSnapshot();
+}
+
 void CANFrameModel::sendRefresh(int pos)
 {
     beginInsertRows(QModelIndex(), pos, pos);
@@ -471,16 +787,15 @@ void CANFrameModel::sendRefresh(int pos)
 //have to send thousands of messages per second
 int CANFrameModel::sendBulkRefresh()
 {
-    //int num = filteredFrames.count() - lastUpdateNumFrames;
     if (lastUpdateNumFrames <= 0) return 0;
 
-    if (lastUpdateNumFrames == 0 && !overwriteDups) return 0;
-    if (filteredFrames.count() == 0) return 0;
-
     qDebug() << "Bulk refresh of " << lastUpdateNumFrames;
 
-    beginResetModel();
-    endResetModel();
+    //only the rows appended or evicted since the last call are announced, the view
+    //keeps its scroll position and selection and does not query the other rows again
+    mutex.lock();
+    publishRows();
+    mutex.unlock();
 
     int num = lastUpdateNumFrames;
     lastUpdateNumFrames = 0;
@@ -490,13 +805,21 @@ int CANFrameModel::sendBulkRefresh()
 
 void CANFrameModel::clearFrames()
 {
+    cancelFilterRefresh();
     mutex.lock();
     this->beginResetModel();
     frames.clear();
+    //timestamps of the next capture start over from the time basis, an old offset would wrap them
+    frames.setTimeOffset(0);
+    query.setTimeOffset(0);
+    queryHistory.clear();
     filteredFrames.clear();
+    timeIndex.clear();
+    idCatalog.clear();
     filters.clear();
-    frames.reserve(preallocSize);
-    filteredFrames.reserve(preallocSize);
+    overwriteRows.clear();
+    applySpill();
+    syncRows();
     this->endResetModel();
     lastUpdateNumFrames = 0;
     mutex.unlock();
@@ -519,19 +842,24 @@ void CANFrameModel::insertFrames(const QVector<CANFrame> &newFrames)
     int insertedFiltered = 0;
     for (int i = 0; i < newFrames.count(); i++)
     {
-        frames.append(newFrames[i]);
-        if (!filters.contains(newFrames[i].ID))
-        {
-            filters.insert(newFrames[i].ID, true);
-            needFilterRefresh = true;
-        }
-        if (filters[newFrames[i].ID])
+        //the frames are inserted as they are displayed, the current time offset is folded back in
+        CANFrameRecord rec = CANFrameRecord::fromFrame(newFrames[i]);
+        rec.timestamp += frames.timeOffset();
+        frames.append(rec);
+        idCatalog.add(rec);
+        if (overwriteDups && !overwriteRows.contains(newFrames[i].ID)) overwriteRows.insert(newFrames[i].ID, frames.count() - 1);
+        if (!overwriteDups) timeIndex.append(frames.count() - 1);
+        bool added;
+        bool match = queryAccepts(rec); //the query sees every frame, hidden or not
+        if (filters.check(newFrames[i].ID, true, &added) && match)
         {
             insertedFiltered++;
-            filteredFrames.append(newFrames[i]);
+            filteredFrames.append(frames.count() - 1);
         }
+        if (added) needFilterRefresh = true;
     }
     lastUpdateNumFrames = newFrames.count();
+    if (!overwriteDups) evictFrames(framesToEvict());
     mutex.unlock();
     //endResetModel();
     //beginInsertRows(QModelIndex(), filteredFrames.count() + 1, filteredFrames.count() + insertedFiltered);
@@ -539,19 +867,158 @@ void CANFrameModel::insertFrames(const QVector<CANFrame> &newFrames)
     if (needFilterRefresh) emit updatedFiltersList();
 }
 
-int CANFrameModel::getIndexFromTimeID(unsigned int ID, double timestamp)
+void CANFrameModel::setCaptureLimit(int pMaxFrames, int pMaxSeconds)
 {
-    int bestIndex = -1;
-    uint64_t intTimeStamp = timestamp * 1000000l;
-    for (int i = 0; i < frames.count(); i++)
+    mutex.lock();
+    maxFrames = pMaxFrames;
+    maxSpan = (uint64_t) pMaxSeconds * 1000000ull;
+    int num = overwriteDups ? 0 : framesToEvict();
+    if (num > 0)
     {
-        if ((frames[i].ID == ID))
+        beginResetModel();
+        evictFrames(num);
+        syncRows();
+        endResetModel();
+    }
+    mutex.unlock();
+}
+
+quint64 CANFrameModel::getEvictedCount() const
+{
+    return frames.evictedCount();
+}
+
+void CANFrameModel::setSpillToDisk(bool pEnable, QString pDir)
+{
+    mutex.lock();
+    spillDir = pEnable ? pDir : QString();
+    if (frames.count() == 0) applySpill();
+    mutex.unlock();
+}
+
+//switches the storage of an empty capture between RAM and a file in spillDir
+void CANFrameModel::applySpill()
+{
+    if (spillDir.isEmpty() == framesSpill.isNull()) return;
+
+    //snapshots still reading the old blocks keep the old files until they are dropped
+    frames.setAllocator(QSharedPointer<BlockAllocator>());
+    filteredFrames.setAllocator(QSharedPointer<BlockAllocator>());
+    timeIndex.setAllocator(QSharedPointer<BlockAllocator>());
+    framesSpill.clear();
+    indicesSpill.clear();
+
+    if (spillDir.isEmpty()) return;
+
+    framesSpill = QSharedPointer<MappedFileAllocator>(new MappedFileAllocator(spillDir));
+    indicesSpill = QSharedPointer<MappedFileAllocator>(new MappedFileAllocator(spillDir));
+    if (!framesSpill->isValid() || !indicesSpill->isValid())
+    {
+        qDebug() << "Capture stays in RAM";
+        framesSpill.clear();
+        indicesSpill.clear();
+        spillDir.clear();
+        return;
+    }
+    frames.setAllocator(framesSpill);
+    filteredFrames.setAllocator(indicesSpill);
+    timeIndex.setAllocator(indicesSpill);
+}
+
+//how many of the oldest frames are beyond the capture limits
+int CANFrameModel::framesToEvict() const
+{
+    int count = frames.count();
+    int num = 0;
+
+    if (maxFrames > 0 && count > maxFrames) num = count - maxFrames;
+    if (maxSpan > 0 && count > 0)
+    {
+        uint64_t newest = frames.record(count - 1).timestamp;
+        if (newest > maxSpan)
         {
-            if (frames[i].timestamp <= intTimeStamp) bestIndex = i;
-            else break; //drop out of loop as soon as we pass the proper timestamp
+            //frames are evicted as soon as they get too old so there are only a few to look at here
+            while (num < count && frames.record(num).timestamp < newest - maxSpan) num++;
         }
     }
-    return bestIndex;
+    return num;
+}
+
+void CANFrameModel::evictFrames(int num)
+{
+    //a parallel refresh reads a snapshot, the blocks it still needs stay around until it is done
+    if (num <= 0) return;
+    for (int i = 0; i < num; i++) idCatalog.remove(frames.record(i));
+    frames.removeFirst(num);
+    removedRows += filteredFrames.dropEvicted();
+}
+
+/*
+ * Tells the views about the rows dropped from the top and appended at the bottom of the
+ * filtered view since the last call. Called with the mutex held.
+ */
+void CANFrameModel::publishRows()
+{
+    int num = qMin(removedRows, visibleRows);
+    if (num > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, num - 1);
+        visibleRows -= num;
+        removedRows = 0;
+        endRemoveRows();
+    }
+    //the rows evicted before being announced never reached the views
+    removedRows = 0;
+
+    if (filteredFrames.count() > visibleRows)
+    {
+        beginInsertRows(QModelIndex(), visibleRows, filteredFrames.count() - 1);
+        visibleRows = filteredFrames.count();
+        endInsertRows();
+    }
+}
+
+//the filtered view was rebuilt, called between beginResetModel() and endResetModel()
+void CANFrameModel::syncRows()
+{
+    visibleRows = filteredFrames.count();
+    removedRows = 0;
+}
+
+int CANFrameModel::getFilteredIndex(int row) const
+{
+    return row - removedRows;
+}
+
+int CANFrameModel::getIndexFromTimeID(unsigned int ID, double timestamp)
+{
+    //the index works on stored timestamps, as captured
+    uint64_t intTimeStamp = ((timestamp > 0) ? timestamp * 1000000l : 0) + frames.timeOffset();
+
+    //only one frame per ID in overwrite mode
+    if (overwriteDups)
+    {
+        int idx = overwriteRows.value(ID, -1);
+        if (idx > -1 && frames.record(idx).timestamp > intTimeStamp) idx = -1;
+        return idx;
+    }
+    return timeIndex.find(ID, intTimeStamp);
+}
+
+int CANFrameModel::getRowFromTimeID(unsigned int ID, double timestamp)
+{
+    int idx = getIndexFromTimeID(ID, timestamp);
+    int row = (idx > -1) ? filteredFrames.rowOf(idx) : -1;
+    if (row < 0 && !overwriteDups)
+    {
+        idx = timeIndex.findTime(((timestamp > 0) ? timestamp * 1000000l : 0) + frames.timeOffset());
+        if (idx > -1) row = filteredFrames.rowAtOrBefore(idx);
+    }
+    if (row < 0) return -1;
+
+    //rows evicted since the last bulk refresh are still at the top of the view
+    row += removedRows;
+    return (row < visibleRows) ? row : -1;
 }
 
 void CANFrameModel::loadFilterFile(QString filename)
@@ -589,8 +1056,9 @@ void CANFrameModel::saveFilterFile(QString filename)
     if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
         return;
 
+    const QMap<int, bool> *filterMap = filters.asMap();
     QMap<int, bool>::const_iterator it;
-    for (it = filters.begin(); it != filters.end(); ++it)
+    for (it = filterMap->begin(); it != filterMap->end(); ++it)
     {
         outFile->write(QString::number(it.key(), 16).toUtf8());
         outFile->putChar(',');
@@ -614,18 +1082,64 @@ bool CANFrameModel::needsFilterRefresh()
  * This ability to get a direct read-only reference speeds up a variety of
  * external code that needs to access frames directly and doesn't care about
  * this model's normal output mechanism.
+ * These references are only good on the GUI thread, between two changes of the
+ * capture. Code running elsewhere or holding on to records takes a getSnapshot().
  */
-const QVector<CANFrame>* CANFrameModel::getListReference() const
+const CANFrameList* CANFrameModel::getListReference() const
 {
     return &frames;
 }
 
-const QVector<CANFrame>* CANFrameModel::getFilteredListReference() const
+const CANFrameList* CANFrameModel::getFilteredListReference() const
 {
     return &filteredFrames;
 }
 
+CANFrameSnapshot CANFrameModel::getSnapshot(bool filtered)
+{
+    mutex.lock();
+    CANFrameSnapshot snapshot = filtered ? filteredFrames.snapshot() : frames.snapshot();
+    mutex.unlock();
+    return snapshot;
+}
+
+const CANIdCatalog* CANFrameModel::getIdCatalog() const
+{
+    return &idCatalog;
+}
+
+bool CANFrameModel::getIdInfo(quint32 id, CANIdInfo *info)
+{
+    mutex.lock();
+    const CANIdInfo *found_p = idCatalog.find(id);
+    if (found_p)
+    {
+        *info = *found_p;
+        //same as the frames, the offset is applied as they are read
+        uint64_t offset = frames.timeOffset();
+        info->firstSeen = (info->firstSeen > offset) ? info->firstSeen - offset : 0;
+        info->lastSeen = (info->lastSeen > offset) ? info->lastSeen - offset : 0;
+    }
+    mutex.unlock();
+    return found_p != NULL;
+}
+
+QVector<quint32> CANFrameModel::getIds(const CANFrameList *list, int first) const
+{
+    QVector<quint32> ids;
+    bool filtered = (list == &filteredFrames);
+    if (filtered) first = 0;
+    for (int i = qMax(first, 0); i < idCatalog.count(); i++)
+    {
+        const CANIdInfo &info = idCatalog.at(i);
+        if (info.count == 0) continue;
+        if (filtered && !filters.isShown(info.id)) continue;
+        ids.append(info.id);
+    }
+    return ids;
+}
+
 const QMap<int, bool>* CANFrameModel::getFiltersReference() const
 {
-    return &filters;
+    return filters.asMap();
 }
@@ -6,15 +6,59 @@
 #include <QVector>
 #include <QDebug>
 #include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QCache>
+#include <QColor>
 #include "can_structs.h"
+#include "canframestore.h"
+#include "canframetimeindex.h"
+#include "canidfilter.h"
+#include "canidcatalog.h"
+#include "canframequery.h"
+#include "mappedfileallocator.h"
 #include "dbc/dbchandler.h"
 #include "connections/canconnection.h"
 
+/* filtered rows computed by a parallel refresh, see CANFrameModel::sendRefresh() */
+struct CANFilterResult
+{
+    QVector<quint32> rows;      //indices in frames, in order
+    QSet<quint32> unknownIds;   //IDs with no filter entry yet, they get added as hidden
+
+    //when the query looks at the previous frame of each ID, chunks can't tell for the first
+    //frame of each ID, the reduce step does it from the last frames of the chunks before
+    QVector<quint32> pending;               //indices in frames
+    QHash<quint32, CANFrameRecord> last;    //last frame of each ID
+    const CANFrameRecord* records;          //the chunk, pending[i] is records[pending[i] - first]
+    int first;
+    QSharedPointer<const CANFrameQuery> query;
+    QSharedPointer<const CANIdFilter> filter;
+
+    CANFilterResult() : records(NULL), first(0) {}
+};
+
+/* a row of the table as displayed, see CANFrameModel::renderRow() */
+struct CANRenderedRow
+{
+    QString text[7];
+    QByteArray bytes; //payload for FrameDataDelegate, null when the data column shows decoded signals
+    QColor background;
+    QColor foreground;
+};
+
 class CANFrameModel: public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
+    enum
+    {
+        BytesRole = Qt::UserRole //payload of the data column as a QByteArray, when it shows nothing else
+    };
+
     CANFrameModel(QObject *parent = 0);
     virtual ~CANFrameModel();
 
@@ -39,26 +83,116 @@ public:
     void setTimeFormat(QString);
     void loadFilterFile(QString filename);
     void saveFilterFile(QString filename);
+    /**
+     * @brief setQuery selects the frames shown on top of the per ID filters, see CANFrameQuery
+     * @param text: empty to show all the frames the filters let through
+     * @param error: set to the reason the query was refused
+     * @return false if the query does not compile, the current one stays then
+     */
+    bool setQuery(QString text, QString *error);
+    QString getQuery() const;
+    /* timestamps are shown relative to the first frame, in O(1) */
     void normalizeTiming();
+    /* gives back the timestamps as captured */
+    void restoreTiming();
+    bool isTimingNormalized() const;
     void recalcOverwrite();
     bool needsFilterRefresh();
     void insertFrames(const QVector<CANFrame> &newFrames);
+    /**
+     * @brief getIndexFromTimeID finds the frame of an ID shown at a given time, O(log n)
+     * @param ID
+     * @param timestamp: in seconds
+     * @return index in getListReference() of the last frame of ID at or before timestamp, -1 if none
+     */
     int getIndexFromTimeID(unsigned int ID, double timestamp);
-    const QVector<CANFrame> *getListReference() const; //thou shalt not modify these frames externally!
-    const QVector<CANFrame> *getFilteredListReference() const; //Thus saith the Lord, NO.
+    /**
+     * @brief getRowFromTimeID same as getIndexFromTimeID() for the views, used to sync on time
+     * @return row in the views, falls back on the last shown frame at that time when the ID is filtered out
+     */
+    int getRowFromTimeID(unsigned int ID, double timestamp);
+    /**
+     * @brief getFilteredIndex maps a row of the views to the filtered list
+     * @param row: row in the views
+     * @return index in getFilteredListReference(), negative if the frame was evicted
+     */
+    int getFilteredIndex(int row) const;
+
+    /**
+     * @brief setCaptureLimit bounds the capture, the oldest frames are dropped beyond the limits
+     * @param pMaxFrames: number of frames to keep, 0 for no limit
+     * @param pMaxSeconds: time span to keep, 0 for no limit
+     */
+    void setCaptureLimit(int pMaxFrames, int pMaxSeconds);
+    /* number of frames dropped because of the capture limit since the last clear */
+    quint64 getEvictedCount() const;
+    /**
+     * @brief setSpillToDisk keeps the capture in a memory mapped file instead of RAM
+     * @param pEnable
+     * @param pDir: directory of the capture file
+     * @note takes effect immediately if the capture is empty, otherwise on the next clear
+     */
+    void setSpillToDisk(bool pEnable, QString pDir);
+    const CANFrameList *getListReference() const; //thou shalt not modify these frames externally!
+    const CANFrameList *getFilteredListReference() const; //Thus saith the Lord, NO.
+
+    /**
+     * @brief getSnapshot frozen copy of the capture, safe to read from other threads
+     * @param filtered: the frames shown instead of all of them
+     * @return unlike the references above it stays valid through new frames, evictions and
+     * clearFrames(), it only keeps the blocks it sees allocated until it is dropped
+     */
+    CANFrameSnapshot getSnapshot(bool filtered = false);
     const QMap<int, bool> *getFiltersReference() const; //this neither
 
+    /**
+     * @brief getIdCatalog
+     * @return per ID statistics of the capture, kept up to date as frames come in
+     * @note firstSeen and lastSeen are the stored timestamps, see getIdInfo()
+     */
+    const CANIdCatalog *getIdCatalog() const;
+
+    /**
+     * @brief getIdInfo copy of the catalog entry of one ID
+     * @param info: filled in with firstSeen and lastSeen as shown, the time offset applied
+     * @return false if the ID was never seen
+     */
+    bool getIdInfo(quint32 id, CANIdInfo *info);
+
+    /**
+     * @brief getIds lists the IDs held by one of the lists handed out above, from the catalog
+     * @param list: getListReference() or getFilteredListReference(), the IDs hidden by the
+     * filters are left out for the latter
+     * @param first: catalog position to start from, pass getIdCatalog()->count() as it was
+     * on the previous call to only get the IDs seen since then. Ignored for the filtered list,
+     * an ID hidden when it was first seen may be shown since, the caller skips the IDs it has
+     * @return IDs in order of first appearance, IDs with all their frames evicted are left out
+     */
+    QVector<quint32> getIds(const CANFrameList *list, int first = 0) const;
+
 public slots:
     void addFrame(const CANFrame&, bool);
-    void addFrames(const CANConnection*, const QVector<CANFrame>&);
+    void addFrames(const QVector<CANFrame>&);
 
 signals:
     void updatedFiltersList();
+    //the query stopped compiling after a DBC change and was dropped, all frames are shown again
+    void queryFailed(const QString &error);
+
+private slots:
+    void filterRefreshFinished();
+    void clearRenderCache();
+    void dbcFilesChanged();
 
 private:
-    QVector<CANFrame> frames;
-    QVector<CANFrame> filteredFrames;
-    QMap<int, bool> filters;
+    CANFrameStore frames;
+    CANFrameIndexView filteredFrames; //indices into frames of the frames passing the filters
+    CANFrameTimeIndex timeIndex; //kept up to date outside of overwrite mode
+    CANIdFilter filters;
+    CANIdCatalog idCatalog;
+    CANFrameQuery query;
+    QHash<quint32, CANFrameRecord> queryHistory; //last frame of each ID the query went through, when it uses history
+    QHash<quint32, int> overwriteRows; //in overwrite mode, index in frames of the frame shown for each ID
     DBCHandler *dbcHandler;
     QMutex mutex;
     bool interpretFrames; //should we use the dbcHandler?
@@ -68,9 +202,30 @@ private:
     bool timeSeconds;
     bool useSystemTime;
     bool needFilterRefresh;
-    uint64_t timeOffset;
     int lastUpdateNumFrames;
-    uint32_t preallocSize;
+    int maxFrames;
+    uint64_t maxSpan; //in microseconds
+
+    QString spillDir; //empty when the capture stays in RAM
+    QSharedPointer<MappedFileAllocator> framesSpill;
+    QSharedPointer<MappedFileAllocator> indicesSpill;
+
+    QFutureWatcher<CANFilterResult> filterWatcher;
+    bool filterRefreshRunning;
+    CANFrameSnapshot filterSnapshot; //frames read by the running refresh
+    int visibleRows; //rows the views know about, see publishRows()
+    int removedRows; //rows evicted from the top of filteredFrames not announced yet
+    mutable QCache<quint32, CANRenderedRow> renderCache; //keyed on index in frames + evicted count
+
+    void cancelFilterRefresh();
+    int framesToEvict() const;
+    void evictFrames(int num);
+    void applySpill();
+    void publishRows();
+    bool queryAccepts(const CANFrameRecord &rec);
+    void runQuery(int first, QVector<quint32> *rows);
+    void syncRows();
+    const CANRenderedRow *renderRow(int row) const;
 };
 
 
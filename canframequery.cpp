@@ -0,0 +1,750 @@
+#include "canframequery.h"
+
+#include <cmath>
+#include <limits>
+#include <string.h>
+#include <QRegularExpression>
+#include "dbc/dbchandler.h"
+#include "utility.h"
+
+//records evaluated together, the stack of the program holds one result per record of a batch
+#define QUERY_BATCH     256
+#define QUERY_MAX_DEPTH 32
+//IDs below this one keep their last position in a flat table while a run is filtered
+#define QUERY_STD_IDS   2048
+//multiplexors of multiplexors followed when signals are copied
+#define QUERY_MAX_MUX   4
+
+
+/*
+ * Recursive descent parser of the query language, appends the program of a CANFrameQuery
+ * in postfix order as it goes.
+ */
+class CANQueryParser
+{
+public:
+    CANQueryParser(CANFrameQuery* pQuery_p, DBCHandler* pDbc_p) :
+        mQuery_p(pQuery_p), mDbc_p(pDbc_p), mPos(0), mDepth(0), mMaxDepth(0)
+    {
+    }
+
+    bool parse(const QString& pText, QString* pError_p);
+
+private:
+    CANFrameQuery*  mQuery_p;
+    DBCHandler*     mDbc_p;
+    QStringList     mTokens;
+    int             mPos;
+    int             mDepth;
+    int             mMaxDepth;
+    QString         mError;
+
+    bool tokenize(const QString& pText);
+    bool parseOr();
+    bool parseAnd();
+    bool parseUnary();
+    bool parseTerm();
+    bool parseInteger(quint64* pValue_p);
+    bool parseDouble(double* pValue_p);
+    bool parseTime(quint64* pValue_p);
+    void pushRange(CANFrameQuery::Op pOp, quint64 pLo, quint64 pHi);
+    void pushRange(CANFrameQuery::Op pOp, double pLo, double pHi);
+    void push(const CANFrameQuery::Op& pOp);
+    DBC_SIGNAL* findSignal(const QString& pName, int* pBus_p);
+    int addSignal(const DBC_SIGNAL* pSig_p, int pBus, int pLevel);
+
+    QString peek() const { return (mPos < mTokens.count()) ? mTokens.at(mPos) : QString(); }
+    QString next() { return (mPos < mTokens.count()) ? mTokens.at(mPos++) : QString(); }
+    bool accept(const QString& pTok)
+    {
+        if (peek().compare(pTok, Qt::CaseInsensitive) != 0) return false;
+        mPos++;
+        return true;
+    }
+    bool fail(const QString& pError)
+    {
+        if (mError.isEmpty()) mError = pError;
+        return false;
+    }
+};
+
+
+bool CANQueryParser::parse(const QString& pText, QString* pError_p)
+{
+    bool ok = tokenize(pText) && parseOr();
+    if (ok && mPos < mTokens.count()) ok = fail(QString("Unexpected \"%1\"").arg(peek()));
+    if (ok && mMaxDepth > QUERY_MAX_DEPTH) ok = fail("Query is too complex");
+    if (!ok && pError_p) *pError_p = mError;
+    mQuery_p->mDepth = mMaxDepth;
+    return ok;
+}
+
+bool CANQueryParser::tokenize(const QString& pText)
+{
+    static const char* twoChars[] = { "==", "!=", "<=", ">=", "&&", "||" };
+    int i = 0;
+
+    while (i < pText.length())
+    {
+        QChar c = pText.at(i);
+        if (c.isSpace())
+        {
+            i++;
+            continue;
+        }
+
+        QString two = pText.mid(i, 2);
+        bool found = false;
+        for (unsigned int j = 0; j < sizeof(twoChars) / sizeof(twoChars[0]); j++)
+        {
+            if (two == twoChars[j])
+            {
+                mTokens.append(two);
+                i += 2;
+                found = true;
+                break;
+            }
+        }
+        if (found) continue;
+
+        if (QString("<>&()!-=").contains(c))
+        {
+            mTokens.append((c == '=') ? QString("==") : QString(c));
+            i++;
+        }
+        else if (c.isLetter() || c == '_' || c.isDigit() || c == '.')
+        {
+            //names, numbers and bN.M all go up to the next operator
+            int start = i;
+            while (i < pText.length() && (pText.at(i).isLetterOrNumber() || pText.at(i) == '_' || pText.at(i) == '.')) i++;
+            mTokens.append(pText.mid(start, i - start));
+        }
+        else return fail(QString("Unexpected character '%1'").arg(c));
+    }
+    return true;
+}
+
+bool CANQueryParser::parseOr()
+{
+    if (!parseAnd()) return false;
+    while (accept("||") || accept("or"))
+    {
+        if (!parseAnd()) return false;
+        CANFrameQuery::Op op;
+        op.code = CANFrameQuery::OP_OR;
+        push(op);
+    }
+    return true;
+}
+
+bool CANQueryParser::parseAnd()
+{
+    if (!parseUnary()) return false;
+    while (accept("&&") || accept("and"))
+    {
+        if (!parseUnary()) return false;
+        CANFrameQuery::Op op;
+        op.code = CANFrameQuery::OP_AND;
+        push(op);
+    }
+    return true;
+}
+
+bool CANQueryParser::parseUnary()
+{
+    if (accept("!") || accept("not"))
+    {
+        if (!parseUnary()) return false;
+        CANFrameQuery::Op op;
+        op.code = CANFrameQuery::OP_NOT;
+        push(op);
+        return true;
+    }
+    if (accept("("))
+    {
+        if (!parseOr()) return false;
+        if (!accept(")")) return fail("Missing )");
+        return true;
+    }
+    return parseTerm();
+}
+
+bool CANQueryParser::parseTerm()
+{
+    static const QRegularExpression byteField("^b([0-7])(?:\\.([0-7]))?$", QRegularExpression::CaseInsensitiveOption);
+
+    QString name = next();
+    QString lower = name.toLower();
+    if (name.isEmpty()) return fail("Unexpected end of query");
+
+    CANFrameQuery::Op op;
+    op.code = CANFrameQuery::OP_TEST;
+    op.byte = 0;
+    op.shift = 0;
+    op.mask = ~0ull;
+    op.sig = -1;
+
+    //flags of the frame
+    if (lower == "rx" || lower == "tx" || lower == "ext" || lower == "std")
+    {
+        op.field = (lower == "rx" || lower == "tx") ? CANFrameQuery::FIELD_DIR : CANFrameQuery::FIELD_EXT;
+        op.mask = 1;
+        quint64 val = (lower == "rx" || lower == "ext") ? 1 : 0;
+        pushRange(op, val, val);
+        return true;
+    }
+
+    QRegularExpressionMatch byteMatch = byteField.match(name);
+    if (lower == "id") op.field = CANFrameQuery::FIELD_ID;
+    else if (lower == "bus") op.field = CANFrameQuery::FIELD_BUS;
+    else if (lower == "len" || lower == "dlc") op.field = CANFrameQuery::FIELD_LEN;
+    else if (lower == "time") op.field = CANFrameQuery::FIELD_TIME;
+    else if (byteMatch.hasMatch())
+    {
+        op.field = CANFrameQuery::FIELD_BYTE;
+        op.byte = byteMatch.captured(1).toInt();
+        if (!byteMatch.captured(2).isEmpty())
+        {
+            op.shift = byteMatch.captured(2).toInt();
+            op.mask = 1;
+        }
+        else op.mask = 0xFF;
+    }
+    else
+    {
+        int bus = -1;
+        DBC_SIGNAL* sig = findSignal(name, &bus);
+        if (!sig) return fail(QString("Unknown field or signal \"%1\"").arg(name));
+        op.field = CANFrameQuery::FIELD_SIGNAL;
+        op.sig = addSignal(sig, bus, 0);
+    }
+
+    bool integer = (op.field != CANFrameQuery::FIELD_SIGNAL && op.field != CANFrameQuery::FIELD_TIME);
+
+    if (accept("&"))
+    {
+        if (!integer) return fail(QString("\"%1\" can't be masked").arg(name));
+        quint64 mask;
+        if (!parseInteger(&mask)) return false;
+        op.mask &= mask;
+    }
+
+    if (accept("changed") || accept("toggled"))
+    {
+        if (op.field == CANFrameQuery::FIELD_TIME) return fail("\"changed\" does not apply to time");
+        op.code = CANFrameQuery::OP_CHANGED;
+        mQuery_p->mHistory = true;
+        push(op);
+        return true;
+    }
+
+    if (op.field == CANFrameQuery::FIELD_TIME) mQuery_p->mTime = true;
+
+    QString cmp = next();
+    if (cmp.compare("in", Qt::CaseInsensitive) == 0)
+    {
+        if (integer || op.field == CANFrameQuery::FIELD_TIME)
+        {
+            quint64 lo, hi;
+            if (integer ? !parseInteger(&lo) : !parseTime(&lo)) return false;
+            if (!accept("-")) return fail("Expected a range such as 0x100-0x1FF");
+            if (integer ? !parseInteger(&hi) : !parseTime(&hi)) return false;
+            pushRange(op, lo, hi);
+        }
+        else
+        {
+            double lo, hi;
+            if (!parseDouble(&lo)) return false;
+            if (!accept("-")) return fail("Expected a range such as 10-20");
+            if (!parseDouble(&hi)) return false;
+            pushRange(op, lo, hi);
+        }
+        return true;
+    }
+
+    static const QStringList comparisons = QStringList() << "==" << "!=" << "<" << "<=" << ">" << ">=";
+    int cmpIdx = comparisons.indexOf(cmp);
+    if (cmpIdx < 0) return fail(QString("Expected a comparison after \"%1\"").arg(name));
+
+    if (integer || op.field == CANFrameQuery::FIELD_TIME)
+    {
+        quint64 val;
+        if (integer ? !parseInteger(&val) : !parseTime(&val)) return false;
+        const quint64 maxVal = ~0ull;
+        switch (cmpIdx)
+        {
+        case 0: pushRange(op, val, val); break;
+        case 1:
+            //both sides, a negation would also select the frames that don't have the field
+            if (val == 0) pushRange(op, val + 1, maxVal);
+            else if (val == maxVal) pushRange(op, (quint64) 0, val - 1);
+            else
+            {
+                pushRange(op, (quint64) 0, val - 1);
+                pushRange(op, val + 1, maxVal);
+                op.code = CANFrameQuery::OP_OR;
+                push(op);
+            }
+            break;
+        case 2:
+            if (val == 0) pushRange(op, maxVal, (quint64) 0);
+            else pushRange(op, (quint64) 0, val - 1);
+            break;
+        case 3: pushRange(op, (quint64) 0, val); break;
+        case 4:
+            if (val == maxVal) pushRange(op, maxVal, (quint64) 0);
+            else pushRange(op, val + 1, maxVal);
+            break;
+        case 5: pushRange(op, val, maxVal); break;
+        }
+    }
+    else
+    {
+        double val;
+        if (!parseDouble(&val)) return false;
+        const double inf = std::numeric_limits<double>::infinity();
+        double below = std::nextafter(val, -inf);
+        double above = std::nextafter(val, inf);
+        switch (cmpIdx)
+        {
+        case 0: pushRange(op, val, val); break;
+        case 1:
+            pushRange(op, -inf, below);
+            pushRange(op, above, inf);
+            op.code = CANFrameQuery::OP_OR;
+            push(op);
+            break;
+        case 2: pushRange(op, -inf, below); break;
+        case 3: pushRange(op, -inf, val); break;
+        case 4: pushRange(op, above, inf); break;
+        case 5: pushRange(op, val, inf); break;
+        }
+    }
+    return true;
+}
+
+bool CANQueryParser::parseInteger(quint64* pValue_p)
+{
+    QString tok = next();
+    bool ok;
+    if (tok.startsWith("0x", Qt::CaseInsensitive)) *pValue_p = tok.mid(2).toULongLong(&ok, 16);
+    else *pValue_p = tok.toULongLong(&ok, 10);
+    if (!ok) return fail(tok.isEmpty() ? QString("Expected a number") : QString("\"%1\" is not an integer").arg(tok));
+    return true;
+}
+
+bool CANQueryParser::parseDouble(double* pValue_p)
+{
+    bool negative = accept("-");
+    QString tok = next();
+    bool ok;
+    if (tok.startsWith("0x", Qt::CaseInsensitive)) *pValue_p = tok.mid(2).toULongLong(&ok, 16);
+    else *pValue_p = tok.toDouble(&ok);
+    if (!ok) return fail(tok.isEmpty() ? QString("Expected a number") : QString("\"%1\" is not a number").arg(tok));
+    if (negative) *pValue_p = -*pValue_p;
+    return true;
+}
+
+//seconds to microseconds, the unit of the timestamps
+bool CANQueryParser::parseTime(quint64* pValue_p)
+{
+    double seconds;
+    if (!parseDouble(&seconds)) return false;
+    if (seconds < 0) return fail("Times can't be negative");
+    *pValue_p = (quint64) std::llround(seconds * 1000000.0);
+    return true;
+}
+
+void CANQueryParser::pushRange(CANFrameQuery::Op pOp, quint64 pLo, quint64 pHi)
+{
+    //an empty range, such as in 5-1, becomes a constant
+    if (pLo > pHi)
+    {
+        pOp.code = CANFrameQuery::OP_CONST;
+        pOp.lo = 0;
+    }
+    else
+    {
+        pOp.lo = pLo;
+        pOp.span = pHi - pLo;
+    }
+    push(pOp);
+}
+
+void CANQueryParser::pushRange(CANFrameQuery::Op pOp, double pLo, double pHi)
+{
+    pOp.dlo = pLo;
+    pOp.dhi = pHi;
+    push(pOp);
+}
+
+void CANQueryParser::push(const CANFrameQuery::Op& pOp)
+{
+    if (pOp.code == CANFrameQuery::OP_AND || pOp.code == CANFrameQuery::OP_OR) mDepth--;
+    else if (pOp.code != CANFrameQuery::OP_NOT) mDepth++;
+    mMaxDepth = qMax(mMaxDepth, mDepth);
+    mQuery_p->mProgram.append(pOp);
+}
+
+//first signal with that name in the loaded files
+DBC_SIGNAL* CANQueryParser::findSignal(const QString& pName, int* pBus_p)
+{
+    if (!mDbc_p) return NULL;
+    for (int f = 0; f < mDbc_p->getFileCount(); f++)
+    {
+        DBCFile* file = mDbc_p->getFileByIdx(f);
+        for (int m = 0; m < file->messageHandler->getCount(); m++)
+        {
+            DBC_SIGNAL* sig = file->messageHandler->findMsgByIdx(m)->sigHandler->findSignalByName(pName);
+            if (sig)
+            {
+                *pBus_p = file->getAssocBus();
+                return sig;
+            }
+        }
+    }
+    return NULL;
+}
+
+//copies a signal and the multiplexors it depends on into the query, returns its index in mSignals
+int CANQueryParser::addSignal(const DBC_SIGNAL* pSig_p, int pBus, int pLevel)
+{
+    CANFrameQuery::SignalDef def;
+    def.id = pSig_p->parentMessage->ID;
+    def.bus = pBus;
+    def.valType = pSig_p->valType;
+    def.startBit = pSig_p->startBit;
+    def.size = pSig_p->signalSize;
+    def.intel = pSig_p->intelByteOrder;
+    def.factor = pSig_p->factor;
+    def.bias = pSig_p->bias;
+    def.mux = -1;
+    def.muxValue = pSig_p->multiplexValue;
+
+    if (pSig_p->isMultiplexed)
+    {
+        const DBC_SIGNAL* mux_p = pSig_p->parentMessage->multiplexorSignal;
+        //a multiplexed signal without a usable multiplexor is never decoded, like processAsDouble() does
+        if (!mux_p || mux_p == pSig_p || pLevel >= QUERY_MAX_MUX) def.valType = STRING;
+        else def.mux = addSignal(mux_p, pBus, pLevel + 1);
+    }
+
+    mQuery_p->mSignals.append(def);
+    return mQuery_p->mSignals.count() - 1;
+}
+
+
+CANFrameQuery::CANFrameQuery() :
+    mTimeOffset(0)
+{
+    clear();
+}
+
+bool CANFrameQuery::compile(const QString& pText, DBCHandler* pDbc_p, QString* pError_p)
+{
+    CANFrameQuery compiled;
+    compiled.mTimeOffset = mTimeOffset;
+    compiled.mText = pText.trimmed();
+
+    if (!compiled.mText.isEmpty())
+    {
+        CANQueryParser parser(&compiled, pDbc_p);
+        if (!parser.parse(compiled.mText, pError_p)) return false;
+    }
+
+    *this = compiled;
+    return true;
+}
+
+void CANFrameQuery::clear()
+{
+    mText.clear();
+    mProgram.clear();
+    mSignals.clear();
+    mDepth = 0;
+    mHistory = false;
+    mTime = false;
+}
+
+QString CANFrameQuery::text() const
+{
+    return mText;
+}
+
+bool CANFrameQuery::isEmpty() const
+{
+    return mProgram.isEmpty();
+}
+
+bool CANFrameQuery::usesHistory() const
+{
+    return mHistory;
+}
+
+bool CANFrameQuery::usesTime() const
+{
+    return mTime;
+}
+
+void CANFrameQuery::setTimeOffset(uint64_t pOffset)
+{
+    mTimeOffset = pOffset;
+}
+
+bool CANFrameQuery::matches(const CANFrameRecord& pRec, const CANFrameRecord* pPrev_p) const
+{
+    if (mProgram.isEmpty()) return true;
+    quint8 result;
+    evalBatch(&pRec, &pPrev_p, 1, &result);
+    return result;
+}
+
+void CANFrameQuery::filter(const CANFrameRecord* pRecs, int pCount, int pFirst, QHash<quint32, CANFrameRecord>* pHistory_p,
+                           QVector<quint32>* pRows_p, QVector<quint32>* pPending_p) const
+{
+    const CANFrameRecord* prev[QUERY_BATCH];
+    quint8 result[QUERY_BATCH];
+    quint8 pending[QUERY_BATCH];
+    //position in pRecs of the last frame of each ID, -1 before the first one
+    QVector<int> stdLast;
+    QHash<quint32, int> extLast;
+
+    if (mProgram.isEmpty())
+    {
+        for (int i = 0; i < pCount; i++) pRows_p->append(pFirst + i);
+        return;
+    }
+
+    if (mHistory) stdLast.fill(-1, QUERY_STD_IDS);
+    memset(pending, 0, sizeof(pending));
+
+    for (int base = 0; base < pCount; base += QUERY_BATCH)
+    {
+        int num = qMin(QUERY_BATCH, pCount - base);
+
+        if (mHistory)
+        {
+            for (int i = 0; i < num; i++)
+            {
+                quint32 id = pRecs[base + i].ID;
+                int last;
+                if (id < QUERY_STD_IDS)
+                {
+                    last = stdLast.at(id);
+                    stdLast[id] = base + i;
+                }
+                else
+                {
+                    QHash<quint32, int>::iterator it = extLast.find(id);
+                    if (it == extLast.end())
+                    {
+                        last = -1;
+                        extLast.insert(id, base + i);
+                    }
+                    else
+                    {
+                        last = it.value();
+                        it.value() = base + i;
+                    }
+                }
+
+                pending[i] = 0;
+                if (last >= 0) prev[i] = &pRecs[last];
+                else if (pPending_p)
+                {
+                    prev[i] = NULL;
+                    pending[i] = 1;
+                }
+                else
+                {
+                    QHash<quint32, CANFrameRecord>::const_iterator it = pHistory_p->constFind(id);
+                    prev[i] = (it == pHistory_p->constEnd()) ? NULL : &it.value();
+                }
+            }
+        }
+        else
+        {
+            for (int i = 0; i < num; i++) prev[i] = NULL;
+        }
+
+        evalBatch(pRecs + base, prev, num, result);
+
+        for (int i = 0; i < num; i++)
+        {
+            if (pending[i]) pPending_p->append(pFirst + base + i);
+            else if (result[i]) pRows_p->append(pFirst + base + i);
+        }
+    }
+
+    if (!mHistory || !pHistory_p) return;
+    for (int id = 0; id < QUERY_STD_IDS; id++)
+    {
+        if (stdLast.at(id) >= 0) pHistory_p->insert(id, pRecs[stdLast.at(id)]);
+    }
+    for (QHash<quint32, int>::const_iterator it = extLast.constBegin(); it != extLast.constEnd(); ++it)
+    {
+        pHistory_p->insert(it.key(), pRecs[it.value()]);
+    }
+}
+
+/* runs the program over pCount records, one instruction at a time for all of them */
+void CANFrameQuery::evalBatch(const CANFrameRecord* pRecs, const CANFrameRecord* const* pPrev, int pCount, quint8* pOut) const
+{
+    quint8 stack[QUERY_MAX_DEPTH][QUERY_BATCH];
+    int depth = 0;
+
+    for (int p = 0; p < mProgram.count(); p++)
+    {
+        const Op& op = mProgram.at(p);
+        switch (op.code)
+        {
+        case OP_CONST:
+            memset(stack[depth++], (int) op.lo, pCount);
+            break;
+        case OP_TEST:
+            test(op, pRecs, pCount, stack[depth++]);
+            break;
+        case OP_CHANGED:
+            changed(op, pRecs, pPrev, pCount, stack[depth++]);
+            break;
+        case OP_AND:
+            depth--;
+            for (int i = 0; i < pCount; i++) stack[depth - 1][i] &= stack[depth][i];
+            break;
+        case OP_OR:
+            depth--;
+            for (int i = 0; i < pCount; i++) stack[depth - 1][i] |= stack[depth][i];
+            break;
+        case OP_NOT:
+            for (int i = 0; i < pCount; i++) stack[depth - 1][i] ^= 1;
+            break;
+        }
+    }
+    memcpy(pOut, stack[0], pCount);
+}
+
+//lo <= value <= hi with a single comparison
+static inline quint8 inRange(quint64 pVal, quint64 pLo, quint64 pSpan)
+{
+    return (pVal - pLo) <= pSpan;
+}
+
+//same results as DBC_SIGNAL::processAsDouble(), from the copy of the signal
+bool CANFrameQuery::decodeSignal(int pSig, const CANFrameRecord& pRec, double* pValue_p) const
+{
+    const SignalDef& sig = mSignals.at(pSig);
+    if (pRec.ID != sig.id || (sig.bus != -1 && (int) pRec.bus != sig.bus)) return false;
+    if (sig.valType == STRING) return false;
+
+    if (sig.mux != -1)
+    {
+        //the multiplexor is read as an integer, see DBC_SIGNAL::processAsInt()
+        double muxVal;
+        int muxType = mSignals.at(sig.mux).valType;
+        if (muxType != SIGNED_INT && muxType != UNSIGNED_INT) return false;
+        if (!decodeSignal(sig.mux, pRec, &muxVal) || (int32_t) muxVal != sig.muxValue) return false;
+    }
+
+    if (sig.valType == SIGNED_INT || sig.valType == UNSIGNED_INT)
+    {
+        int64_t raw = Utility::processIntegerSignal(pRec.data, sig.startBit, sig.size, sig.intel, sig.valType == SIGNED_INT);
+        *pValue_p = ((double) raw * sig.factor) + sig.bias;
+    }
+    else if (sig.valType == SP_FLOAT)
+    {
+        uint32_t raw = (uint32_t) Utility::processIntegerSignal(pRec.data, sig.startBit, 32, false, false);
+        float val;
+        memcpy(&val, &raw, sizeof(val));
+        *pValue_p = (val * sig.factor) + sig.bias;
+    }
+    else
+    {
+        int64_t raw = Utility::processIntegerSignal(pRec.data, 0, 64, false, false);
+        double val;
+        memcpy(&val, &raw, sizeof(val));
+        *pValue_p = (val * sig.factor) + sig.bias;
+    }
+    return true;
+}
+
+void CANFrameQuery::test(const Op& pOp, const CANFrameRecord* pRecs, int pCount, quint8* pOut) const
+{
+    const quint64 lo = pOp.lo;
+    const quint64 span = pOp.span;
+    const quint64 mask = pOp.mask;
+    const int shift = pOp.shift;
+
+    switch (pOp.field)
+    {
+    case FIELD_ID:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange((pRecs[i].ID >> shift) & mask, lo, span);
+        break;
+    case FIELD_BUS:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange((pRecs[i].bus >> shift) & mask, lo, span);
+        break;
+    case FIELD_LEN:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange((pRecs[i].len >> shift) & mask, lo, span);
+        break;
+    case FIELD_DIR:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange(pRecs[i].isReceived, lo, span);
+        break;
+    case FIELD_EXT:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange(pRecs[i].extended, lo, span);
+        break;
+    case FIELD_BYTE:
+    {
+        //bytes past the length of the frame never match
+        const int byte = pOp.byte;
+        for (int i = 0; i < pCount; i++)
+            pOut[i] = (pRecs[i].len > byte) & inRange((pRecs[i].data[byte] >> shift) & mask, lo, span);
+        break;
+    }
+    case FIELD_TIME:
+        for (int i = 0; i < pCount; i++) pOut[i] = inRange(pRecs[i].timestamp - mTimeOffset, lo, span);
+        break;
+    case FIELD_SIGNAL:
+        for (int i = 0; i < pCount; i++)
+        {
+            double val;
+            pOut[i] = decodeSignal(pOp.sig, pRecs[i], &val) && val >= pOp.dlo && val <= pOp.dhi;
+        }
+        break;
+    }
+}
+
+void CANFrameQuery::changed(const Op& pOp, const CANFrameRecord* pRecs, const CANFrameRecord* const* pPrev, int pCount, quint8* pOut) const
+{
+    for (int i = 0; i < pCount; i++)
+    {
+        const CANFrameRecord* prev_p = pPrev[i];
+        const CANFrameRecord& rec = pRecs[i];
+        quint8 diff = 0;
+
+        if (prev_p)
+        {
+            switch (pOp.field)
+            {
+            case FIELD_ID:
+                diff = ((rec.ID ^ prev_p->ID) >> pOp.shift) & pOp.mask ? 1 : 0;
+                break;
+            case FIELD_BUS:
+                diff = ((rec.bus ^ prev_p->bus) >> pOp.shift) & pOp.mask ? 1 : 0;
+                break;
+            case FIELD_LEN:
+                diff = ((rec.len ^ prev_p->len) >> pOp.shift) & pOp.mask ? 1 : 0;
+                break;
+            case FIELD_BYTE:
+                if (rec.len > pOp.byte && prev_p->len > pOp.byte)
+                    diff = ((rec.data[pOp.byte] ^ prev_p->data[pOp.byte]) >> pOp.shift) & pOp.mask ? 1 : 0;
+                break;
+            case FIELD_SIGNAL:
+            {
+                double val, prevVal;
+                diff = decodeSignal(pOp.sig, rec, &val) && decodeSignal(pOp.sig, *prev_p, &prevVal) && val != prevVal;
+                break;
+            }
+            }
+        }
+        pOut[i] = diff;
+    }
+}
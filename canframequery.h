@@ -0,0 +1,146 @@
+#ifndef CANFRAMEQUERY_H
+#define CANFRAMEQUERY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "can_structs.h"
+
+class DBCHandler;
+
+/*
+ * Frame selection typed by the user, on top of the per ID filters of the main view.
+ *
+ *   id in 0x100-0x1FF && bus == 1
+ *   id & 0x700 == 0x600 || ext
+ *   rx && len >= 4 && b0 & 0xF0 == 0x20
+ *   b3.2 toggled
+ *   time in 10.5-12 && EngineRPM > 3000
+ *
+ * Fields are id, bus, len (or dlc), time (seconds as displayed), b0 to b7 for the data bytes,
+ * bN.M for bit M of byte N and the names of the signals of the loaded DBC files.
+ * They are compared with == != < <= > >= or "in lo-hi", integer fields take an optional
+ * "& mask" first. "changed" (or "toggled") is true when the field differs from the previous
+ * frame with the same ID. rx, tx, ext and std select on the direction and the ID format.
+ * Terms combine with && || ! (or and, or, not) and parentheses.
+ *
+ * The text compiles to a flat postfix program, evaluated over runs of records a batch at
+ * a time: each instruction goes through the whole batch before the next one, which keeps
+ * the inner loops free of branches on the query.
+ * Signals are copied out of the DBC files when the text compiles, a query never points into
+ * them and its copies can be evaluated on other threads while the files are edited or unloaded.
+ */
+class CANFrameQuery
+{
+public:
+    CANFrameQuery();
+
+    /**
+     * @brief compile replaces the program of the query
+     * @param pText: an empty text selects everything
+     * @param pDbc_p: where signal names are looked up, may be NULL
+     * @param pError_p: set to a description of the problem when the text does not compile
+     * @return false if the text does not compile, the previous program is kept then
+     * @note signals are resolved here, the model compiles the text again on DBCHandler::filesChanged()
+     */
+    bool compile(const QString& pText, DBCHandler* pDbc_p, QString* pError_p);
+    void clear();
+
+    QString text() const;
+    /* true when the query selects every frame */
+    bool isEmpty() const;
+    /* true when the query compares frames to the previous one of their ID */
+    bool usesHistory() const;
+    bool usesTime() const;
+
+    /* subtracted from the stored timestamps before they are compared, see CANFrameStore::setTimeOffset() */
+    void setTimeOffset(uint64_t pOffset);
+
+    /**
+     * @brief matches evaluates a single frame
+     * @param pPrev_p: previous frame with the same ID, NULL if there is none
+     */
+    bool matches(const CANFrameRecord& pRec, const CANFrameRecord* pPrev_p) const;
+
+    /**
+     * @brief filter evaluates a run of records
+     * @param pRecs: the records, see CANFrameStore::contiguous()
+     * @param pFirst: index of pRecs[0], matching records are appended to pRows_p as pFirst + i
+     * @param pHistory_p: last frame of each ID seen so far, updated with the last frames of the run.
+     * Only used when usesHistory(), may be NULL otherwise
+     * @param pPending_p: NULL when the run follows the frames of pHistory_p. Otherwise the frames
+     * before the run are unknown and the first frame of each ID in the run is appended here
+     * instead of being evaluated, for the caller to do with matches() once it knows the previous frame
+     */
+    void filter(const CANFrameRecord* pRecs, int pCount, int pFirst, QHash<quint32, CANFrameRecord>* pHistory_p,
+                QVector<quint32>* pRows_p, QVector<quint32>* pPending_p) const;
+
+private:
+    enum OpCode
+    {
+        OP_CONST,   //pushes lo
+        OP_TEST,    //pushes lo <= field <= hi
+        OP_CHANGED, //pushes field != field of the previous frame
+        OP_AND,
+        OP_OR,
+        OP_NOT
+    };
+
+    enum Field
+    {
+        FIELD_ID,
+        FIELD_BUS,
+        FIELD_LEN,
+        FIELD_DIR,
+        FIELD_EXT,
+        FIELD_BYTE,
+        FIELD_TIME,
+        FIELD_SIGNAL
+    };
+
+    struct Op
+    {
+        quint8 code;
+        quint8 field;
+        quint8 byte;        //FIELD_BYTE
+        quint8 shift;       //integer fields are compared as (value >> shift) & mask
+        quint64 mask;
+        quint64 lo;
+        quint64 span;       //hi - lo
+        double dlo;         //FIELD_SIGNAL, inclusive bounds
+        double dhi;
+        int sig;            //FIELD_SIGNAL, index in mSignals
+    };
+
+    /* what decoding a signal takes, see DBC_SIGNAL::processAsDouble() */
+    struct SignalDef
+    {
+        quint32 id;         //ID of the message of the signal
+        int bus;            //bus of its DBC file, -1 for all
+        int valType;        //DBC_SIG_VAL_TYPE
+        int startBit;
+        int size;
+        bool intel;
+        double factor;
+        double bias;
+        int mux;            //index of the multiplexor of the message if the signal is multiplexed, -1 otherwise
+        int muxValue;
+    };
+
+    QString     mText;
+    QVector<Op> mProgram;
+    QVector<SignalDef> mSignals;
+    int         mDepth;     //stack depth needed by mProgram
+    bool        mHistory;
+    bool        mTime;
+    uint64_t    mTimeOffset;
+
+    void evalBatch(const CANFrameRecord* pRecs, const CANFrameRecord* const* pPrev, int pCount, quint8* pOut) const;
+    void test(const Op& pOp, const CANFrameRecord* pRecs, int pCount, quint8* pOut) const;
+    void changed(const Op& pOp, const CANFrameRecord* pRecs, const CANFrameRecord* const* pPrev, int pCount, quint8* pOut) const;
+    bool decodeSignal(int pSig, const CANFrameRecord& pRec, double* pValue_p) const;
+
+    friend class CANQueryParser;
+};
+
+#endif // CANFRAMEQUERY_H
@@ -0,0 +1,306 @@
+#include "canframestore.h"
+
+
+CANFrameStore::CANFrameStore() :
+    mEvicted(0),
+    mTimeOffset(0)
+{
+}
+
+CANFrameStore::~CANFrameStore()
+{
+}
+
+int CANFrameStore::count() const
+{
+    return mRecords.count();
+}
+
+CANFrame CANFrameStore::at(int pIdx) const
+{
+    CANFrame frame = mRecords.at(pIdx).toFrame();
+    frame.timestamp -= mTimeOffset;
+    return frame;
+}
+
+const CANFrameRecord& CANFrameStore::record(int pIdx) const
+{
+    return mRecords.at(pIdx);
+}
+
+const CANFrameRecord* CANFrameStore::contiguous(int pIdx, int* pLen_p) const
+{
+    return mRecords.contiguous(pIdx, pLen_p);
+}
+
+void CANFrameStore::append(const CANFrame& pFrame)
+{
+    mRecords.append(CANFrameRecord::fromFrame(pFrame));
+}
+
+void CANFrameStore::append(const CANFrameRecord& pRecord)
+{
+    mRecords.append(pRecord);
+}
+
+void CANFrameStore::append(const QVector<CANFrame>& pFrames)
+{
+    for (int i = 0; i < pFrames.count(); i++)
+        mRecords.append(CANFrameRecord::fromFrame(pFrames[i]));
+}
+
+void CANFrameStore::reserve(int pCount)
+{
+    mRecords.reserve(pCount);
+}
+
+void CANFrameStore::replace(int pIdx, const CANFrame& pFrame)
+{
+    mRecords[pIdx] = CANFrameRecord::fromFrame(pFrame);
+}
+
+void CANFrameStore::replace(int pIdx, const CANFrameRecord& pRecord)
+{
+    mRecords[pIdx] = pRecord;
+}
+
+void CANFrameStore::setTimestamp(int pIdx, uint64_t pTimestamp)
+{
+    mRecords[pIdx].timestamp = pTimestamp;
+}
+
+void CANFrameStore::removeLast()
+{
+    mRecords.removeLast();
+}
+
+void CANFrameStore::squeeze()
+{
+    mRecords.squeeze();
+}
+
+void CANFrameStore::clear()
+{
+    mRecords.clear();
+    mEvicted = 0;
+}
+
+void CANFrameStore::removeFirst(int pNum)
+{
+    mRecords.removeFirst(pNum);
+    mEvicted += pNum;
+}
+
+quint64 CANFrameStore::evictedCount() const
+{
+    return mEvicted;
+}
+
+void CANFrameStore::setTimeOffset(uint64_t pOffset)
+{
+    mTimeOffset = pOffset;
+}
+
+uint64_t CANFrameStore::timeOffset() const
+{
+    return mTimeOffset;
+}
+
+void CANFrameStore::setAllocator(const QSharedPointer<BlockAllocator>& pAlloc)
+{
+    mRecords.setAllocator(pAlloc);
+    mEvicted = 0;
+}
+
+QSharedPointer<BlockAllocator> CANFrameStore::allocator() const
+{
+    return mRecords.allocator();
+}
+
+qint64 CANFrameStore::memoryUsage() const
+{
+    return mRecords.memoryUsage();
+}
+
+CANFrameSnapshot CANFrameStore::snapshot() const
+{
+    CANFrameSnapshot snap;
+    snap.mRecords = mRecords;
+    snap.mEvicted = mEvicted;
+    snap.mTimeOffset = mTimeOffset;
+    return snap;
+}
+
+
+CANFrameIndexView::CANFrameIndexView(const CANFrameStore* pStore_p) :
+    mStore_p(pStore_p)
+{
+}
+
+CANFrameIndexView::~CANFrameIndexView()
+{
+}
+
+int CANFrameIndexView::count() const
+{
+    return mIndices.count();
+}
+
+CANFrame CANFrameIndexView::at(int pIdx) const
+{
+    return mStore_p->at(sourceIndex(pIdx));
+}
+
+const CANFrameRecord& CANFrameIndexView::record(int pIdx) const
+{
+    return mStore_p->record(sourceIndex(pIdx));
+}
+
+int CANFrameIndexView::sourceIndex(int pIdx) const
+{
+    return (quint32) (mIndices.at(pIdx) - (quint32) mStore_p->evictedCount());
+}
+
+int CANFrameIndexView::rowOf(int pSourceIdx) const
+{
+    int low = 0;
+    int high = mIndices.count() - 1;
+
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        int src = sourceIndex(mid);
+        if (src == pSourceIdx) return mid;
+        if (src < pSourceIdx) low = mid + 1;
+        else high = mid - 1;
+    }
+    return -1;
+}
+
+int CANFrameIndexView::rowAtOrBefore(int pSourceIdx) const
+{
+    int low = 0;
+    int high = mIndices.count() - 1;
+    int best = -1;
+
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        if (sourceIndex(mid) <= pSourceIdx)
+        {
+            best = mid;
+            low = mid + 1;
+        }
+        else high = mid - 1;
+    }
+    return best;
+}
+
+void CANFrameIndexView::append(int pSourceIdx)
+{
+    mIndices.append((quint32) (pSourceIdx + mStore_p->evictedCount()));
+}
+
+void CANFrameIndexView::reserve(int pCount)
+{
+    mIndices.reserve(pCount);
+}
+
+void CANFrameIndexView::setAllocator(const QSharedPointer<BlockAllocator>& pAlloc)
+{
+    mIndices.setAllocator(pAlloc);
+}
+
+QSharedPointer<BlockAllocator> CANFrameIndexView::allocator() const
+{
+    return mIndices.allocator();
+}
+
+void CANFrameIndexView::swap(CANFrameIndexView& pOther)
+{
+    Q_ASSERT(mStore_p == pOther.mStore_p);
+    mIndices.swap(pOther.mIndices);
+}
+
+int CANFrameIndexView::dropEvicted()
+{
+    quint32 evicted = (quint32) mStore_p->evictedCount();
+    int num = 0;
+
+    /* a negative distance means the frame was evicted */
+    while (num < mIndices.count() && (qint32) (mIndices.at(num) - evicted) < 0)
+        num++;
+
+    if (num) mIndices.removeFirst(num);
+    return num;
+}
+
+void CANFrameIndexView::clear()
+{
+    mIndices.clear();
+}
+
+qint64 CANFrameIndexView::memoryUsage() const
+{
+    return mIndices.memoryUsage();
+}
+
+CANFrameSnapshot CANFrameIndexView::snapshot() const
+{
+    CANFrameSnapshot snap = mStore_p->snapshot();
+    snap.mIndices = mIndices;
+    snap.mView = true;
+    return snap;
+}
+
+
+CANFrameSnapshot::CANFrameSnapshot() :
+    mView(false),
+    mEvicted(0),
+    mTimeOffset(0)
+{
+}
+
+CANFrameSnapshot::~CANFrameSnapshot()
+{
+}
+
+int CANFrameSnapshot::count() const
+{
+    return mView ? mIndices.count() : mRecords.count();
+}
+
+CANFrame CANFrameSnapshot::at(int pIdx) const
+{
+    CANFrame frame = record(pIdx).toFrame();
+    frame.timestamp -= mTimeOffset;
+    return frame;
+}
+
+const CANFrameRecord& CANFrameSnapshot::record(int pIdx) const
+{
+    return mRecords.at(sourceIndex(pIdx));
+}
+
+int CANFrameSnapshot::sourceIndex(int pIdx) const
+{
+    if (!mView) return pIdx;
+    return (quint32) (mIndices.at(pIdx) - (quint32) mEvicted);
+}
+
+const CANFrameRecord* CANFrameSnapshot::contiguous(int pIdx, int* pLen_p) const
+{
+    if (!mView) return mRecords.contiguous(pIdx, pLen_p);
+    *pLen_p = 1;
+    return &record(pIdx);
+}
+
+quint64 CANFrameSnapshot::evictedCount() const
+{
+    return mEvicted;
+}
+
+uint64_t CANFrameSnapshot::timeOffset() const
+{
+    return mTimeOffset;
+}
@@ -0,0 +1,445 @@
+#ifndef CANFRAMESTORE_H
+#define CANFRAMESTORE_H
+
+#include <QVector>
+#include <QSharedData>
+#include <QSharedPointer>
+#include <new>
+#include <string.h>
+#include "can_structs.h"
+
+#define STORE_BLOCK_BITS    16
+#define STORE_BLOCK_SIZE    (1 << STORE_BLOCK_BITS)
+#define STORE_BLOCK_MASK    (STORE_BLOCK_SIZE - 1)
+
+/*
+ * Source of the blocks of a SegmentedVector when they should not come from the heap,
+ * see MappedFileAllocator. Blocks can be released from any thread.
+ */
+class BlockAllocator
+{
+public:
+    virtual ~BlockAllocator() {}
+    /* throws std::bad_alloc like new does when no memory is left */
+    virtual void* allocate(qint64 pBytes) = 0;
+    virtual void release(void* pBlock_p) = 0;
+};
+
+/* block of a SegmentedVector, shared with the copies of the vector that still see it */
+template <typename T>
+class SegmentBlock : public QSharedData
+{
+public:
+    explicit SegmentBlock(const QSharedPointer<BlockAllocator>& pAlloc) : mAlloc(pAlloc)
+    {
+        if (mAlloc)
+        {
+            data = static_cast<T*>(mAlloc->allocate((qint64) STORE_BLOCK_SIZE * sizeof(T)));
+            if (!data) throw std::bad_alloc();
+        }
+        else data = new T[STORE_BLOCK_SIZE];
+    }
+
+    ~SegmentBlock()
+    {
+        if (mAlloc) mAlloc->release(data);
+        else delete[] data;
+    }
+
+    T* data;
+
+private:
+    Q_DISABLE_COPY(SegmentBlock)
+
+    QSharedPointer<BlockAllocator> mAlloc; //stays around as long as one of its blocks does
+};
+
+/*
+ * Growable array made of fixed size blocks of STORE_BLOCK_SIZE elements.
+ * Growing allocates a new block, elements are never moved so their addresses stay valid
+ * and memory follows the number of elements instead of a preallocation.
+ * Elements can also be dropped from the front, which makes it usable as a ring:
+ * a block is released once all its elements are gone and kept aside for the next append.
+ * Blocks come from the heap unless an allocator is set.
+ * Meant for plain data types, elements are not constructed nor destroyed.
+ *
+ * Copies share the blocks, they are made in O(number of blocks) and are read only.
+ * Blocks are reference counted: appending to, dropping from or clearing the original does
+ * not touch what a copy sees, and writing an element a copy can see copies its block first.
+ * A copy can therefore be read from another thread without a lock while the original keeps
+ * changing, as long as it was made under the lock that protects the original.
+ */
+template <typename T>
+class SegmentedVector
+{
+public:
+    SegmentedVector() : mFirst(0), mCount(0), mReadOnly(false) {}
+
+    SegmentedVector(const SegmentedVector& pOther) :
+        mBlocks(pOther.mBlocks),
+        mFirst(pOther.mFirst),
+        mCount(pOther.mCount),
+        mAlloc(pOther.mAlloc),
+        mReadOnly(true)
+    {
+        shareBlocks(pOther);
+    }
+
+    SegmentedVector& operator=(const SegmentedVector& pOther)
+    {
+        if (this == &pOther) return *this;
+        clear();
+        mBlocks = pOther.mBlocks;
+        mFirst = pOther.mFirst;
+        mCount = pOther.mCount;
+        mAlloc = pOther.mAlloc;
+        mReadOnly = true;
+        shareBlocks(pOther);
+        return *this;
+    }
+
+    /* the vector is cleared, blocks allocated from then on come from pAlloc */
+    void setAllocator(const QSharedPointer<BlockAllocator>& pAlloc)
+    {
+        clear();
+        mAlloc = pAlloc;
+    }
+
+    QSharedPointer<BlockAllocator> allocator() const { return mAlloc; }
+
+    int count() const { return mCount; }
+
+    const T& at(int pIdx) const
+    {
+        int pos = pIdx + mFirst;
+        return mBlocks.at(pos >> STORE_BLOCK_BITS)[pos & STORE_BLOCK_MASK];
+    }
+
+    /* elements from pIdx to the end of its block are contiguous, *pLen_p tells how many */
+    const T* contiguous(int pIdx, int* pLen_p) const
+    {
+        int pos = pIdx + mFirst;
+        int len = STORE_BLOCK_SIZE - (pos & STORE_BLOCK_MASK);
+        *pLen_p = qMin(len, mCount - pIdx);
+        return mBlocks.at(pos >> STORE_BLOCK_BITS) + (pos & STORE_BLOCK_MASK);
+    }
+
+    T& operator[](int pIdx)
+    {
+        int pos = pIdx + mFirst;
+        detachBlock(pos >> STORE_BLOCK_BITS);
+        return mBlocks[pos >> STORE_BLOCK_BITS][pos & STORE_BLOCK_MASK];
+    }
+
+    /* copies only see the elements below their count, appending never writes one of those */
+    void append(const T& pVal)
+    {
+        Q_ASSERT(!mReadOnly);
+        int pos = mFirst + mCount;
+        if ((pos >> STORE_BLOCK_BITS) >= mBlocks.count()) addBlock();
+        mBlocks.at(pos >> STORE_BLOCK_BITS)[pos & STORE_BLOCK_MASK] = pVal;
+        mCount++;
+    }
+
+    /* allocates the blocks for up to pCount elements ahead of time, appending up to there won't allocate */
+    void reserve(int pCount)
+    {
+        while (((qint64) mBlocks.count() << STORE_BLOCK_BITS) < (qint64) mFirst + pCount) addBlock();
+    }
+
+    void removeLast()
+    {
+        mCount--;
+        //the next append goes there, a copy may still see the element
+        detachBlock((mFirst + mCount) >> STORE_BLOCK_BITS);
+    }
+
+    /* drops the pNum first elements */
+    void removeFirst(int pNum)
+    {
+        mFirst += pNum;
+        mCount -= pNum;
+        while (mFirst >= STORE_BLOCK_SIZE)
+        {
+            mBlocks.removeFirst();
+            BlockRef block = mOwners.takeFirst();
+            //a block a copy still reads is released with the copy
+            if (!mSpare && block->ref.loadAcquire() == 1) mSpare = block;
+            mFirst -= STORE_BLOCK_SIZE;
+        }
+    }
+
+    void clear()
+    {
+        mBlocks.clear();
+        mOwners.clear();
+        mSpare.reset();
+        mFirst = 0;
+        mCount = 0;
+    }
+
+    /* frees the blocks left unused after removeLast() or removeFirst() */
+    void squeeze()
+    {
+        int used = (mFirst + mCount + STORE_BLOCK_MASK) >> STORE_BLOCK_BITS;
+        while (mBlocks.count() > used)
+        {
+            mBlocks.removeLast();
+            mOwners.removeLast();
+        }
+        mSpare.reset();
+    }
+
+    void swap(SegmentedVector& pOther)
+    {
+        mBlocks.swap(pOther.mBlocks);
+        mOwners.swap(pOther.mOwners);
+        qSwap(mFirst, pOther.mFirst);
+        qSwap(mCount, pOther.mCount);
+        qSwap(mSpare, pOther.mSpare);
+        qSwap(mAlloc, pOther.mAlloc);
+        qSwap(mReadOnly, pOther.mReadOnly);
+    }
+
+    qint64 memoryUsage() const
+    {
+        return (qint64) (mBlocks.count() + (mSpare ? 1 : 0)) * STORE_BLOCK_SIZE * sizeof(T);
+    }
+
+private:
+    typedef QExplicitlySharedDataPointer<SegmentBlock<T> > BlockRef;
+
+    //each copy holds its own references, the blocks are freed with the last of them
+    void shareBlocks(const SegmentedVector& pOther)
+    {
+        mOwners.reserve(pOther.mOwners.count());
+        for (int i = 0; i < pOther.mOwners.count(); i++) mOwners.append(pOther.mOwners.at(i));
+    }
+
+    void addBlock()
+    {
+        BlockRef block = mSpare;
+        mSpare.reset();
+        if (!block) block = BlockRef(new SegmentBlock<T>(mAlloc));
+        mBlocks.append(block->data);
+        mOwners.append(block);
+    }
+
+    //gives the block its own memory if a copy shares it
+    void detachBlock(int pBlock)
+    {
+        if (pBlock >= mOwners.count() || mOwners.at(pBlock)->ref.loadAcquire() == 1) return;
+        BlockRef block(new SegmentBlock<T>(mAlloc));
+        memcpy(block->data, mBlocks.at(pBlock), STORE_BLOCK_SIZE * sizeof(T));
+        mBlocks[pBlock] = block->data;
+        mOwners[pBlock] = block;
+    }
+
+    QVector<T*>         mBlocks;    //data of the blocks in mOwners, for the lookups
+    QVector<BlockRef>   mOwners;
+    int                 mFirst;     //position of element 0 in the first block
+    int                 mCount;
+    BlockRef            mSpare;     //released block waiting to be reused
+    QSharedPointer<BlockAllocator> mAlloc;
+    bool                mReadOnly;  //copies can't be appended to
+};
+
+
+/*
+ * Read only copy of a CANFrameStore, or of a CANFrameIndexView and its store, as they were
+ * when it was taken. Nothing is copied but the block tables: the snapshot shares the blocks
+ * and keeps them allocated until it goes away, whatever happens to the store in the meantime
+ * (appends, evictions, clear, another allocator). It can be read from any thread without a
+ * lock, which is how the long scans run while the capture keeps growing.
+ * Copying a snapshot is cheap as well.
+ */
+class CANFrameSnapshot : public CANFrameList
+{
+public:
+    CANFrameSnapshot();
+    virtual ~CANFrameSnapshot();
+
+    virtual int count() const;
+    /* with the time offset the store had when the snapshot was taken */
+    virtual CANFrame at(int pIdx) const;
+
+    const CANFrameRecord& record(int pIdx) const;
+
+    /**
+     * @brief sourceIndex
+     * @param pIdx: row of the snapshot
+     * @return index of the frame in the store when the snapshot was taken
+     */
+    int sourceIndex(int pIdx) const;
+
+    /* see CANFrameStore::contiguous(), runs of a view snapshot are single records */
+    const CANFrameRecord* contiguous(int pIdx, int* pLen_p) const;
+
+    /* CANFrameStore::evictedCount() when the snapshot was taken, gives how far the store moved since */
+    quint64 evictedCount() const;
+    uint64_t timeOffset() const;
+
+private:
+    friend class CANFrameStore;
+    friend class CANFrameIndexView;
+
+    SegmentedVector<CANFrameRecord> mRecords;
+    SegmentedVector<quint32>        mIndices;   //serials of the selected frames, for a view
+    bool                            mView;
+    quint64                         mEvicted;
+    uint64_t                        mTimeOffset;
+};
+
+
+/*
+ * Storage of a capture. Frames are kept as packed CANFrameRecord and converted
+ * to CANFrame when they are read through the CANFrameList interface.
+ * Records keep the timestamps as captured, the time offset is only applied by at().
+ */
+class CANFrameStore : public CANFrameList
+{
+public:
+    CANFrameStore();
+    virtual ~CANFrameStore();
+
+    virtual int count() const;
+    virtual CANFrame at(int pIdx) const;
+
+    /* direct access to the stored record, no conversion and no time offset */
+    const CANFrameRecord& record(int pIdx) const;
+
+    /**
+     * @brief contiguous gives direct access to a run of records, for bulk processing
+     * @param pIdx: first record
+     * @param pLen_p: set to the number of records that follow in memory, at least 1
+     * @note the records stay in place while frames are appended, they are only released
+     * by removeFirst(), removeLast()/squeeze() and clear(). Use snapshot() to keep them longer
+     */
+    const CANFrameRecord* contiguous(int pIdx, int* pLen_p) const;
+
+    void append(const CANFrame& pFrame);
+    void append(const CANFrameRecord& pRecord);
+    void append(const QVector<CANFrame>& pFrames);
+    /* makes room for pCount frames in total, see SegmentedVector::reserve() */
+    void reserve(int pCount);
+    void replace(int pIdx, const CANFrame& pFrame);
+    void replace(int pIdx, const CANFrameRecord& pRecord);
+    void setTimestamp(int pIdx, uint64_t pTimestamp);
+    void removeLast();
+    void squeeze();
+    void clear();
+
+    /**
+     * @brief removeFirst drops the oldest frames, used when the capture is bounded
+     * @param pNum: number of frames to drop
+     */
+    void removeFirst(int pNum);
+
+    /**
+     * @brief evictedCount
+     * @return number of frames dropped with removeFirst() since the last clear()
+     */
+    quint64 evictedCount() const;
+
+    /**
+     * @brief setTimeOffset makes the timestamps handed out by at() relative, in O(1)
+     * @param pOffset: subtracted from the stored timestamps, 0 gives them back as captured
+     * @note kept across clear()
+     */
+    void setTimeOffset(uint64_t pOffset);
+    uint64_t timeOffset() const;
+
+    /**
+     * @brief setAllocator clears the store and takes its blocks from pAlloc from then on
+     * @param pAlloc: null to go back to the heap. The allocator lives as long as one of its blocks
+     */
+    void setAllocator(const QSharedPointer<BlockAllocator>& pAlloc);
+    QSharedPointer<BlockAllocator> allocator() const;
+
+    /**
+     * @brief memoryUsage
+     * @return the number of bytes allocated for the frames
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief snapshot frozen copy of the frames held right now, see CANFrameSnapshot
+     * @note O(number of blocks), take it under the lock that protects the store
+     */
+    CANFrameSnapshot snapshot() const;
+
+private:
+    Q_DISABLE_COPY(CANFrameStore)
+
+    SegmentedVector<CANFrameRecord> mRecords;
+    quint64                         mEvicted;
+    uint64_t                        mTimeOffset;
+};
+
+
+/*
+ * Subset of a CANFrameStore, kept as the indices of the selected frames.
+ * The frames themselves are never copied, changing the selection only rewrites indices.
+ * Indices are counted from the last clear() of the store (modulo 2^32) so they stay
+ * valid when the store drops its oldest frames, dropEvicted() then removes the
+ * selected frames that are gone.
+ */
+class CANFrameIndexView : public CANFrameList
+{
+public:
+    explicit CANFrameIndexView(const CANFrameStore* pStore_p);
+    virtual ~CANFrameIndexView();
+
+    virtual int count() const;
+    virtual CANFrame at(int pIdx) const;
+
+    const CANFrameRecord& record(int pIdx) const;
+
+    /**
+     * @brief sourceIndex
+     * @param pIdx: row in the view
+     * @return index of the frame in the store
+     */
+    int sourceIndex(int pIdx) const;
+
+    /**
+     * @brief rowOf finds a frame in the view, O(log n)
+     * @param pSourceIdx: index of the frame in the store
+     * @return row of the frame in the view or -1 if it is not selected
+     * @note requires the selection to be in store order, which is how the model builds it
+     */
+    int rowOf(int pSourceIdx) const;
+
+    /**
+     * @brief rowAtOrBefore finds the last selected frame up to a frame of the store, O(log n)
+     * @param pSourceIdx: index of the frame in the store
+     * @return row of the frame, or of the closest selected frame before it, -1 if there is none
+     */
+    int rowAtOrBefore(int pSourceIdx) const;
+
+    void append(int pSourceIdx);
+    void reserve(int pCount);
+    /* see CANFrameStore::setAllocator() */
+    void setAllocator(const QSharedPointer<BlockAllocator>& pAlloc);
+    QSharedPointer<BlockAllocator> allocator() const;
+    /* exchanges the selections of two views of the same store */
+    void swap(CANFrameIndexView& pOther);
+    void clear();
+
+    /**
+     * @brief dropEvicted removes the frames the store does not hold anymore
+     * @return number of rows removed from the front of the view
+     */
+    int dropEvicted();
+
+    qint64 memoryUsage() const;
+
+    /* frozen copy of the selected frames, see CANFrameStore::snapshot() */
+    CANFrameSnapshot snapshot() const;
+
+private:
+    const CANFrameStore*    mStore_p;
+    SegmentedVector<quint32> mIndices;
+};
+
+#endif // CANFRAMESTORE_H
@@ -0,0 +1,144 @@
+#include "canframetimeindex.h"
+
+#include <algorithm>
+
+
+CANFrameTimeIndex::CANFrameTimeIndex(const CANFrameStore* pStore_p) :
+    mStore_p(pStore_p)
+{
+    clear();
+}
+
+CANFrameTimeIndex::~CANFrameTimeIndex()
+{
+    qDeleteAll(mIds);
+}
+
+void CANFrameTimeIndex::setAllocator(const QSharedPointer<BlockAllocator>& pAlloc)
+{
+    mAlloc = pAlloc;
+    clear();
+}
+
+void CANFrameTimeIndex::clear()
+{
+    qDeleteAll(mIds);
+    mIds.clear();
+    mSteps.clear();
+    mStepSerial = 0;
+    mLatest = 0;
+    mEvictedAtBuild = mStore_p->evictedCount();
+}
+
+void CANFrameTimeIndex::rebuild()
+{
+    clear();
+    for (int i = 0; i < mStore_p->count(); i++) add(i);
+}
+
+void CANFrameTimeIndex::append(int pIdx)
+{
+    //once most entries point at evicted frames it is cheaper to start over, which indexes pIdx too
+    if (mStore_p->evictedCount() - mEvictedAtBuild > (quint64) mStore_p->count())
+    {
+        rebuild();
+        return;
+    }
+    add(pIdx);
+}
+
+void CANFrameTimeIndex::add(int pIdx)
+{
+    const CANFrameRecord& rec = mStore_p->record(pIdx);
+    quint32 serial = (quint32) (pIdx + mStore_p->evictedCount());
+
+    IdTimes*& times = mIds[rec.ID];
+    if (!times)
+    {
+        times = new IdTimes;
+        times->serials.setAllocator(mAlloc);
+        times->sorted = true;
+    }
+    else if (rec.timestamp < times->latest) times->sorted = false;
+    times->latest = rec.timestamp;
+    times->serials.append(serial);
+
+    if (rec.timestamp > mLatest) mLatest = rec.timestamp;
+    if ((serial & TIME_INDEX_STEP_MASK) == 0)
+    {
+        if (mSteps.isEmpty()) mStepSerial = serial;
+        mSteps.append(mLatest);
+    }
+}
+
+//negative for an evicted frame
+int CANFrameTimeIndex::sourceIndex(quint32 pSerial) const
+{
+    return (qint32) (pSerial - (quint32) mStore_p->evictedCount());
+}
+
+int CANFrameTimeIndex::find(quint32 pId, uint64_t pTimestamp) const
+{
+    QHash<quint32, IdTimes*>::const_iterator it = mIds.constFind(pId);
+    if (it == mIds.constEnd()) return -1;
+
+    const SegmentedVector<quint32>& serials = it.value()->serials;
+
+    //serials grow with the position in the store, the evicted frames come first
+    int low = 0;
+    int high = serials.count();
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (sourceIndex(serials.at(mid)) < 0) low = mid + 1;
+        else high = mid;
+    }
+    int live = low;
+
+    int pos;
+    if (it.value()->sorted)
+    {
+        //first entry after pTimestamp, the timestamps are read from the store
+        high = serials.count();
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (mStore_p->record(sourceIndex(serials.at(mid))).timestamp <= pTimestamp) low = mid + 1;
+            else high = mid;
+        }
+        pos = low - 1;
+    }
+    else
+    {
+        for (pos = serials.count() - 1; pos >= live; pos--)
+        {
+            if (mStore_p->record(sourceIndex(serials.at(pos))).timestamp <= pTimestamp) break;
+        }
+    }
+    if (pos < live) return -1;
+
+    return sourceIndex(serials.at(pos));
+}
+
+int CANFrameTimeIndex::findTime(uint64_t pTimestamp) const
+{
+    int count = mStore_p->count();
+    if (count == 0) return -1;
+
+    //first step already past pTimestamp, the answer lies between the previous step and this one
+    int step = std::upper_bound(mSteps.constBegin(), mSteps.constEnd(), pTimestamp) - mSteps.constBegin();
+    int first = 0;
+    uint64_t latest = 0;
+    if (step > 0)
+    {
+        first = qMax(0, sourceIndex(mStepSerial + ((quint32) (step - 1) << TIME_INDEX_STEP_BITS)) + 1);
+        latest = mSteps.at(step - 1);
+    }
+
+    for (int i = first; i < count; i++)
+    {
+        if (mStore_p->record(i).timestamp > latest) latest = mStore_p->record(i).timestamp;
+        if (latest > pTimestamp) return i - 1;
+    }
+    return count - 1;
+}
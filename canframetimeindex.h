@@ -0,0 +1,74 @@
+#ifndef CANFRAMETIMEINDEX_H
+#define CANFRAMETIMEINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include "canframestore.h"
+
+#define TIME_INDEX_STEP_BITS    10
+#define TIME_INDEX_STEP         (1 << TIME_INDEX_STEP_BITS)
+#define TIME_INDEX_STEP_MASK    (TIME_INDEX_STEP - 1)
+
+/*
+ * Time index of a CANFrameStore, finds the frame shown at a given time in O(log n)
+ * instead of scanning the capture.
+ * Each ID keeps the position of its frames in the store, the binary search reads their
+ * timestamps from the store, and a coarse table keeps the latest timestamp seen every
+ * TIME_INDEX_STEP frames for lookups on time only. That is 4 bytes per frame, in blocks
+ * that come from the allocator of the index so they spill to disk along with the capture.
+ * Positions are counted like in CANFrameIndexView so they survive evictions, the entries of
+ * evicted frames are purged once there are more of them than frames left in the store.
+ * Captures come in mostly in time order. An ID receiving a frame older than its previous
+ * one is searched linearly from then on.
+ */
+class CANFrameTimeIndex
+{
+public:
+    explicit CANFrameTimeIndex(const CANFrameStore* pStore_p);
+    ~CANFrameTimeIndex();
+
+    /* the index is cleared, the per ID blocks allocated from then on come from pAlloc */
+    void setAllocator(const QSharedPointer<BlockAllocator>& pAlloc);
+
+    /* indexes the frame just appended to the store at pIdx */
+    void append(int pIdx);
+    /* indexes the whole store again, after its timestamps were rewritten */
+    void rebuild();
+    void clear();
+
+    /**
+     * @brief find
+     * @param pId: frame ID
+     * @param pTimestamp: as stored in the records, without the time offset of the store
+     * @return index in the store of the last frame of pId at or before pTimestamp, -1 if none
+     */
+    int find(quint32 pId, uint64_t pTimestamp) const;
+
+    /**
+     * @brief findTime looks for a time regardless of the ID
+     * @param pTimestamp
+     * @return index in the store of the frame preceding the first frame after pTimestamp, -1 if none
+     */
+    int findTime(uint64_t pTimestamp) const;
+
+private:
+    struct IdTimes
+    {
+        SegmentedVector<quint32> serials;   //index in the store plus its evicted count, modulo 2^32
+        bool sorted;
+        uint64_t latest;                    //timestamp of the last frame appended
+    };
+
+    int sourceIndex(quint32 pSerial) const;
+    void add(int pIdx);
+
+    const CANFrameStore*        mStore_p;
+    QHash<quint32, IdTimes*>    mIds;
+    QVector<uint64_t>           mSteps;         //latest timestamp up to each step frame
+    quint32                     mStepSerial;    //serial of the frame of mSteps[0]
+    uint64_t                    mLatest;
+    quint64                     mEvictedAtBuild;
+    QSharedPointer<BlockAllocator> mAlloc;
+};
+
+#endif // CANFRAMETIMEINDEX_H
@@ -0,0 +1,66 @@
+#include "canidcatalog.h"
+
+
+CANIdCatalog::CANIdCatalog()
+{
+}
+
+void CANIdCatalog::add(const CANFrameRecord& pRec)
+{
+    QHash<quint32, int>::const_iterator it = mIndex.constFind(pRec.ID);
+    CANIdInfo* info_p;
+
+    if (it == mIndex.constEnd())
+    {
+        mIndex.insert(pRec.ID, mInfos.count());
+        CANIdInfo info;
+        info.id = pRec.ID;
+        info.count = 0;
+        info.dlcMask = 0;
+        info.firstSeen = pRec.timestamp;
+        info.lastSeen = pRec.timestamp;
+        mInfos.append(info);
+        info_p = &mInfos.last();
+    }
+    else info_p = &mInfos[it.value()];
+
+    info_p->count++;
+    if (info_p->busCounts.count() <= pRec.bus) info_p->busCounts.resize(pRec.bus + 1);
+    info_p->busCounts[pRec.bus]++;
+    info_p->dlcMask |= 1u << pRec.len;
+    if (pRec.timestamp < info_p->firstSeen) info_p->firstSeen = pRec.timestamp;
+    if (pRec.timestamp > info_p->lastSeen) info_p->lastSeen = pRec.timestamp;
+}
+
+void CANIdCatalog::remove(const CANFrameRecord& pRec)
+{
+    QHash<quint32, int>::const_iterator it = mIndex.constFind(pRec.ID);
+    if (it == mIndex.constEnd()) return;
+
+    CANIdInfo& info = mInfos[it.value()];
+    if (info.count > 0) info.count--;
+    if (pRec.bus < info.busCounts.count() && info.busCounts[pRec.bus] > 0) info.busCounts[pRec.bus]--;
+}
+
+void CANIdCatalog::clear()
+{
+    mInfos.clear();
+    mIndex.clear();
+}
+
+int CANIdCatalog::count() const
+{
+    return mInfos.count();
+}
+
+const CANIdInfo& CANIdCatalog::at(int pIdx) const
+{
+    return mInfos.at(pIdx);
+}
+
+const CANIdInfo* CANIdCatalog::find(quint32 pId) const
+{
+    QHash<quint32, int>::const_iterator it = mIndex.constFind(pId);
+    if (it == mIndex.constEnd()) return NULL;
+    return &mInfos.at(it.value());
+}
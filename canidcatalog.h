@@ -0,0 +1,53 @@
+#ifndef CANIDCATALOG_H
+#define CANIDCATALOG_H
+
+#include <QHash>
+#include <QVector>
+#include "can_structs.h"
+
+/* what a capture holds for one ID */
+struct CANIdInfo
+{
+    quint32 id;
+    quint64 count;              //frames of this ID in the capture
+    QVector<quint64> busCounts; //frames of this ID per bus number
+    quint32 dlcMask;            //bit n set once a frame of length n was seen
+    uint64_t firstSeen;         //stored timestamps, the time offset of the capture is not applied
+    uint64_t lastSeen;          //evictions leave both alone
+};
+
+/*
+ * Per ID statistics of a capture, updated as frames are added and evicted so the
+ * analysis windows don't have to scan the capture to find out which IDs it holds.
+ * IDs are kept in order of first appearance and stay listed until clear(), with a
+ * count of 0 once all their frames were evicted. Callers remember count() to pick up
+ * the IDs added since they last looked.
+ */
+class CANIdCatalog
+{
+public:
+    CANIdCatalog();
+
+    void add(const CANFrameRecord& pRec);
+    /* the frame was evicted from the capture */
+    void remove(const CANFrameRecord& pRec);
+    void clear();
+
+    /* number of IDs seen since the last clear() */
+    int count() const;
+
+    /**
+     * @brief at
+     * @param pIdx: 0 for the first ID seen
+     */
+    const CANIdInfo& at(int pIdx) const;
+
+    /* NULL if the ID was never seen */
+    const CANIdInfo* find(quint32 pId) const;
+
+private:
+    QVector<CANIdInfo>  mInfos;
+    QHash<quint32, int> mIndex; //position of each ID in mInfos
+};
+
+#endif // CANIDCATALOG_H
@@ -0,0 +1,152 @@
+#include "canidfilter.h"
+
+#include <string.h>
+
+/* no CAN ID uses the top bits, this one can't collide */
+#define EMPTY_KEY   0xFFFFFFFFu
+
+
+CANIdFilter::CANIdFilter()
+{
+    mHashBits = 0;
+    clear();
+}
+
+bool CANIdFilter::contains(quint32 pId) const
+{
+    if (pId < STD_IDS) return mStdKnown[pId >> 5] & (1u << (pId & 31));
+    return mHashCount && mKeys.at(slot(pId)) == pId;
+}
+
+bool CANIdFilter::isShown(quint32 pId) const
+{
+    if (pId < STD_IDS) return mStdShown[pId >> 5] & (1u << (pId & 31));
+    if (!mHashCount) return false;
+    int idx = slot(pId);
+    return mKeys.at(idx) == pId && mShown.at(idx);
+}
+
+bool CANIdFilter::check(quint32 pId, bool pDefault, bool* pAdded_p)
+{
+    if (pAdded_p) *pAdded_p = false;
+
+    if (pId < STD_IDS)
+    {
+        quint32 bit = 1u << (pId & 31);
+        if (mStdKnown[pId >> 5] & bit) return mStdShown[pId >> 5] & bit;
+    }
+    else
+    {
+        int idx = slot(pId);
+        if (mKeys.at(idx) == pId) return mShown.at(idx);
+    }
+
+    insert(pId, pDefault);
+    if (pAdded_p) *pAdded_p = true;
+    return pDefault;
+}
+
+void CANIdFilter::insert(quint32 pId, bool pShown)
+{
+    mMapValid = false;
+
+    if (pId < STD_IDS)
+    {
+        quint32 bit = 1u << (pId & 31);
+        if (!(mStdKnown[pId >> 5] & bit))
+        {
+            mStdKnown[pId >> 5] |= bit;
+            mStdCount++;
+        }
+        if (pShown) mStdShown[pId >> 5] |= bit;
+        else mStdShown[pId >> 5] &= ~bit;
+        return;
+    }
+
+    int idx = slot(pId);
+    if (mKeys.at(idx) != pId)
+    {
+        /* keep the table at most half full */
+        if ((mHashCount + 1) * 2 > mKeys.count())
+        {
+            grow();
+            idx = slot(pId);
+        }
+        mKeys[idx] = pId;
+        mHashCount++;
+    }
+    mShown[idx] = pShown;
+}
+
+void CANIdFilter::setAll(bool pShown)
+{
+    mMapValid = false;
+    for (int i = 0; i < STD_IDS / 32; i++) mStdShown[i] = pShown ? mStdKnown[i] : 0;
+    mShown.fill(pShown);
+}
+
+void CANIdFilter::clear()
+{
+    memset(mStdKnown, 0, sizeof(mStdKnown));
+    memset(mStdShown, 0, sizeof(mStdShown));
+    mStdCount = 0;
+
+    mHashBits = 6;
+    mKeys.fill(EMPTY_KEY, 1 << mHashBits);
+    mShown.fill(0, 1 << mHashBits);
+    mHashCount = 0;
+
+    mMap.clear();
+    mMapValid = true;
+}
+
+int CANIdFilter::count() const
+{
+    return mStdCount + mHashCount;
+}
+
+const QMap<int, bool>* CANIdFilter::asMap() const
+{
+    if (!mMapValid)
+    {
+        mMap.clear();
+        for (quint32 id = 0; id < STD_IDS; id++)
+        {
+            if (mStdKnown[id >> 5] & (1u << (id & 31))) mMap.insert(id, mStdShown[id >> 5] & (1u << (id & 31)));
+        }
+        for (int i = 0; i < mKeys.count(); i++)
+        {
+            if (mKeys.at(i) != EMPTY_KEY) mMap.insert(mKeys.at(i), mShown.at(i));
+        }
+        mMapValid = true;
+    }
+    return &mMap;
+}
+
+/* slot holding pId, or the free slot where it would go */
+int CANIdFilter::slot(quint32 pId) const
+{
+    int mask = mKeys.count() - 1;
+    int idx = (pId * 0x9E3779B1u) >> (32 - mHashBits);
+
+    while (mKeys.at(idx) != EMPTY_KEY && mKeys.at(idx) != pId)
+        idx = (idx + 1) & mask;
+    return idx;
+}
+
+void CANIdFilter::grow()
+{
+    QVector<quint32> keys = mKeys;
+    QVector<quint8> shown = mShown;
+
+    mHashBits++;
+    mKeys.fill(EMPTY_KEY, 1 << mHashBits);
+    mShown.fill(0, 1 << mHashBits);
+    for (int i = 0; i < keys.count(); i++)
+    {
+        if (keys.at(i) == EMPTY_KEY) continue;
+        int idx = slot(keys.at(i));
+        mKeys[idx] = keys.at(i);
+        mShown[idx] = shown.at(i);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef CANIDFILTER_H
+#define CANIDFILTER_H
+
+#include <QMap>
+#include <QVector>
+#include <stdint.h>
+
+/*
+ * Per ID show/hide state of the frame model, checked for every frame so lookups have to be cheap.
+ * IDs below 2048 live in two bitmaps (known / shown), the others in an open addressing
+ * hash table with linear probing.
+ * asMap() gives the QMap<int, bool> view the GUI and the filter files work with.
+ */
+class CANIdFilter
+{
+public:
+    CANIdFilter();
+
+    bool contains(quint32 pId) const;
+
+    /**
+     * @brief isShown
+     * @return true if frames with this ID pass the filter, false for unknown IDs
+     */
+    bool isShown(quint32 pId) const;
+
+    /**
+     * @brief check looks an ID up and adds it if it is unknown, with a single lookup
+     * @param pId
+     * @param pDefault: state given to an unknown ID
+     * @param pAdded_p: if not NULL, set to true if the ID was added
+     * @return true if frames with this ID pass the filter
+     */
+    bool check(quint32 pId, bool pDefault, bool* pAdded_p = NULL);
+
+    /* adds the ID or changes its state */
+    void insert(quint32 pId, bool pShown);
+    void setAll(bool pShown);
+    void clear();
+    int count() const;
+
+    /* sorted copy of the filters, kept until the next change */
+    const QMap<int, bool>* asMap() const;
+
+private:
+    enum { STD_IDS = 2048 };
+
+    quint32 mStdKnown[STD_IDS / 32];
+    quint32 mStdShown[STD_IDS / 32];
+    int     mStdCount;
+
+    QVector<quint32>    mKeys;      //EMPTY_KEY for free slots, size is a power of 2
+    QVector<quint8>     mShown;
+    int                 mHashCount;
+    int                 mHashBits;
+
+    mutable QMap<int, bool> mMap;
+    mutable bool            mMapValid;
+
+    int slot(quint32 pId) const;
+    void grow();
+};
+
+#endif // CANIDFILTER_H
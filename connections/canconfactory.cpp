@@ -2,12 +2,24 @@
 #include "canconfactory.h"
 #include "serialbusconnection.h"
 #include "gvretserial.h"
+#include "simulatedconnection.h"
+#ifdef Q_OS_LINUX
+#include "socketcan.h"
+#endif
 
 CANConnection *CanConFactory::create(const QString &type, const QString &portName)
 {
     if (type == CANConnection::typeGvret())
         return new GVRetSerial(portName);
 
+#ifdef Q_OS_LINUX
+    if (type == CANConnection::typeSocketCan())
+        return new SocketCan(portName);
+#endif
+
+    if (type == CANConnection::typeSimulated())
+        return new SimulatedConnection(portName);
+
     if (type == CANConnection::typeKvaser())
         ; // return new KvaserConnection(portName);
 
@@ -0,0 +1,242 @@
+#include <limits>
+#include <QDebug>
+
+#include "canconingest.h"
+
+/* minimum time between two wakeups (ms) unless a queue crossed its watermark */
+#define MIN_WAKEUP_INTERVAL     5
+
+
+CANConIngest::CANConIngest(QObject *parent) :
+    QObject(parent),
+    mTimer_p(NULL),
+    mCoalesceTimer_p(NULL),
+    mPollInterval(250),
+    mLastDrain(0)
+{
+    resetWakeupLatency();
+}
+
+
+CANConIngest::~CANConIngest()
+{
+    stop();
+}
+
+
+void CANConIngest::start()
+{
+    /* connections wake us up when they queue frames, this is only a fallback */
+    mTimer_p = new QTimer(this);
+    connect(mTimer_p, &QTimer::timeout, this, &CANConIngest::handleTick);
+    mTimer_p->setSingleShot(false);
+    mTimer_p->start(mPollInterval);
+
+    /* wakeups coming too close to each other are merged into one drain of all connections */
+    mCoalesceTimer_p = new QTimer(this);
+    connect(mCoalesceTimer_p, &QTimer::timeout, this, &CANConIngest::handleTick);
+    mCoalesceTimer_p->setSingleShot(true);
+}
+
+
+void CANConIngest::stop()
+{
+    delete mTimer_p;
+    mTimer_p = NULL;
+    delete mCoalesceTimer_p;
+    mCoalesceTimer_p = NULL;
+}
+
+
+void CANConIngest::setConnections(const QList<CANConnection*>& pConns)
+{
+    mConns = pConns;
+    mRuns.resize(mConns.count());
+
+    //Each connection only knows about its own bus numbers
+    //so this is used to fix that up to turn local bus numbers
+    //into system global bus numbers for display.
+    mBusBase.resize(mConns.count());
+    int busBase = 0;
+    for (int i = 0; i < mConns.count(); i++)
+    {
+        mBusBase[i] = busBase;
+        busBase += mConns[i]->getNumBuses();
+    }
+}
+
+
+void CANConIngest::setPollInterval(int pMs)
+{
+    mPollInterval = pMs;
+    if(mTimer_p)
+        mTimer_p->start(mPollInterval);
+}
+
+
+int CANConIngest::getWakeupLatency(qint64& pAvgNs, qint64& pMaxNs) const
+{
+    int count = mLatencyCount.load();
+    pAvgNs = count ? (mLatencySum.load() / count) : 0;
+    pMaxNs = mLatencyMax.load();
+    return count;
+}
+
+
+void CANConIngest::resetWakeupLatency()
+{
+    mLatencyCount.store(0);
+    mLatencySum.store(0);
+    mLatencyMax.store(0);
+}
+
+
+void CANConIngest::handleFramesQueued()
+{
+    /* the sender may already be gone, don't dereference it before checking */
+    CANConnection* conn_p = (CANConnection*) QObject::sender();
+    if(!mConns.contains(conn_p))
+        return;
+
+    bool urgent = conn_p->isDrainUrgent();
+
+    /* a drain of all connections is already scheduled */
+    if(mCoalesceTimer_p->isActive() && !urgent)
+        return;
+
+    /* bound the wakeup rate, unless the queue is filling up */
+    qint64 sinceLast = (CANConnection::getElapsedNs() - mLastDrain) / 1000000;
+    if(sinceLast < MIN_WAKEUP_INTERVAL && !urgent) {
+        mCoalesceTimer_p->start(MIN_WAKEUP_INTERVAL - sinceLast);
+        return;
+    }
+
+    mCoalesceTimer_p->stop();
+    drainAll();
+}
+
+
+void CANConIngest::handleTick()
+{
+    drainAll();
+}
+
+
+void CANConIngest::drainAll()
+{
+    //all connections are drained on each pass, a frame can only be ordered against frames that we have
+    int total = 0;
+    for (int i = 0; i < mConns.count(); i++) total += drainConnection(i);
+
+    mLastDrain = CANConnection::getElapsedNs();
+
+    if (!total) return;
+
+    QVector<CANFrame> frames;
+    mergeRuns(frames);
+    emit framesReceived(frames);
+}
+
+
+int CANConIngest::drainConnection(int pIdx)
+{
+    CANConnection* conn_p = mConns[pIdx];
+    QVector<CANFrame>& run = mRuns[pIdx];
+    run.clear();
+
+    //re-arm the connection's wakeup before draining so frames queued meanwhile raise a new one
+    qint64 wakeTime = conn_p->acknowledgeFramesQueued();
+
+    LFQueue<CANFrame>& queue = conn_p->getQueue();
+    CANFrame* first_p = NULL;
+    int count;
+
+    int busBase = mBusBase[pIdx];
+
+    //frames queued before a suspend are not wanted anymore, we are the consumer so we drop them
+    if (conn_p->isCapSuspended())
+    {
+        queue.discard();
+        return 0;
+    }
+
+    //drain contiguous runs of the queue, one atomic store per run
+    //frames are copied before being fixed up, the queue slots belong to the connection
+    while( (count = queue.peekBatch(first_p, queue.capacity())) > 0 ) {
+        int start = run.count();
+        for (int i = 0; i < count; i++) run.append(first_p[i]);
+        int dropped = queue.dequeueBatch(count);
+        //with the drop-oldest policy the connection may have recycled the head of the batch
+        if (dropped) run.remove(start, dropped);
+        for (int i = start; i < run.count(); i++) run[i].bus += busBase;
+    }
+
+    if (wakeTime)
+    {
+        qint64 latency = CANConnection::getElapsedNs() - wakeTime;
+        mLatencyCount.fetchAndAddRelaxed(1);
+        mLatencySum.fetchAndAddRelaxed(latency);
+        if (latency > mLatencyMax.load()) mLatencyMax.store(latency);
+    }
+
+    return run.count();
+}
+
+
+/*
+ * k-way merge of the runs drained from each connection. Each run is in timestamp order already,
+ * there are only a handful of connections so the head of each run is simply scanned for the
+ * oldest frame. Frames with equal timestamps keep the order of the connections.
+ */
+void CANConIngest::mergeRuns(QVector<CANFrame>& pOut)
+{
+    int total = 0;
+    int nonEmpty = 0;
+    int last = 0;
+
+    for (int i = 0; i < mRuns.count(); i++)
+    {
+        if (mRuns[i].isEmpty()) continue;
+        total += mRuns[i].count();
+        nonEmpty++;
+        last = i;
+    }
+
+    //usual case: a single device, nothing to merge
+    if (nonEmpty == 1)
+    {
+        pOut.swap(mRuns[last]);
+        return;
+    }
+
+    QVector<int> heads(mRuns.count(), 0);
+    pOut.reserve(total);
+
+    while (pOut.count() < total)
+    {
+        int oldest = -1;
+        for (int i = 0; i < mRuns.count(); i++)
+        {
+            if (heads[i] >= mRuns[i].count()) continue;
+            if (oldest < 0 || mRuns[i][heads[i]].timestamp < mRuns[oldest][heads[oldest]].timestamp) oldest = i;
+        }
+
+        //copy as many frames of that run as are older than the heads of the others
+        const QVector<CANFrame>& run = mRuns[oldest];
+        uint64_t limit = std::numeric_limits<uint64_t>::max();
+        for (int i = 0; i < mRuns.count(); i++)
+        {
+            if (i == oldest || heads[i] >= mRuns[i].count()) continue;
+            uint64_t ts = mRuns[i][heads[i]].timestamp;
+            //on equal timestamps, runs of lower index go first
+            if (i < oldest) ts--;
+            if (ts < limit) limit = ts;
+        }
+
+        int idx = heads[oldest];
+        do {
+            pOut.append(run[idx++]);
+        } while (idx < run.count() && run[idx].timestamp <= limit);
+        heads[oldest] = idx;
+    }
+}
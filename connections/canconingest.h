@@ -0,0 +1,80 @@
+#ifndef CANCONINGEST_H
+#define CANCONINGEST_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QAtomicInteger>
+
+#include "canconnection.h"
+
+/**
+ * Drains the queues of all connections on a dedicated thread.
+ *
+ * Frames drained in the same pass are merged in timestamp order across
+ * connections (each connection queues its own frames in order already) and
+ * published as a single batch, so subscribers don't have to care about how
+ * many devices are connected.
+ * The connection list is a copy owned by the ingest thread, it is updated
+ * by @ref setConnections which the manager calls with a blocking queued connection
+ * so a connection is never drained after it has been removed.
+ */
+class CANConIngest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CANConIngest(QObject *parent = 0);
+    virtual ~CANConIngest();
+
+    /**
+     * @brief getWakeupLatency returns statistics on the time between a connection queueing frames and the ingest draining them
+     * @param pAvgNs: average latency in ns
+     * @param pMaxNs: maximum latency in ns
+     * @return number of samples
+     * @note may be called from any thread
+     */
+    int getWakeupLatency(qint64& pAvgNs, qint64& pMaxNs) const;
+    void resetWakeupLatency();
+
+signals:
+    /**
+     * @brief framesReceived
+     * @param pFrames: frames of all connections, ordered by timestamp, with global bus numbers
+     */
+    void framesReceived(const QVector<CANFrame>& pFrames);
+
+public slots:
+    /* must be invoked in the ingest thread (e.g. connected to QThread::started) */
+    void start();
+    void stop();
+
+    void setConnections(const QList<CANConnection*>& pConns);
+    void setPollInterval(int pMs);
+
+    /* connected to CANConnection::framesQueued */
+    void handleFramesQueued();
+
+private slots:
+    void handleTick();
+
+private:
+    void drainAll();
+    int drainConnection(int pIdx);
+    void mergeRuns(QVector<CANFrame>& pOut);
+
+    QList<CANConnection*>       mConns;
+    /* one run of drained frames per connection, reused from one pass to the next */
+    QVector<QVector<CANFrame>>  mRuns;
+    /* global number of the first bus of each connection */
+    QVector<int>                mBusBase;
+    QTimer*                     mTimer_p;
+    QTimer*                     mCoalesceTimer_p;
+    int                         mPollInterval;
+    qint64                      mLastDrain;
+    QAtomicInt                  mLatencyCount;
+    QAtomicInteger<qint64>      mLatencySum;
+    QAtomicInteger<qint64>      mLatencyMax;
+};
+
+#endif // CANCONINGEST_H
@@ -1,7 +1,7 @@
 #include <QDateTime>
-#include <QSettings>
 
 #include "canconmanager.h"
+#include "canconingest.h"
 
 CANConManager* CANConManager::mInstance = NULL;
 
@@ -15,22 +15,19 @@ CANConManager* CANConManager::getInstance()
 
 CANConManager::CANConManager(QObject *parent): QObject(parent)
 {
-    connect(&mTimer, SIGNAL(timeout()), this, SLOT(refreshCanList()));
-    mTimer.setInterval(20); /*Tick 50 times per second to allow for good resolution in reception where needed. GUI updates *MUCH* more slowly*/
-    mTimer.setSingleShot(false);
-    mTimer.start();
+    qRegisterMetaType<QVector<CANFrame>>("QVector<CANFrame>");
+    qRegisterMetaType<QList<CANConnection*>>("QList<CANConnection*>");
 
-    mNumActiveBuses = 0;
+    /* connections are drained and merged on their own thread, the GUI only gets the result */
+    mIngest_p = new CANConIngest();
+    mIngest_p->moveToThread(&mIngestThread);
+    connect(&mIngestThread, &QThread::started, mIngest_p, &CANConIngest::start);
+    connect(mIngest_p, &CANConIngest::framesReceived, this, &CANConManager::framesReceived);
+    mIngestThread.setObjectName("CANConIngest");
+    mIngestThread.start();
 
+    mNumActiveBuses = 0;
     resetTimeBasis();
-
-    QSettings settings;
-
-    if (settings.value("Main/TimeClock", false).toBool())
-    {
-        useSystemTime = true;
-    }
-    else useSystemTime = false;
 }
 
 void CANConManager::resetTimeBasis()
@@ -40,7 +37,11 @@ void CANConManager::resetTimeBasis()
 
 CANConManager::~CANConManager()
 {
-    mTimer.stop();
+    /* timers have to be stopped from the thread they live in */
+    QMetaObject::invokeMethod(mIngest_p, "stop", Qt::BlockingQueuedConnection);
+    mIngestThread.quit();
+    mIngestThread.wait();
+    delete mIngest_p;
     mInstance = NULL;
 }
 
@@ -55,41 +56,102 @@ void CANConManager::stopAllConnections()
 void CANConManager::add(CANConnection* pConn_p)
 {
     mConns.append(pConn_p);
+    QMetaObject::invokeMethod(mIngest_p, "setConnections", Qt::BlockingQueuedConnection,
+                              Q_ARG(QList<CANConnection*>, mConns));
+    connect(pConn_p, &CANConnection::framesQueued, mIngest_p, &CANConIngest::handleFramesQueued);
+    connect(pConn_p, &CANConnection::status, this, &CANConManager::handleStatusChanged);
+    connect(pConn_p, &CANConnection::framesSent, this, &CANConManager::txReady);
+    rebuildBusTable();
 }
 
 
 void CANConManager::remove(CANConnection* pConn_p)
 {
-    //disconnect(pConn_p, 0, this, 0);
+    disconnect(pConn_p, &CANConnection::framesQueued, mIngest_p, &CANConIngest::handleFramesQueued);
+    disconnect(pConn_p, &CANConnection::status, this, &CANConManager::handleStatusChanged);
+    disconnect(pConn_p, &CANConnection::framesSent, this, &CANConManager::txReady);
     mConns.removeOne(pConn_p);
+    rebuildBusTable();
+    /* blocking: once we return, the ingest thread doesn't touch the connection anymore */
+    QMetaObject::invokeMethod(mIngest_p, "setConnections", Qt::BlockingQueuedConnection,
+                              Q_ARG(QList<CANConnection*>, mConns));
+}
+
+
+void CANConManager::setPollInterval(int pMs)
+{
+    QMetaObject::invokeMethod(mIngest_p, "setPollInterval", Qt::QueuedConnection, Q_ARG(int, pMs));
+}
+
+
+int CANConManager::getWakeupLatency(qint64& pAvgNs, qint64& pMaxNs) const
+{
+    return mIngest_p->getWakeupLatency(pAvgNs, pMaxNs);
+}
+
+
+void CANConManager::resetWakeupLatency()
+{
+    mIngest_p->resetWakeupLatency();
 }
 
 //Get total number of buses currently registered with the program
 int CANConManager::getNumBuses()
 {
-    int buses = 0;
+    return mBusTable.count();
+}
+
+
+CANConnection* CANConManager::getConnectionForBus(int pBus, int& pLocalBus) const
+{
+    if (pBus < 0 || pBus >= mBusTable.count()) return NULL;
+
+    const CANBusRoute& route = mBusTable.at(pBus);
+    pLocalBus = route.localBus;
+    return route.conn_p;
+}
+
+
+int CANConManager::getBusBase(const CANConnection* pConn_p) const
+{
+    return mBusBase.value(pConn_p, -1);
+}
+
+
+//Each connection only knows about its own bus numbers, buses are numbered globally
+//in the order the connections were added. The table maps both ways so that neither
+//RX nor TX have to walk the connection list.
+void CANConManager::rebuildBusTable()
+{
+    mBusTable.clear();
+    mBusBase.clear();
+
     foreach(CANConnection* conn_p, mConns)
     {
-        buses += conn_p->getNumBuses();
+        mBusBase.insert(conn_p, mBusTable.count());
+        for (int i = 0; i < conn_p->getNumBuses(); i++)
+        {
+            CANBusRoute route = {conn_p, i};
+            mBusTable.append(route);
+        }
     }
-    return buses;
+
+    handleStatusChanged();
 }
 
-void CANConManager::refreshCanList()
-{
-    QObject* sender_p = QObject::sender();
 
-    if( sender_p != &mTimer)
+void CANConManager::handleStatusChanged()
+{
+    int buses = 0;
+    foreach(CANConnection* conn_p, mConns)
     {
-        /* if we are not the sender, the signal is coming from a connection */
-        /* refresh only the given connection */
-        if(mConns.contains((CANConnection*) sender_p))
-            refreshConnection((CANConnection*)sender_p);
+        if (conn_p->getStatus() == CANConnection::Connected) buses += conn_p->getNumBuses();
     }
-    else
+
+    if (buses != mNumActiveBuses)
     {
-        foreach (CANConnection* conn_p, mConns)
-            refreshConnection((CANConnection*)conn_p);
+        mNumActiveBuses = buses;
+        emit connectionStatusUpdated(buses);
     }
 }
 
@@ -116,134 +178,121 @@ CANConnection* CANConManager::getByName(const QString& pName) const
 }
 
 
-void CANConManager::refreshConnection(CANConnection* pConn_p)
+/*
+ * Uses the bus table to look up which CANConnection object handles the requested bus. For instance, if the
+ * request is to send on bus 2 and there is a GVRET object first then a socketcan object it'll send on the
+ * socketcan object as gvret will have claimed buses 0 and 1 and socketcan bus 2. But, each actual
+ * CANConnection expects its own bus numbers to start at zero so the frame bus number has to be converted.
+ * The connection only queues the frame, its working thread sends it and echoes it into the capture.
+*/
+bool CANConManager::sendFrame(const CANFrame& pFrame)
 {
-    unsigned int buses = 0;
-    foreach(CANConnection* conn_p, mConns)
-    {
-        if (conn_p->getStatus() == CANConnection::Connected) buses += conn_p->getNumBuses();
-    }
-    if (buses != mNumActiveBuses)
-    {
-        mNumActiveBuses = buses;
-        emit connectionStatusUpdated(buses);
-    }
+    int localBus;
+    CANFrame workingFrame = pFrame;
 
-    if (pConn_p->getQueue().peek() == NULL) return;
+    CANConnection* conn = getConnectionForBus(pFrame.bus, localBus);
+    if (!conn) return false;
 
-    CANFrame* frame_p = NULL;
-    QVector<CANFrame> frames;
+    workingFrame.bus = localBus;
+    workingFrame.isReceived = false;
+    return conn->sendFrame(workingFrame);
+}
 
-    //Each connection only knows about its own bus numbers
-    //so this variable is used to fix that up to turn local bus numbers
-    //into system global bus numbers for display.
-    int busBase = 0;
+//frames are grouped per connection so each connection queues its share in one go
+bool CANConManager::sendFrames(const QList<CANFrame>& pFrames)
+{
+    QHash<CANConnection*, QList<CANFrame>> perConn;
+    int localBus;
+    bool ret = true;
 
-    foreach (CANConnection* conn, mConns)
+    foreach(const CANFrame& frame, pFrames)
     {
-        if (conn != pConn_p) busBase += conn->getNumBuses();
-        else break;
-    }
+        CANConnection* conn = getConnectionForBus(frame.bus, localBus);
+        if (!conn)
+        {
+            ret = false;
+            continue;
+        }
 
-    //qDebug() << "Bus fixup number: " << busBase;
+        CANFrame workingFrame = frame;
+        workingFrame.bus = localBus;
+        workingFrame.isReceived = false;
+        perConn[conn].append(workingFrame);
+    }
 
-    while( (frame_p = pConn_p->getQueue().peek() ) ) {
-        frame_p->bus += busBase;
-        //qDebug() << "Rx of frame from bus: " << frame_p->bus;
-        frames.append(*frame_p);
-        pConn_p->getQueue().dequeue();
+    for (auto it = perConn.constBegin(); it != perConn.constEnd(); ++it)
+    {
+        if (!it.key()->sendFrames(it.value())) ret = false;
     }
 
-    if(frames.size())
-        emit framesReceived(pConn_p, frames);
+    return ret;
 }
 
-/*
- * Uses the requested bus to look up which CANConnection object handles this bus based on the order of
- * the objects and how many buses they implement. For instance, if the request is to send on bus 2
- * and there is a GVRET object first then a socketcan object it'll send on the socketcan object as
- * gvret will have claimed buses 0 and 1 and socketcan bus 2. But, each actual CANConnection expects
- * its own bus numbers to start at zero so the frame bus number has to be offset accordingly.
- * Also keep in mind that the CANConnection "sendFrame" function uses a blocking queued connection
- * and so will force the frame to be delivered before it keeps going. This allows on the stack variables
- * to be used but is slow. This function uses an on the stack copy of the frame so the way it works
- * is a good thing but performance will suffer. TODO: Investigate a way to use non-blocking calls.
-*/
-bool CANConManager::sendFrame(const CANFrame& pFrame)
+//runs of consecutive frames for the same connection are queued in one go, order is kept across connections
+int CANConManager::queueFrames(const QList<CANFrame>& pFrames)
 {
-    int busBase = 0;
-    CANFrame workingFrame = pFrame;
-    CANFrame *txFrame;
+    int idx = 0;
+    int localBus;
 
-    foreach (CANConnection* conn, mConns)
+    while (idx < pFrames.count())
     {
-        //check if this CAN connection is supposed to handle the requested bus
-        if (pFrame.bus < (uint32_t)(busBase + conn->getNumBuses()))
+        CANConnection* conn = getConnectionForBus(pFrames.at(idx).bus, localBus);
+        if (!conn)
         {
-            workingFrame.bus -= busBase;
+            idx++;
+            continue;
+        }
+
+        QList<CANFrame> run;
+        while (idx + run.count() < pFrames.count())
+        {
+            CANFrame workingFrame = pFrames.at(idx + run.count());
+            if (getConnectionForBus(workingFrame.bus, localBus) != conn) break;
+            workingFrame.bus = localBus;
             workingFrame.isReceived = false;
-            workingFrame.timestamp = (QDateTime::currentMSecsSinceEpoch() * 1000);
-            if (!useSystemTime) workingFrame.timestamp -= mTimestampBasis;
-            txFrame = conn->getQueue().get();
-            *txFrame = workingFrame;
-            conn->getQueue().queue();
-            return conn->sendFrame(workingFrame);
+            run.append(workingFrame);
         }
-        busBase += conn->getNumBuses();
-    }
-    return false;
-}
 
-bool CANConManager::sendFrames(const QList<CANFrame>& pFrames)
-{
-    foreach(const CANFrame& frame, pFrames)
-    {
-        if(!sendFrame(frame))
-            return false;
+        int queued = conn->queueFrames(run);
+        idx += queued;
+        if (queued < run.count()) break;
     }
 
-    return true;
+    return idx;
 }
 
-//For each device associated with buses go through and see if that device has a bus
-//that the filter should apply to. If so forward the data on but fudge
-//the bus numbers if bus wasn't -1 so that they're local to the device
+//Forward the filter to every device if bus is -1, otherwise only to the device
+//handling that bus, with the bus number made local to the device
 bool CANConManager::addTargettedFrame(int pBusId, uint32_t ID, uint32_t mask, QObject *receiver)
 {
-    int tempBusVal;
-    int busBase = 0;
-
-    foreach (CANConnection* conn, mConns)
+    if (pBusId == -1)
     {
-        if (pBusId == -1) conn->addTargettedFrame(pBusId, ID, mask, receiver);
-        else if (pBusId < (uint32_t)(busBase + conn->getNumBuses()))
-        {
-            qDebug() << "Forwarding targetted frame setting to a connection object";
-            conn->addTargettedFrame(pBusId - busBase, ID, mask, receiver);
-
-        }
-        busBase += conn->getNumBuses();
+        foreach (CANConnection* conn, mConns) conn->addTargettedFrame(pBusId, ID, mask, receiver);
+        return true;
     }
-    return true;
+
+    int localBus;
+    CANConnection* conn = getConnectionForBus(pBusId, localBus);
+    if (!conn) return false;
+
+    qDebug() << "Forwarding targetted frame setting to a connection object";
+    return conn->addTargettedFrame(localBus, ID, mask, receiver);
 }
 
 bool CANConManager::removeTargettedFrame(int pBusId, uint32_t ID, uint32_t mask, QObject *receiver)
 {
-    int tempBusVal;
-    int busBase = 0;
-
-    foreach (CANConnection* conn, mConns)
+    if (pBusId == -1)
     {
-        if (pBusId == -1) conn->removeTargettedFrame(pBusId, ID, mask, receiver);
-        else if (pBusId < (uint32_t)(busBase + conn->getNumBuses()))
-        {
-            qDebug() << "Forwarding targetted frame setting to a connection object";
-            conn->removeTargettedFrame(pBusId - busBase, ID, mask, receiver);
-
-        }
-        busBase += conn->getNumBuses();
+        foreach (CANConnection* conn, mConns) conn->removeTargettedFrame(pBusId, ID, mask, receiver);
+        return true;
     }
-    return true;
+
+    int localBus;
+    CANConnection* conn = getConnectionForBus(pBusId, localBus);
+    if (!conn) return false;
+
+    qDebug() << "Forwarding targetted frame setting to a connection object";
+    return conn->removeTargettedFrame(localBus, ID, mask, receiver);
 }
 
 bool CANConManager::removeAllTargettedFrames(QObject *receiver)
@@ -2,10 +2,21 @@
 #define CANCONMANAGER_H
 
 #include <QObject>
-#include <QTimer>
+#include <QThread>
+#include <QHash>
+#include <QVector>
 
 #include "canconnection.h"
 
+class CANConIngest;
+
+/* where a global bus number leads to */
+struct CANBusRoute
+{
+    CANConnection*  conn_p;
+    int             localBus;
+};
+
 class CANConManager : public QObject
 {
     Q_OBJECT
@@ -26,17 +37,41 @@ public:
 
     int getNumBuses();
 
+    /**
+     * @brief getConnectionForBus
+     * @param pBus: global bus number
+     * @param pLocalBus: set to the bus number local to the returned connection
+     * @return the connection handling the bus, NULL if there is none
+     */
+    CANConnection* getConnectionForBus(int pBus, int& pLocalBus) const;
+
+    /**
+     * @brief getBusBase
+     * @return the global number of the first bus of the connection, -1 if the connection is unknown
+     */
+    int getBusBase(const CANConnection* pConn_p) const;
+
     /**
      * @brief sendFrame sends a single frame out the desired bus
      * @param pFrame - reference to a CANFrame struct that has been filled out for sending
-     * @return bool specifying whether the send succeeded or not
+     * @return bool specifying whether the frame was queued for sending or not
      * @note Finds which CANConnection object is responsible for this bus and automatically converts bus number to pass properly to CANConnection
+     * @note Does not wait for the frame to go out, see CANConnection::framesSent and CANConnection::sendFailed
      */
     bool sendFrame(const CANFrame& pFrame);
 
     //just the multi-frame version of above function.
     bool sendFrames(const QList<CANFrame>& pFrames);
 
+    /**
+     * @brief queueFrames queues frames in order until the transmit queue of a connection is full
+     * @param pFrames: frames with global bus numbers
+     * @return number of frames handled from the front of the list, the caller keeps the others
+     * and tries again on txReady(). Frames for a bus without connection are dropped
+     * @note see CANConnection::queueFrames
+     */
+    int queueFrames(const QList<CANFrame>& pFrames);
+
     /**
      * @brief Add a new filter for the targetted frames. If a frame matches it will immediately be sent via the targettedFrameReceived signal
      * @param pBusId - Which bus to bond to. -1 for any, otherwise a bitfield of buses (but 0 = first bus, etc)
@@ -59,23 +94,52 @@ public:
 
     bool removeAllTargettedFrames(QObject *receiver);
 
+    /**
+     * @brief setPollInterval
+     * @param pMs: period of the fallback poll of all connections
+     * @note connections wake the ingest thread up through CANConnection::framesQueued, the poll only
+     * catches connections that don't and keeps the number of active buses up to date
+     */
+    void setPollInterval(int pMs);
+
+    /**
+     * @brief getWakeupLatency returns statistics on the time between a connection queueing frames and the ingest thread draining them
+     * @param pAvgNs: average latency in ns
+     * @param pMaxNs: maximum latency in ns
+     * @return number of samples
+     */
+    int getWakeupLatency(qint64& pAvgNs, qint64& pMaxNs) const;
+    void resetWakeupLatency();
+
 signals:
-    void framesReceived(CANConnection* pConn_p, QVector<CANFrame>& pFrames);
+    /**
+     * @brief framesReceived carries the frames of all connections
+     * @param pFrames: frames ordered by timestamp, bus numbers are global
+     * @note relayed from CANConIngest::framesReceived, which crosses from the ingest thread to the
+     * manager's (GUI) thread through a queued connection. Receivers are called in the GUI thread
+     * and get an implicitly shared copy
+     */
+    void framesReceived(const QVector<CANFrame>& pFrames);
     void connectionStatusUpdated(int conns);
+    //a connection handed queued frames to its device, there is room in its transmit queue again
+    void txReady();
 
 private slots:
-    void refreshCanList();
+    void handleStatusChanged();
 
 private:
     explicit CANConManager(QObject *parent = 0);
-    void refreshConnection(CANConnection* pConn_p);
+    void rebuildBusTable();
 
     static CANConManager*  mInstance;
     QList<CANConnection*>  mConns;
-    QTimer                 mTimer;
+    /* rebuilt when a connection is added or removed */
+    QVector<CANBusRoute>   mBusTable;
+    QHash<const CANConnection*, int> mBusBase;
+    int                    mNumActiveBuses;
+    QThread                mIngestThread;
+    CANConIngest*          mIngest_p;
     uint64_t               mTimestampBasis;
-    uint32_t               mNumActiveBuses;
-    bool useSystemTime;
 };
 
 #endif // CANCONNECTIONMODEL_H
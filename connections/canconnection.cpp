@@ -1,12 +1,40 @@
 #include <QSettings>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include "canconnection.h"
+#include "canconmanager.h"
 
+/* consumer is woken up a second time when the queue gets this full (in percent) */
+#define QUEUE_WATERMARK     50
+
+/* monotonic clock shared by producers and consumer, used to measure wakeup latency */
+static QElapsedTimer& latencyClock()
+{
+    static QElapsedTimer clock;
+    return clock;
+}
+
+
+/* an observer of targetted frames */
+struct TargetObserver {
+    QObject*    observer;
+    bool        batch;      /* has a gotTargettedFrames slot */
+};
+
+/* targetted frame filters sharing the same mask, indexed by id */
+struct TargetBucket {
+    quint32     mask;
+    QHash<quint32, QVector<TargetObserver>> ids;
+};
 
 struct BusData {
     CANBus             mBus;
     bool               mConfigured;
-    QVector<CANFltObserver>    mTargettedFrames;
+    QVector<CANFltObserver>    mTargettedFrames;   /* as registered */
+    QVector<TargetBucket>      mTargetBuckets;     /* compiled from mTargettedFrames */
+    QVector<TargetBucket>      mReadBuckets;       /* working thread copy of mTargetBuckets */
+    QAtomicInteger<quint64>    mDropped;
 };
 
 
@@ -15,23 +43,35 @@ CANConnection::CANConnection(const QString &pType,
                              int pNumBuses,
                              int pQueueLen,
                              bool pUseThread) :
-    mQueue(),
     mNumBuses(pNumBuses),
+    useSystemTime(false),
+    mQueue(),
+    mOverflowPolicy(DropNewest),
+    mTxSeq(0),
+    mTxDoneSeq(0),
     mPort(pPort),
     mType(pType),
     mIsCapSuspended(false),
     mStatus(Disconnected),
     mStarted(false),
-    mThread_p(NULL)
+    mThread_p(NULL),
+    mReadTargetGen(0)
 {
     /* register types */
     qRegisterMetaType<CANBus>("CANBus");
     qRegisterMetaType<CANFrame>("CANFrame");
+    qRegisterMetaType<QVector<CANFrame>>("QVector<CANFrame>");
     qRegisterMetaType<Status>("CANConnection::Status");
-    qRegisterMetaType<CANFltObserver>("CANFlt");
+    qRegisterMetaType<CANFltObserver>("CANFltObserver");
+    qRegisterMetaType<QVector<CANFlt>>("QVector<CANFlt>");
+
+    /* connections are created from the GUI thread, start the clock before any producer runs */
+    if(!latencyClock().isValid())
+        latencyClock().start();
 
     /* set queue size */
-    mQueue.setSize(pQueueLen); /*TODO add check on returned value */
+    if(!mQueue.setSize(pQueueLen) || !mTxQueue.setSize(pQueueLen))
+        qCritical() << "can't allocate the queues of" << pPort << ", its frames will be dropped";
 
     /* allocate buses */
     /* TODO: change those tables for a vector */
@@ -79,6 +119,8 @@ void CANConnection::start()
 
     /* set started flag */
     mStarted = true;
+    /* a drain may have been scheduled in a thread that is not running anymore */
+    mTxWakeState.store(0);
 
     QSettings settings;
 
@@ -88,6 +130,11 @@ void CANConnection::start()
     }
     else useSystemTime = false;
 
+    /* overflow policy, queue growth is capped by memory */
+    mOverflowPolicy = static_cast<OverflowPolicy>(settings.value("Main/QueueOverflowPolicy", DropNewest).toInt());
+    int maxMem = settings.value("Main/QueueMaxMemory", 64).toInt(); //MB
+    mQueue.setMaxSize( (mOverflowPolicy == GrowQueue) ? (int) ((qint64) maxMem * 1024 * 1024 / sizeof(CANFrame)) : 0 );
+
     /* in multithread case, this will be called before entering thread event loop */
     return piStarted();
 }
@@ -103,7 +150,11 @@ void CANConnection::suspend(bool pSuspend)
         return;
     }
 
-    return piSuspend(pSuspend);
+    piSuspend(pSuspend);
+
+    /* wake the consumer up so it drops what was queued before the suspend */
+    if(pSuspend)
+        notifyFramesQueued();
 }
 
 
@@ -164,37 +215,180 @@ void CANConnection::setBusSettings(int pBusIdx, CANBus pBus)
 }
 
 
-bool CANConnection::sendFrame(const CANFrame& pFrame)
+bool CANConnection::setFilters(int pBusIdx, const QVector<CANFlt>& pFilters)
 {
     /* make sure we execute in mThread context */
-    if( mThread_p && (mThread_p != QThread::currentThread()) )
-    {
+    if( mThread_p && (mThread_p != QThread::currentThread()) ) {
         bool ret;
-        QMetaObject::invokeMethod(this, "sendFrame",
+        QMetaObject::invokeMethod(this, "setFilters",
                                   Qt::BlockingQueuedConnection,
                                   Q_RETURN_ARG(bool, ret),
-                                  Q_ARG(const CANFrame&, pFrame));
+                                  Q_ARG(int, pBusIdx),
+                                  Q_ARG(QVector<CANFlt>, pFilters));
         return ret;
     }
 
-    return piSendFrame(pFrame);
+    if( pBusIdx < 0 || pBusIdx >= getNumBuses() )
+        return false;
+
+    return piSetFilters(pBusIdx, pFilters);
+}
+
+
+bool CANConnection::sendFrame(const CANFrame& pFrame)
+{
+    if(!isValidTxFrame(pFrame))
+        return false;
+
+    CANFrame* frame_p = mTxQueue.get();
+    if(!frame_p)
+        return false;
+
+    *frame_p = pFrame;
+    mTxQueue.queue();
+    mTxSeq++;
+    mTxPending.fetchAndAddRelaxed(1);
+
+    scheduleTxDrain();
+    return true;
 }
 
 
 bool CANConnection::sendFrames(const QList<CANFrame>& pFrames)
 {
-    /* make sure we execute in mThread context */
-    if( mThread_p && (mThread_p != QThread::currentThread()) )
+    bool ret = true;
+    int idx = 0;
+
+    /* fill contiguous runs of the queue, the working thread is woken up once */
+    while(idx < pFrames.count())
     {
-        bool ret;
-        QMetaObject::invokeMethod(this, "sendFrames",
-                                  Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(bool, ret),
-                                  Q_ARG(const QList<CANFrame>&, pFrames));
-        return ret;
+        CANFrame* first_p;
+        int count = mTxQueue.reserve(first_p, pFrames.count() - idx);
+        if(!count) {
+            ret = false;
+            break;
+        }
+
+        int queued = 0;
+        while(queued < count && idx < pFrames.count())
+        {
+            const CANFrame& frame = pFrames.at(idx);
+            if(!isValidTxFrame(frame)) {
+                ret = false;
+                break;
+            }
+            first_p[queued++] = frame;
+            idx++;
+        }
+
+        mTxQueue.commit(queued);
+        mTxSeq += queued;
+        mTxPending.fetchAndAddRelaxed(queued);
+
+        if(!ret)
+            break;
     }
 
-    return piSendFrames(pFrames);
+    scheduleTxDrain();
+    return ret;
+}
+
+
+int CANConnection::queueFrames(const QList<CANFrame>& pFrames)
+{
+    int idx = 0;
+
+    while(idx < pFrames.count())
+    {
+        CANFrame* first_p;
+        int count = mTxQueue.reserve(first_p, pFrames.count() - idx);
+        if(!count)
+            break;
+
+        int queued = 0;
+        while(queued < count && idx < pFrames.count())
+        {
+            const CANFrame& frame = pFrames.at(idx++);
+            /* a frame that can't be sent now never will, it is not kept for later */
+            if(isValidTxFrame(frame))
+                first_p[queued++] = frame;
+        }
+
+        mTxQueue.commit(queued);
+        mTxSeq += queued;
+        mTxPending.fetchAndAddRelaxed(queued);
+    }
+
+    scheduleTxDrain();
+    return idx;
+}
+
+
+bool CANConnection::isValidTxFrame(const CANFrame& pFrame) const
+{
+    return (pFrame.bus < (uint32_t) mNumBuses) && (pFrame.len <= 8);
+}
+
+
+void CANConnection::scheduleTxDrain()
+{
+    /* not threaded (or not started yet): send right away */
+    if(thread() == QThread::currentThread()) {
+        drainTxQueue();
+        return;
+    }
+
+    /* a drain is already pending, it will see the frames we queued */
+    if(mTxWakeState.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drainTxQueue", Qt::QueuedConnection);
+}
+
+
+void CANConnection::drainTxQueue()
+{
+    /* re-arm before draining so that frames queued meanwhile schedule a new drain */
+    mTxWakeState.fetchAndStoreOrdered(0);
+
+    CANFrame* first_p;
+    int count;
+    bool echoed = false;
+
+    while( (count = mTxQueue.peekBatch(first_p, mTxQueue.capacity())) > 0 )
+    {
+        int failed = 0;
+
+        for(int i=0 ; i<count ; i++)
+        {
+            const CANFrame& frame = first_p[i];
+            mTxDoneSeq++;
+
+            if(!piSendFrame(frame)) {
+                failed++;
+                emit sendFailed(mTxDoneSeq, frame);
+                continue;
+            }
+
+            /* show what we sent in the capture, stamped with the time it was handed to the device */
+            CANFrame* echo_p = getQueueSlot(frame.bus);
+            if(echo_p) {
+                *echo_p = frame;
+                echo_p->isReceived = false;
+                echo_p->timestamp = QDateTime::currentMSecsSinceEpoch() * 1000;
+                if(!useSystemTime) echo_p->timestamp -= CANConManager::getInstance()->getTimeBasis();
+                mQueue.queue();
+                echoed = true;
+            }
+        }
+
+        mTxQueue.dequeueBatch(count);
+        mTxPending.fetchAndAddRelaxed(-count);
+        mTxSent.fetchAndAddRelaxed(count - failed);
+        mTxFailed.fetchAndAddRelaxed(failed);
+        emit framesSent(mTxDoneSeq, count, failed);
+    }
+
+    if(echoed)
+        notifyFramesQueued();
 }
 
 
@@ -244,6 +438,147 @@ LFQueue<CANFrame>& CANConnection::getQueue() {
 }
 
 
+CANFrame* CANConnection::getQueueSlot(int pBusId)
+{
+    CANFrame* frame_p = mQueue.get();
+    if(frame_p)
+        return frame_p;
+
+    switch(mOverflowPolicy)
+    {
+        case DropOldest:
+            /* make room, the oldest frame is the one we account for */
+            while( !(frame_p = mQueue.get()) ) {
+                CANFrame* dropped_p = mQueue.dropOldest();
+                if(dropped_p) {
+                    if( dropped_p->bus < (uint32_t) mNumBuses )
+                        mBusData_p[dropped_p->bus].mDropped.fetchAndAddRelaxed(1);
+                    else
+                        mDroppedOther.fetchAndAddRelaxed(1);
+                }
+                else {
+                    /* the consumer made room meanwhile, or the queue has no ring at all */
+                    frame_p = mQueue.get();
+                    break;
+                }
+            }
+            if(frame_p)
+                return frame_p;
+            break;
+        case GrowQueue:
+            if(mQueue.grow())
+                return mQueue.get();
+            break;
+        case DropNewest:
+        default:
+            break;
+    }
+
+    if( pBusId >= 0 && pBusId < mNumBuses )
+        mBusData_p[pBusId].mDropped.fetchAndAddRelaxed(1);
+    else
+        mDroppedOther.fetchAndAddRelaxed(1);
+
+    return NULL;
+}
+
+
+quint64 CANConnection::getDroppedFrames(int pBusIdx) const
+{
+    if( pBusIdx >= 0 ) {
+        if( pBusIdx >= mNumBuses )
+            return 0;
+        return mBusData_p[pBusIdx].mDropped.load();
+    }
+
+    quint64 total = mDroppedOther.load();
+    for(int i=0 ; i<mNumBuses ; i++)
+        total += mBusData_p[i].mDropped.load();
+
+    return total;
+}
+
+
+int CANConnection::getQueueHighWater() const {
+    return mQueue.highWaterMark();
+}
+
+
+int CANConnection::getQueueCapacity() const {
+    return mQueue.capacity();
+}
+
+
+void CANConnection::notifyFramesQueued()
+{
+    switch(mWakeState.load())
+    {
+        case 0:
+            /* nothing queued (command replies only for instance) */
+            if(mQueue.producerCount() == 0)
+                break;
+            if(mWakeState.testAndSetOrdered(0, 1)) {
+                mWakeTime.store(getElapsedNs());
+                emit framesQueued();
+            }
+            break;
+        case 1:
+            /* consumer has been notified but did not drain yet, hurry it up if we are filling */
+            if( mQueue.producerCount() * 100 >= mQueue.capacity() * QUEUE_WATERMARK ) {
+                if(mWakeState.testAndSetOrdered(1, 2))
+                    emit framesQueued();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+qint64 CANConnection::getElapsedNs() {
+    return latencyClock().nsecsElapsed();
+}
+
+
+bool CANConnection::isDrainUrgent() const {
+    return (mWakeState.load() == 2);
+}
+
+
+qint64 CANConnection::acknowledgeFramesQueued()
+{
+    qint64 wakeTime = mWakeTime.fetchAndStoreRelaxed(0);
+    mWakeState.fetchAndStoreOrdered(0);
+    return wakeTime;
+}
+
+
+int CANConnection::getTxStats(quint64& pSent, quint64& pFailed)
+{
+    pSent = mTxSent.load();
+    pFailed = mTxFailed.load();
+    /* producerCount() would touch the producer's private cache, the counter is safe from the GUI */
+    return qMax(mTxPending.load(), 0);
+}
+
+
+quint64 CANConnection::getTxSequence() const
+{
+    return mTxSeq;
+}
+
+
+void CANConnection::resetQueueStats()
+{
+    mTxSent.store(0);
+    mTxFailed.store(0);
+    mDroppedOther.store(0);
+    for(int i=0 ; i<mNumBuses ; i++)
+        mBusData_p[i].mDropped.store(0);
+    mQueue.resetHighWaterMark();
+}
+
+
 QString CANConnection::getType() const {
     return mType;
 }
@@ -267,12 +602,22 @@ QString CANConnection::typeKvaser()
     return QStringLiteral("KVASER");
 }
 
+QString CANConnection::typeSimulated()
+{
+    return QStringLiteral("Simulated");
+}
+
+QString CANConnection::typeSocketCan()
+{
+    return QStringLiteral("SOCKETCAN");
+}
+
 bool CANConnection::isCapSuspended() {
-    return mIsCapSuspended;
+    return mIsCapSuspended.load() != 0;
 }
 
 void CANConnection::setCapSuspended(bool pIsSuspended) {
-    mIsCapSuspended = pIsSuspended;
+    mIsCapSuspended.store(pIsSuspended ? 1 : 0);
 }
 
 void CANConnection::debugInput(QByteArray bytes) {
@@ -281,91 +626,175 @@ void CANConnection::debugInput(QByteArray bytes) {
 
 bool CANConnection::addTargettedFrame(int pBusId, uint32_t ID, uint32_t mask, QObject *receiver)
 {
-/*
-    if( mThread_p && (mThread_p != QThread::currentThread()) ) {
-        bool ret;
-        QMetaObject::invokeMethod(this, "addTargettedFrame",
-                                  Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(bool, ret),
-                                  Q_ARG(int, pBusId),
-                                  Q_ARG(uint32_t , ID),
-                                  Q_ARG(uint32_t , mask),
-                                  Q_ARG(QObject *, receiver));
-        return ret;
-    }
-*/
     /* sanity checks */
-    if(pBusId < -1 || pBusId >=  getNumBuses())
+    if(pBusId < -1 || pBusId >=  getNumBuses() || !receiver)
         return false;
 
+    /* any bus */
+    if(pBusId == -1) {
+        for(int i=0 ; i<getNumBuses() ; i++)
+            addTargettedFrame(i, ID, mask, receiver);
+        return true;
+    }
+
     qDebug() << "Connection is registering a new targetted frame filter, local bus " << pBusId;
     CANFltObserver target;
     target.id = ID;
     target.mask = mask;
     target.observer = receiver;
+
+    QMutexLocker locker(&mTargetLock);
     mBusData_p[pBusId].mTargettedFrames.append(target);
+    mTargetObservers[receiver]++;
+    compileTargettedFrames(pBusId);
 
     return true;
 }
 
 bool CANConnection::removeTargettedFrame(int pBusId, uint32_t ID, uint32_t mask, QObject *receiver)
 {
-/*
-    if( mThread_p && (mThread_p != QThread::currentThread()) ) {
-        bool ret;
-        QMetaObject::invokeMethod(this, "removeTargettedFrame",
-                                  Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(bool, ret),
-                                  Q_ARG(int, pBusId),
-                                  Q_ARG(uint32_t , ID),
-                                  Q_ARG(uint32_t , mask),
-                                  Q_ARG(QObject *, receiver));
-        return ret;
-    }
-*/
     /* sanity checks */
     if(pBusId < -1 || pBusId >= getNumBuses())
         return false;
 
+    /* any bus */
+    if(pBusId == -1) {
+        for(int i=0 ; i<getNumBuses() ; i++)
+            removeTargettedFrame(i, ID, mask, receiver);
+        return true;
+    }
+
     CANFltObserver target;
     target.id = ID;
     target.mask = mask;
     target.observer = receiver;
-    mBusData_p[pBusId].mTargettedFrames.removeAll(target);
+
+    QMutexLocker locker(&mTargetLock);
+    int removed = mBusData_p[pBusId].mTargettedFrames.removeAll(target);
+    if(!removed)
+        return false;
+
+    mTargetObservers[receiver] -= removed;
+    if(mTargetObservers[receiver] <= 0)
+        mTargetObservers.remove(receiver);
+    compileTargettedFrames(pBusId);
 
     return true;
 }
 
 bool CANConnection::removeAllTargettedFrames(QObject *receiver)
 {
+    QMutexLocker locker(&mTargetLock);
+
     for (int i = 0; i < getNumBuses(); i++) {
-        foreach (const CANFltObserver filt, mBusData_p[i].mTargettedFrames)
+        QVector<CANFltObserver>& filters = mBusData_p[i].mTargettedFrames;
+        for (int j = filters.count() - 1; j >= 0; j--)
         {
-            if (filt.observer == receiver) mBusData_p[i].mTargettedFrames.removeOne(filt);
+            if (filters[j].observer == receiver) filters.remove(j);
         }
+        compileTargettedFrames(i);
     }
 
-    return true;
+    return (mTargetObservers.remove(receiver) > 0);
+}
+
+/*
+ * Filters of a bus are grouped by mask, so a frame costs one hash lookup per distinct mask
+ * rather than a comparison per filter. Exact id filters all end up in the same bucket.
+ * Called with mTargetLock held.
+ */
+void CANConnection::compileTargettedFrames(int pBusId)
+{
+    BusData& busData = mBusData_p[pBusId];
+    busData.mTargetBuckets.clear();
+
+    foreach (const CANFltObserver& filt, busData.mTargettedFrames)
+    {
+        int b = 0;
+        while (b < busData.mTargetBuckets.count() && busData.mTargetBuckets[b].mask != filt.mask) b++;
+        if (b == busData.mTargetBuckets.count())
+        {
+            TargetBucket bucket;
+            bucket.mask = filt.mask;
+            busData.mTargetBuckets.append(bucket);
+        }
+
+        //an observer registering the same filter twice still gets each frame once
+        QVector<TargetObserver>& observers = busData.mTargetBuckets[b].ids[filt.id];
+        bool known = false;
+        foreach (const TargetObserver& obs, observers) known |= (obs.observer == filt.observer);
+        if (known) continue;
+
+        TargetObserver obs;
+        obs.observer = filt.observer;
+        obs.batch = (filt.observer->metaObject()->indexOfMethod("gotTargettedFrames(QVector<CANFrame>)") >= 0);
+        observers.append(obs);
+    }
+
+    int numTargets = 0;
+    for (int i = 0; i < getNumBuses(); i++) numTargets += mBusData_p[i].mTargettedFrames.count();
+    mNumTargets.store(numTargets);
+    mTargetGen.ref();
 }
 
-void CANConnection::checkTargettedFrame(CANFrame &frame)
+void CANConnection::checkTargettedFrame(const CANFrame &frame)
 {
-    unsigned int maskedID;
-    //qDebug() << "Got frame with ID " << frame.ID << " on bus " << frame.bus;
-    if (mBusData_p == 0) return;
+    //nothing registered, don't even take the lock
+    if (!mNumTargets.load()) return;
+    if (frame.bus >= (uint32_t) getNumBuses()) return;
+
+    /* the filters changed: copy the compiled buckets once, under the lock. The copies share
+     * their data and compileTargettedFrames builds new buckets rather than editing them, so
+     * they are read without the lock until the next change */
+    int gen = mTargetGen.loadAcquire();
+    if (gen != mReadTargetGen)
+    {
+        QMutexLocker locker(&mTargetLock);
+        for (int i = 0; i < getNumBuses(); i++)
+            mBusData_p[i].mReadBuckets = mBusData_p[i].mTargetBuckets;
+        mReadTargetGen = mTargetGen.load();
+    }
 
-    if (mBusData_p[frame.bus].mTargettedFrames.length() == 0) return;
-    foreach (const CANFltObserver filt, mBusData_p[frame.bus].mTargettedFrames)
+    const QVector<TargetBucket>& buckets = mBusData_p[frame.bus].mReadBuckets;
+    for (int b = 0; b < buckets.count(); b++)
     {
-        //qDebug() << "Checking filter with id " << filt.id << " mask " << filt.mask;
-        maskedID = frame.ID & filt.mask;
-        if (maskedID == filt.id) {
-            qDebug() << "In connection object I got a targetted frame. Forwarding it.";
-            QMetaObject::invokeMethod(filt.observer, "gotTargettedFrame",Qt::QueuedConnection, Q_ARG(CANFrame, frame));
+        QHash<quint32, QVector<TargetObserver>>::const_iterator it = buckets[b].ids.constFind(frame.ID & buckets[b].mask);
+        if (it == buckets[b].ids.constEnd()) continue;
+
+        foreach (const TargetObserver& obs, it.value())
+        {
+            TargetMatch& match = mPendingTargets[obs.observer];
+            match.batch = obs.batch;
+            match.frames.append(frame);
         }
     }
 }
 
+void CANConnection::flushTargettedFrames()
+{
+    if (mPendingTargets.isEmpty()) return;
+
+    //observers unregister (and may get deleted) under the lock, so check they are still there
+    QMutexLocker locker(&mTargetLock);
+
+    for (QHash<QObject*, TargetMatch>::const_iterator it = mPendingTargets.constBegin(); it != mPendingTargets.constEnd(); ++it)
+    {
+        if (!mTargetObservers.contains(it.key())) continue;
+
+        if (it.value().batch)
+        {
+            QMetaObject::invokeMethod(it.key(), "gotTargettedFrames", Qt::QueuedConnection, Q_ARG(QVector<CANFrame>, it.value().frames));
+        }
+        else
+        {
+            foreach (const CANFrame& frame, it.value().frames)
+                QMetaObject::invokeMethod(it.key(), "gotTargettedFrame", Qt::QueuedConnection, Q_ARG(CANFrame, frame));
+        }
+    }
+
+    mPendingTargets.clear();
+}
+
 bool CANConnection::piSendFrames(const QList<CANFrame>& pFrames)
 {
     foreach(const CANFrame& frame, pFrames)
@@ -376,3 +805,11 @@ bool CANConnection::piSendFrames(const QList<CANFrame>& pFrames)
 
     return true;
 }
+
+bool CANConnection::piSetFilters(int pBusIdx, const QVector<CANFlt>& pFilters)
+{
+    Q_UNUSED(pBusIdx);
+    Q_UNUSED(pFilters);
+
+    return false;
+}
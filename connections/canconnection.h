@@ -3,6 +3,8 @@
 
 #include <Qt>
 #include <QObject>
+#include <QHash>
+#include <QMutex>
 #include "utils/lfqueue.h"
 #include "can_structs.h"
 #include "canbus.h"
@@ -20,7 +22,7 @@ protected:
      * @param pType: string describing the type of connection
      * @param pPort: string containing port name
      * @param pNumBuses: the number of buses the device has
-     * @param pQueueLen: the length of the lock free queue to use
+     * @param pQueueLen: the length of the lock free queue to use (the transmit queue uses the same length)
      * @param pUseThread: if set to true, object will be execute in a dedicated thread
      */
     CANConnection(const QString &pType,
@@ -39,6 +41,16 @@ public:
         Connected       /*!< device is connected */
     };
 
+    /**
+     * @brief What to do with a received frame when the queue is full
+     */
+    enum OverflowPolicy
+    {
+        DropNewest,     /*!< drop the received frame */
+        DropOldest,     /*!< drop the oldest queued frame to make room */
+        GrowQueue       /*!< grow the queue up to the configured memory cap, then drop the received frame */
+    };
+
     /**
      * @brief CANConnection destructor
      */
@@ -75,8 +87,68 @@ public:
      */
     Status getStatus() const;
 
+    /**
+     * @brief getDroppedFrames
+     * @param pBusIdx: the local bus index, -1 for the whole connection
+     * @return the number of frames lost because the queue was full
+     */
+    quint64 getDroppedFrames(int pBusIdx = -1) const;
+
+    /**
+     * @brief getQueueHighWater
+     * @return the highest number of frames waiting in the queue since the last reset
+     */
+    int getQueueHighWater() const;
+
+    /**
+     * @brief getQueueCapacity
+     * @return the number of frames the queue can currently hold
+     */
+    int getQueueCapacity() const;
+
+    /**
+     * @brief getTxStats
+     * @param pSent: number of frames handed to the device since the last reset
+     * @param pFailed: number of frames the device refused since the last reset
+     * @return the number of frames waiting in the transmit queue
+     * @note only reads atomic counters, safe from any thread
+     */
+    int getTxStats(quint64& pSent, quint64& pFailed);
+
+    /**
+     * @brief getTxSequence
+     * @return the sequence number of the last frame accepted by @ref sendFrame or @ref sendFrames
+     * @note frames are numbered from 1 in the order they are accepted, see @ref framesSent
+     */
+    quint64 getTxSequence() const;
+
+    /**
+     * @brief resets drop counters, high water mark and transmit counters
+     */
+    void resetQueueStats();
+
+    /**
+     * @brief isDrainUrgent
+     * @return true if the queue crossed its watermark since the last @ref acknowledgeFramesQueued
+     */
+    bool isDrainUrgent() const;
+
+    /**
+     * @brief to be called by the consumer before it drains the queue, re-arms @ref framesQueued
+     * @return the time (in ns, see @ref QElapsedTimer) at which the first pending notification was raised, 0 if none
+     */
+    qint64 acknowledgeFramesQueued();
+
+    /**
+     * @brief getElapsedNs
+     * @return monotonic time in ns, the clock used for @ref acknowledgeFramesQueued
+     */
+    static qint64 getElapsedNs();
+
     static QString typeGvret();
     static QString typeKvaser();
+    static QString typeSimulated();
+    static QString typeSocketCan();
 
 signals:
     /*not implemented yet */
@@ -91,6 +163,7 @@ signals:
 
     /**
      * @brief event sent when a frame matching a filter is received
+     * @note not emitted, observers are called directly: see @ref addTargettedFrame
      */
     void targettedFrameReceived(CANFrame frame);
 
@@ -106,6 +179,28 @@ signals:
       */
     void debugOutput(QString debugString);
 
+    /**
+     * @brief event emitted when frames are queued while the consumer has nothing pending,
+     * and once more if the queue crosses its watermark before the consumer drained it
+     * @note emitted from the working thread, at most twice per drain
+     */
+    void framesQueued();
+
+    /**
+     * @brief event emitted from the working thread each time a batch of the transmit queue has been handed to the device
+     * @param pLastSeq: sequence number (see @ref getTxSequence) of the last frame of the batch
+     * @param pCount: number of frames in the batch
+     * @param pFailed: number of frames of the batch the device refused
+     */
+    void framesSent(quint64 pLastSeq, int pCount, int pFailed);
+
+    /**
+     * @brief event emitted from the working thread for each frame the device refused
+     * @param pSeq: sequence number of the frame
+     * @param pFrame: the frame
+     */
+    void sendFailed(quint64 pSeq, CANFrame pFrame);
+
 public slots:
 
     /**
@@ -137,33 +232,57 @@ public slots:
      */
     bool getBusSettings(int pBusIdx, CANBus& pBus);
 
+    /**
+     * @brief setFilters
+     * @param pBusIdx: the index of the bus for which filters have to be set
+     * @param pFilters: only frames matching one of these filters are received, all frames are received if empty
+     * @return false if pBusIdx is invalid or if the device can't filter frames
+     * @note this calls piSetFilters in the working thread context (if one has been started)
+     * @note nothing in the application sets filters yet, the capture keeps every frame so that
+     * hidden IDs can be shown again. This is the entry point for a per connection filter setting
+     */
+    bool setFilters(int pBusIdx, const QVector<CANFlt>& pFilters);
+
     /**
      * @brief suspends/restarts data capture
      * @param pSuspend: suspends capture if true else restarts it
      * @note this calls piSuspend (in the working thread context if one has been started)
-     * @note the caller shall not access the queue when capture is suspended,
-     * @note the callee is expected to flush the queue
+     * @note the consumer of the queue drops what is queued while capture is suspended
+     * (see LFQueue::discard), the queue keeps a single producer and a single consumer
      */
     void suspend(bool pSuspend);
 
     /**
-     * @brief provides device with the frame to send
+     * @brief queues a frame for the device to send
      * @param pFrame: the frame to send
-     * @return false if parameter is invalid (bus id for instance)
-     * @note this calls piSendFrame (in the working thread context if one has been started)
+     * @return false if parameter is invalid (bus id for instance) or if the transmit queue is full
+     * @note does not wait for the frame to be sent: the working thread drains the transmit queue
+     * and calls piSendFrame, the outcome is reported by @ref framesSent and @ref sendFailed
+     * @note the transmit queue has a single producer, call it from one thread only (the GUI thread)
      */
     bool sendFrame(const CANFrame& pFrame);
 
     /**
-     * @brief provides device with a list of frames to send
+     * @brief queues a list of frames for the device to send
      * @param pFrame: the list of frames to send
-     * @return false if parameter is invalid (bus id for instance)
-     * @note this calls piSendFrameBatch (in the working thread context if one has been started)
+     * @return false if a frame is invalid or the transmit queue is full, frames before it are queued anyway
+     * @note see @ref sendFrame
      */
     bool sendFrames(const QList<CANFrame>& pFrames);
 
     /**
-     * @brief Add a new filter for the targetted frames. If a frame matches it will immediately be sent via the targettedFrameReceived signal
+     * @brief queues as many frames of a list as the transmit queue takes, in order
+     * @param pFrames: the frames to send
+     * @return number of frames handled from the front of the list, less than pFrames.count()
+     * only when the transmit queue is full. Invalid frames are skipped and count as handled
+     * @note for callers that keep the rest and try again on @ref framesSent, see @ref sendFrame
+     */
+    int queueFrames(const QList<CANFrame>& pFrames);
+
+    /**
+     * @brief Add a new filter for the targetted frames. Frames matching it are delivered to the receiver's
+     * gotTargettedFrames(QVector<CANFrame>) slot, once per received batch, or to its gotTargettedFrame(CANFrame)
+     * slot, once per frame, if it doesn't implement the former.
      * @param pBusId - Which bus to bond to. -1 for any, otherwise a bitfield of buses (but 0 = first bus, etc)
      * @param ID - 11 or 29 bit ID to match against
      * @param mask - 11 or 29 bit mask used for filter
@@ -194,8 +313,14 @@ public slots:
 protected:
     int           mNumBuses; //protected to allow connected device to figure out how many buses are available
 
-    //determine if the passed frame is part of a filter or not.
-    void checkTargettedFrame(CANFrame &frame);
+    //determine if the passed frame is part of a filter or not, matches are kept until flushTargettedFrames
+    void checkTargettedFrame(const CANFrame &frame);
+
+    /**
+     * @brief delivers the frames matched by @ref checkTargettedFrame, one call per observer
+     * @note to be called once per received batch, along with @ref notifyFramesQueued
+     */
+    void flushTargettedFrames();
 
     /**
      * @brief setStatus
@@ -245,6 +370,32 @@ protected:
      */
     void setCapSuspended(bool pIsSuspended);
 
+    /**
+     * @brief getQueueSlot
+     * @param pBusId: the local bus the frame has been received on (used for drop accounting)
+     * @return a free slot of the queue or NULL if the frame has to be dropped
+     * @note applies the configured @ref OverflowPolicy, the caller queues the slot once filled
+     */
+    CANFrame* getQueueSlot(int pBusId);
+
+    /**
+     * @brief wakes up the consumer if needed, to be called once frames have been queued
+     * @note call it once per received batch rather than once per frame
+     */
+    void notifyFramesQueued();
+
+private slots:
+    /**
+     * @brief hands the frames of the transmit queue to the device
+     * @note runs in the working thread context
+     */
+    void drainTxQueue();
+
+private:
+    void scheduleTxDrain();
+    bool isValidTxFrame(const CANFrame& pFrame) const;
+    void compileTargettedFrames(int pBusId);
+
 protected:
     bool useSystemTime;
 
@@ -280,7 +431,8 @@ protected:
     /**
      * @brief suspends/restarts data capture
      * @param pSuspend: suspends capture if true else restarts it
-     * @note the caller will not access the queue when capture is suspended, so it is safe for callee to flush the queue
+     * @note the callee must not queue frames while suspended, nor flush the queue: the consumer
+     * may be draining it from another thread
      */
     virtual void piSuspend(bool pSuspend) = 0;
 
@@ -296,18 +448,53 @@ protected:
      * @param pFrame: the list of frames to send
      * @return false if parameter is invalid (bus id for instance)
      * @note implementing this function is optional
+     * @note the transmit queue is drained frame by frame through piSendFrame so that each frame
+     * gets a status, this is only used by devices calling it themselves
      */
     virtual bool piSendFrames(const QList<CANFrame>&);
 
+    /**
+     * @brief piSetFilters
+     * @param pBusIdx: the index of the bus for which filters have to be set
+     * @param pFilters: the filters, empty to receive all frames
+     * @return false if pBusIdx is invalid or if the device can't filter frames
+     * @note implementing this function is optional, devices filtering in hardware or in the kernel
+     * spare the capture pipeline the frames nobody asked for
+     */
+    virtual bool piSetFilters(int pBusIdx, const QVector<CANFlt>& pFilters);
+
 private:
     LFQueue<CANFrame>   mQueue;
+    OverflowPolicy      mOverflowPolicy;
+    QAtomicInteger<quint64> mDroppedOther; /* drops on an unknown bus */
+    QAtomicInt          mWakeState;     /* 0: idle, 1: consumer notified, 2: watermark crossed */
+    QAtomicInteger<qint64> mWakeTime;   /* when the consumer was notified */
+    LFQueue<CANFrame>   mTxQueue;       /* producer: sender thread, consumer: working thread */
+    QAtomicInt          mTxWakeState;   /* 0: idle, 1: drain scheduled */
+    QAtomicInt          mTxPending;     /* frames accepted and not handed to the device yet, read from any thread */
+    quint64             mTxSeq;         /* producer: last accepted frame */
+    quint64             mTxDoneSeq;     /* consumer: last frame handed to the device */
+    QAtomicInteger<quint64> mTxSent;
+    QAtomicInteger<quint64> mTxFailed;
     const QString       mPort;
     const QString       mType;
-    bool                mIsCapSuspended;
+    QAtomicInt          mIsCapSuspended; //read by the consumer thread
     QAtomicInt          mStatus;
     bool                mStarted;
     BusData*            mBusData_p;
     QThread*            mThread_p;
+
+    /* targetted frames: filters are edited from the GUI thread and matched in the working thread */
+    struct TargetMatch {
+        bool                batch;  /* observer has a gotTargettedFrames slot */
+        QVector<CANFrame>   frames;
+    };
+    QMutex                          mTargetLock;
+    QAtomicInt                      mNumTargets;
+    QAtomicInt                      mTargetGen;         /* bumped each time the filters are compiled */
+    int                             mReadTargetGen;     /* working thread only, mTargetGen of its copy */
+    QHash<QObject*, int>            mTargetObservers;   /* number of filters per observer */
+    QHash<QObject*, TargetMatch>    mPendingTargets;    /* working thread only */
 };
 
 #endif // CANCONNECTION_H
@@ -45,6 +45,15 @@ QVariant CANConnectionModel::headerData(int section, Qt::Orientation orientation
         case 7:
             return QString(tr("Active"));
             break;
+        case 8:
+            return QString(tr("Dropped"));
+            break;
+        case 9:
+            return QString(tr("Queue Peak"));
+            break;
+        case 10:
+            return QString(tr("TX"));
+            break;
         }
     }
 
@@ -58,7 +67,7 @@ QVariant CANConnectionModel::headerData(int section, Qt::Orientation orientation
 int CANConnectionModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    return 7;
+    return 11;
 }
 
 
@@ -117,6 +126,15 @@ QVariant CANConnectionModel::data(const QModelIndex &index, int role) const
                 return (conn_p->getStatus() == CANConnection::Connected) ? "Connected" : "Disconnected";
             case 7: //Active
                 return (bus.active) ? "True" : "False";
+            case 8: //Dropped frames on this bus
+                return QString::number(conn_p->getDroppedFrames(busId));
+            case 9: //Queue high water mark of the whole connection
+                return QString::number(conn_p->getQueueHighWater()) + " / " + QString::number(conn_p->getQueueCapacity());
+            case 10: { //Transmit rate, queue depth and failures of the whole connection
+                quint64 sent, failed;
+                int depth = conn_p->getTxStats(sent, failed);
+                return tr("%1 f/s, %2 queued, %3 failed").arg(mTxRates.value(conn_p).rate).arg(depth).arg(failed);
+            }
             default: {}
         }
     }
@@ -182,3 +200,29 @@ void CANConnectionModel::refresh(int pIndex)
     }
     dataChanged(begin, end, QVector<int>(Qt::DisplayRole));
 }
+
+
+void CANConnectionModel::refreshStats()
+{
+    if(rowCount() == 0)
+        return;
+
+    qint64 elapsed = mTxRateTimer.isValid() ? mTxRateTimer.restart() : 0;
+    if(!mTxRateTimer.isValid())
+        mTxRateTimer.start();
+
+    QHash<const CANConnection*, TxRate> rates;
+    foreach(CANConnection* conn_p, CANConManager::getInstance()->getConnections())
+    {
+        quint64 sent, failed;
+        conn_p->getTxStats(sent, failed);
+
+        TxRate rate = {sent, 0};
+        if(elapsed > 0 && mTxRates.contains(conn_p) && sent >= mTxRates[conn_p].lastSent)
+            rate.rate = (int) ((sent - mTxRates[conn_p].lastSent) * 1000 / elapsed);
+        rates.insert(conn_p, rate);
+    }
+    mTxRates = rates;
+
+    dataChanged(createIndex(0, 8), createIndex(rowCount()-1, 10), QVector<int>(Qt::DisplayRole));
+}
@@ -3,6 +3,8 @@
 
 
 #include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QHash>
 
 #include "canbus.h"
 
@@ -27,6 +29,16 @@ public:
 
     CANConnection* getAtIdx(int, int&) const;
     void refresh(int pIndex=-1);
+    void refreshStats();
+
+private:
+    /* transmit rate (frames/s) computed on each refreshStats */
+    struct TxRate {
+        quint64 lastSent;
+        int     rate;
+    };
+    QHash<const CANConnection*, TxRate> mTxRates;
+    QElapsedTimer mTxRateTimer;
 };
 
 #endif // CANCONNECTIONMODEL_H
@@ -1,12 +1,15 @@
 #include <QCanBus>
 #include <QComboBox>
 #include <QThread>
+#include <QDir>
+#include <QFile>
 
 #include "connectionwindow.h"
 #include "mainwindow.h"
 #include "ui_connectionwindow.h"
 #include "connections/canconfactory.h"
 #include "connections/canconmanager.h"
+#include "connections/simulatedconnection.h"
 #include "canbus.h"
 
 
@@ -33,6 +36,9 @@ ConnectionWindow::ConnectionWindow(QWidget *parent) :
     ui->tableConnections->setColumnWidth(5, 75);
     ui->tableConnections->setColumnWidth(6, 75);
     ui->tableConnections->setColumnWidth(7, 75);
+    ui->tableConnections->setColumnWidth(8, 75);
+    ui->tableConnections->setColumnWidth(9, 100);
+    ui->tableConnections->setColumnWidth(10, 200);
     QHeaderView *HorzHdr = ui->tableConnections->horizontalHeader();
     HorzHdr->setStretchLastSection(true); //causes the data column to automatically fill the tableview
 
@@ -42,6 +48,10 @@ ConnectionWindow::ConnectionWindow(QWidget *parent) :
 #ifdef Q_OS_WIN
     ui->cbType->addItem(CANConnection::typeKvaser());
 #endif
+#ifdef Q_OS_LINUX
+    ui->cbType->addItem(CANConnection::typeSocketCan());
+#endif
+    ui->cbType->addItem(CANConnection::typeSimulated());
     ui->cbType->addItems(QCanBus::instance()->plugins());
 
     ui->cbSpeed->addItem(tr("125000"));
@@ -72,6 +82,11 @@ ConnectionWindow::ConnectionWindow(QWidget *parent) :
     connect(ui->btnSendHex, &QPushButton::clicked, this, &ConnectionWindow::handleSendHex);
     connect(ui->btnSendText, &QPushButton::clicked, this, &ConnectionWindow::handleSendText);
     connect(ui->ckEnableConsole, &QCheckBox::toggled, this, &ConnectionWindow::consoleEnableChanged);
+    connect(ui->btnResetStats, &QPushButton::clicked, this, &ConnectionWindow::handleResetStats);
+
+    /* drop counters and queue peaks are refreshed while the window is shown */
+    connect(&statsTimer, &QTimer::timeout, this, &ConnectionWindow::handleStatsTick);
+    statsTimer.setInterval(1000);
 }
 
 ConnectionWindow::~ConnectionWindow()
@@ -82,10 +97,11 @@ ConnectionWindow::~ConnectionWindow()
     /* save configuration */
     saveConnections();
 
-    /* delete connections */
+    /* delete connections, going through the manager so the ingest thread lets go of them first */
     while(!conns.isEmpty())
     {
-        conn_p = conns.takeFirst();
+        conn_p = conns.first();
+        CANConManager::getInstance()->remove(conn_p);
         conn_p->stop();
         delete conn_p;
     }
@@ -99,6 +115,7 @@ void ConnectionWindow::showEvent(QShowEvent* event)
     QDialog::showEvent(event);
     qDebug() << "Show connectionwindow";
     readSettings();
+    statsTimer.start();
     ui->tableConnections->selectRow(0);
     currentRowChanged(ui->tableConnections->currentIndex(), ui->tableConnections->currentIndex());
 }
@@ -106,6 +123,7 @@ void ConnectionWindow::showEvent(QShowEvent* event)
 void ConnectionWindow::closeEvent(QCloseEvent *event)
 {
     Q_UNUSED(event);
+    statsTimer.stop();
     writeSettings();
 }
 
@@ -205,6 +223,10 @@ void ConnectionWindow::handleConnectionTypeChanged(const QString &type)
         selectSerial();
     else if (type == CANConnection::typeKvaser())
         selectKvaser();
+    else if (type == CANConnection::typeSocketCan())
+        selectSocketCan();
+    else if (type == CANConnection::typeSimulated())
+        selectSimulated();
     else
         selectSerialBus();
 }
@@ -220,6 +242,23 @@ void ConnectionWindow::handleConnectionStatusChanged(CANConnection::Status statu
 }
 
 
+void ConnectionWindow::handleStatsTick()
+{
+    connModel->refreshStats();
+}
+
+
+void ConnectionWindow::handleResetStats()
+{
+    QList<CANConnection*>& conns = CANConManager::getInstance()->getConnections();
+
+    foreach(CANConnection* conn_p, conns)
+        conn_p->resetQueueStats();
+
+    connModel->refreshStats();
+}
+
+
 void ConnectionWindow::handleOKButton()
 {
     int whichRow = ui->tableConnections->selectionModel()->currentIndex().row();
@@ -348,6 +387,7 @@ void ConnectionWindow::selectSerial()
 {
     ui->cbSpeed->setEnabled(true);
 
+    ui->cbPort->setEditable(false);
     ui->cbPort->clear();
     ports = QSerialPortInfo::availablePorts();
 
@@ -360,11 +400,42 @@ void ConnectionWindow::selectKvaser()
     ui->cbSpeed->setEnabled(false);
 }
 
+void ConnectionWindow::selectSocketCan()
+{
+    /* the bitrate is set with the ip command */
+    ui->cbSpeed->setEnabled(false);
+
+    /* vcan interfaces may be created later, let the name be typed in */
+    ui->cbPort->setEditable(true);
+    ui->cbPort->clear();
+
+    /* CAN interfaces have type ARPHRD_CAN */
+    QDir netDir("/sys/class/net");
+    foreach(const QString& ifName, netDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QFile typeFile(netDir.filePath(ifName + "/type"));
+        if(typeFile.open(QIODevice::ReadOnly) && typeFile.readAll().trimmed() == "280")
+            ui->cbPort->addItem(ifName);
+    }
+}
+
+void ConnectionWindow::selectSimulated()
+{
+    /* the speed is used to compute the bus load */
+    ui->cbSpeed->setEnabled(true);
+
+    /* the port describes the traffic, see SimulatedConnection */
+    ui->cbPort->setEditable(true);
+    ui->cbPort->clear();
+    ui->cbPort->addItems(SimulatedConnection::getDefaultConfigs());
+}
+
 void ConnectionWindow::selectSerialBus()
 {
     const QString plugin = ui->cbType->currentText();
     ui->cbSpeed->setEnabled(plugin != "socketcan");
 
+    ui->cbPort->setEditable(false);
     ui->cbPort->clear();
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
@@ -403,6 +474,16 @@ void ConnectionWindow::setPortName(const QString &typeName, const QString &portN
         ui->cbPort->setCurrentText(portName);
     } else if (typeName == CANConnection::typeKvaser()) {
 
+    } else if (typeName == CANConnection::typeSocketCan()) {
+        ui->cbSpeed->setEnabled(false);
+        ui->ckListenOnly->setEnabled(false);
+        ui->ckSingleWire->setEnabled(false);
+        ui->cbPort->setCurrentText(portName);
+    } else if (typeName == CANConnection::typeSimulated()) {
+        ui->cbSpeed->setEnabled(true);
+        ui->ckListenOnly->setEnabled(false);
+        ui->ckSingleWire->setEnabled(false);
+        ui->cbPort->setCurrentText(portName);
     } else {
         // you can't configure any of the below three with QtSerialBus, so dim them out
         ui->ckListenOnly->setEnabled(false);
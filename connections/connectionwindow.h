@@ -57,15 +57,20 @@ private slots:
     void handleSendHex();
     void handleSendText();
     void handleConnectionStatusChanged(CANConnection::Status status);
+    void handleStatsTick();
+    void handleResetStats();
 
 private:
     Ui::ConnectionWindow *ui;
     QList<QSerialPortInfo> ports;
     QSettings *settings;
     CANConnectionModel *connModel;
+    QTimer statsTimer;
 
     void selectSerial();
     void selectKvaser();
+    void selectSocketCan();
+    void selectSimulated();
     void selectSerialBus();
     int getSpeed();
     void setPortName(const QString &typeName, const QString &portName);
@@ -4,6 +4,7 @@
 #include <QSerialPortInfo>
 #include <QSettings>
 #include <QStringBuilder>
+#include <string.h>
 
 #include "gvretserial.h"
 
@@ -53,9 +54,7 @@ void GVRetSerial::piSuspend(bool pSuspend)
     /* update capSuspended */
     setCapSuspended(pSuspend);
 
-    /* flush queue if we are suspended */
-    if(isCapSuspended())
-        getQueue().flush();
+    /* what is queued gets dropped by the consumer, see CANConnection::suspend */
 }
 
 
@@ -315,18 +314,80 @@ void GVRetSerial::connectionTimeout()
 void GVRetSerial::readSerialData()
 {
     QByteArray data = serial->readAll();
-    unsigned char c;
-    QString debugBuild;
-    debugOutput("Got data from serial. Len = " % QString::number(data.length()));
+    //the hex dump is only worth building if someone shows it
+    bool debugging = (receivers(SIGNAL(debugOutput(QString))) > 0);
+
+    if (debugging) debugOutput("Got data from serial. Len = " % QString::number(data.length()));
     //qDebug() << (tr("Got data from serial. Len = %0").arg(data.length()));
-    for (int i = 0; i < data.length(); i++)
+
+    procRXData(data.constData(), data.length());
+
+    notifyFramesQueued();
+    flushTargettedFrames();
+
+    if (debugging)
     {
-        c = data.at(i);
-        //qDebug() << c << "    " << QString::number(c, 16) << "     " << QString(c);
-        debugBuild = debugBuild % QString::number(c, 16) % " ";
-        procRXChar(c);
+        QString debugBuild;
+        for (int i = 0; i < data.length(); i++) debugBuild = debugBuild % QString::number((unsigned char)data.at(i), 16) % " ";
+        debugOutput(debugBuild);
+    }
+}
+
+/*
+ * A CAN frame record is F1 00, timestamp (4 bytes), ID (4 bytes, bit 31 = extended),
+ * length | bus << 4, the data bytes and a trailing byte, all little endian. Records that
+ * are entirely in the block are decoded directly, this is what nearly all of the traffic is.
+ */
+void GVRetSerial::procRXData(const char* pData, int pLen)
+{
+    const unsigned char* data = (const unsigned char*) pData;
+    int i = 0;
+
+    while (i < pLen)
+    {
+        if (rx_state != IDLE)
+        {
+            //finish the record or command started in the previous block
+            procRXChar(data[i++]);
+            continue;
+        }
+
+        //skip to the next record
+        const unsigned char* start = (const unsigned char*) memchr(data + i, 0xF1, pLen - i);
+        if (!start) break;
+        i = start - data;
+
+        //need the header up to the length byte to know the record length
+        if (i + 11 > pLen || data[i + 1] != 0)
+        {
+            procRXChar(data[i++]);
+            continue;
+        }
+
+        const unsigned char* rec = data + i + 2;
+        uint32_t len = rec[8] & 0xF;
+        if (len > 8) len = 8;
+        int recLen = 12 + len;
+        if (i + recLen > pLen)
+        {
+            procRXChar(data[i++]);
+            continue;
+        }
+
+        buildFrame.timestamp = (uint32_t)(rec[0] | (rec[1] << 8) | (rec[2] << 16) | ((uint32_t)rec[3] << 24));
+        buildFrame.timestamp += timeBasis;
+        if (useSystemTime) buildFrame.timestamp = QDateTime::currentMSecsSinceEpoch() * 1000l;
+
+        buildFrame.ID = rec[4] | (rec[5] << 8) | (rec[6] << 16) | ((uint32_t)rec[7] << 24);
+        buildFrame.extended = (buildFrame.ID & 1u << 31) != 0;
+        buildFrame.ID &= 0x7FFFFFFF;
+        buildFrame.len = len;
+        buildFrame.bus = (rec[8] & 0xF0) >> 4;
+        memcpy(buildFrame.data, rec + 9, len);
+
+        queueBuildFrame();
+        i += recLen;
     }
-    debugOutput(debugBuild);
 }
 
 //Debugging data sent from connection window. Inject it into Comm traffic.
@@ -437,26 +498,7 @@ void GVRetSerial::procRXChar(unsigned char c)
             {
                 rx_state = IDLE;
                 rx_step = 0;
-                buildFrame.isReceived = true;
-
-                if (!isCapSuspended())
-                {
-                    /* get frame from queue */
-                    CANFrame* frame_p = getQueue().get();
-                    if(frame_p) {
-                        //qDebug() << "GVRET got frame on bus " << frame_p->bus;
-                        /* copy frame */
-                        *frame_p = buildFrame;
-                        checkTargettedFrame(buildFrame);
-                        /* enqueue frame */
-                        getQueue().queue();
-                    }
-                    else
-                        qDebug() << "can't get a frame, ERROR";
-
-                    //take the time the frame came in and try to resync the time base.
-                    //if (continuousTimeSync) txTimestampBasis = QDateTime::currentMSecsSinceEpoch() - (buildFrame.timestamp / 1000);
-                }
+                queueBuildFrame();
             }
             break;
         }
@@ -612,6 +654,28 @@ void GVRetSerial::procRXChar(unsigned char c)
     }
 }
 
+void GVRetSerial::queueBuildFrame()
+{
+    buildFrame.isReceived = true;
+
+    if (!isCapSuspended())
+    {
+        /* get frame from queue, drops are accounted for by the connection */
+        CANFrame* frame_p = getQueueSlot(buildFrame.bus);
+        if(frame_p) {
+            //qDebug() << "GVRET got frame on bus " << frame_p->bus;
+            /* copy frame */
+            *frame_p = buildFrame;
+            checkTargettedFrame(buildFrame);
+            /* enqueue frame */
+            getQueue().queue();
+        }
+
+        //take the time the frame came in and try to resync the time base.
+        //if (continuousTimeSync) txTimestampBasis = QDateTime::currentMSecsSinceEpoch() - (buildFrame.timestamp / 1000);
+    }
+}
+
 void GVRetSerial::rebuildLocalTimeBasis()
 {
     qDebug() << "Rebuilding GVRET time base. GVRET local base = " << buildTimeBasis;
@@ -55,6 +55,14 @@ protected:
 
     void disconnectDevice();
 
+    /**
+     * @brief procRXData parses a block of data received from the device
+     * @note complete frame records are decoded in one go, everything else
+     * (commands, records split across two blocks) goes through procRXChar
+     */
+    void procRXData(const char* pData, int pLen);
+    void procRXChar(unsigned char);
+
 public slots:
     void debugInput(QByteArray bytes);
 
@@ -66,7 +74,7 @@ private slots:
 
 private:
     void readSettings();
-    void procRXChar(unsigned char);
+    void queueBuildFrame();
     void sendCommValidation();
     void rebuildLocalTimeBasis();
 
@@ -39,9 +39,7 @@ void SerialBusConnection::piSuspend(bool pSuspend)
     /* update capSuspended */
     setCapSuspended(pSuspend);
 
-    /* flush queue if we are suspended */
-    if(isCapSuspended())
-        getQueue().flush();
+    /* what is queued gets dropped by the consumer, see CANConnection::suspend */
 }
 
 
@@ -182,7 +180,7 @@ void SerialBusConnection::framesReceived()
 
         /* check frame */
         if (recFrame.payload().length() <= 8) {
-            CANFrame* frame_p = getQueue().get();
+            CANFrame* frame_p = getQueueSlot(0);
             if(frame_p) {
                 frame_p->len           = static_cast<uint32_t>(recFrame.payload().length());
                 frame_p->bus           = 0;
@@ -200,12 +198,11 @@ void SerialBusConnection::framesReceived()
                 /* enqueue frame */
                 getQueue().queue();
             }
-#if 0
-            else
-                qDebug() << "can't get a frame, ERROR";
-#endif
         }
     }
+
+    notifyFramesQueued();
+    flushTargettedFrames();
 }
 
 
@@ -0,0 +1,332 @@
+#include <QDebug>
+#include <QDateTime>
+#include <QStringList>
+#include <string.h>
+#include <algorithm>
+
+#include "simulatedconnection.h"
+#include "canconmanager.h"
+
+/* bus speed used when the bus has not been given one */
+#define SIM_DEFAULT_SPEED   500000
+/* the generator never catches up on more than this (us), e.g. after the thread has been starved */
+#define SIM_MAX_CATCHUP     100000
+
+/* orders the heap on the earliest next frame */
+struct SimIdLater {
+    const QVector<SimulatedConnection::SimId>& ids;
+    bool operator()(int a, int b) const { return ids[a].next > ids[b].next; }
+};
+
+
+/***********************************/
+/****    class definition       ****/
+/***********************************/
+
+SimulatedConnection::SimulatedConnection(const QString &portName) :
+    CANConnection(typeSimulated(), portName, parseConfig(portName).numBuses, 16384, true),
+    mConfig(parseConfig(portName)),
+    mTimer(this), /*NB: set connection as parent of timer to manage it from working thread */
+    mEpoch(0),
+    mLastTick(0),
+    mRandom(mConfig.seed)
+{
+}
+
+
+SimulatedConnection::~SimulatedConnection()
+{
+    stop();
+}
+
+
+SimulatedConnection::Config SimulatedConnection::parseConfig(const QString &pPortName)
+{
+    Config config;
+    config.numBuses = 1;
+    config.numIds   = 32;
+    config.period   = 10000;
+    config.jitter   = 0;
+    config.len      = 8;
+    config.pattern  = Counter;
+    config.extended = false;
+    config.load     = 0;
+    config.burst    = 0;
+    config.every    = 0;
+    config.seed     = 1;
+
+    foreach(const QString& item, pPortName.split(';', QString::SkipEmptyParts))
+    {
+        QString key = item.section('=', 0, 0).trimmed().toLower();
+        QString value = item.section('=', 1).trimmed().toLower();
+        bool ok;
+
+        if(key == "pattern") {
+            if(value == "counter")      config.pattern = Counter;
+            else if(value == "random")  config.pattern = Random;
+            else if(value == "zero")    config.pattern = Zero;
+            else if(value == "walk")    config.pattern = Walk;
+            continue;
+        }
+        if(key == "len" && value == "rand") {
+            config.len = -1;
+            continue;
+        }
+
+        double num = value.toDouble(&ok);
+        if(!ok || num < 0)
+            continue;
+
+        if(key == "buses")          config.numBuses = qBound(1, (int) num, 8);
+        else if(key == "ids")       config.numIds = qBound(1, (int) num, 0x800);
+        else if(key == "period")    config.period = qMax(1, (int) (num * 1000));
+        else if(key == "jitter")    config.jitter = (int) (num * 1000);
+        else if(key == "len")       config.len = qMin((int) num, 8);
+        else if(key == "ext")       config.extended = (num != 0);
+        else if(key == "load")      config.load = (int) num;
+        else if(key == "burst")     config.burst = (int) (num * 1000);
+        else if(key == "every")     config.every = (int) (num * 1000);
+        else if(key == "seed")      config.seed = qMax((quint32) num, 1u); /* xorshift is stuck on 0 */
+    }
+
+    /* the period can't go negative */
+    config.jitter = qMin(config.jitter, config.period - 1);
+
+    return config;
+}
+
+
+QStringList SimulatedConnection::getDefaultConfigs()
+{
+    return QStringList()
+            << "ids=32;period=10"
+            << "buses=2;ids=200;period=10;jitter=2;pattern=random"
+            << "ids=16;period=100;load=100"
+            << "buses=3;ids=64;period=5;ext=1;load=150;burst=200;every=1000";
+}
+
+
+void SimulatedConnection::piStarted()
+{
+    mIds.clear();
+    for(int bus=0 ; bus<getNumBuses() ; bus++)
+    {
+        for(int i=0 ; i<mConfig.numIds ; i++)
+        {
+            SimId simId;
+            simId.id    = mConfig.extended ? (0x18DA0000 + i) : ((0x100 + i) & 0x7FF);
+            simId.bus   = bus;
+            simId.next  = random() % mConfig.period; /* spread ids over the first period */
+            simId.count = 0;
+            mIds.append(simId);
+        }
+    }
+    mSchedule.resize(mIds.count());
+    for(int i=0 ; i<mIds.count() ; i++)
+        mSchedule[i] = i;
+    std::make_heap(mSchedule.begin(), mSchedule.end(), SimIdLater { mIds });
+    mBitCredit.fill(0, getNumBuses());
+    mLoadIdx.fill(0, getNumBuses());
+
+    mEpoch = QDateTime::currentMSecsSinceEpoch() * 1000;
+    mClock.start();
+    mLastTick = 0;
+
+    setStatus(Connected);
+    emit status(getStatus());
+
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(handleTick()));
+    mTimer.setTimerType(Qt::PreciseTimer);
+    mTimer.setInterval(1);
+    mTimer.setSingleShot(false); //keep ticking
+    mTimer.start();
+}
+
+
+void SimulatedConnection::piSuspend(bool pSuspend)
+{
+    /* update capSuspended */
+    setCapSuspended(pSuspend);
+
+    /* what is queued gets dropped by the consumer, see CANConnection::suspend */
+}
+
+
+void SimulatedConnection::piStop()
+{
+    mTimer.stop();
+    setStatus(Disconnected);
+}
+
+
+bool SimulatedConnection::piGetBusSettings(int pBusIdx, CANBus& pBus)
+{
+    return getBusConfig(pBusIdx, pBus);
+}
+
+
+void SimulatedConnection::piSetBusSettings(int pBusIdx, CANBus pBus)
+{
+    /* sanity checks */
+    if( (pBusIdx < 0) || pBusIdx >= getNumBuses())
+        return;
+
+    /* traffic is generated on active buses only */
+    setBusConfig(pBusIdx, pBus);
+}
+
+
+bool SimulatedConnection::piSendFrame(const CANFrame& pFrame)
+{
+    CANBus bus;
+
+    /* nothing to send it to, accept it if the bus is active */
+    return getBusConfig(pFrame.bus, bus) && bus.active;
+}
+
+
+/***********************************/
+/****   private methods         ****/
+/***********************************/
+
+
+/* xorshift, cheap and reproducible for a given seed */
+quint32 SimulatedConnection::random()
+{
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return mRandom;
+}
+
+
+void SimulatedConnection::fillFrame(CANFrame& pFrame, SimId& pId)
+{
+    pFrame.ID       = pId.id;
+    pFrame.extended = mConfig.extended;
+    pFrame.bus      = pId.bus;
+    pFrame.len      = (mConfig.len < 0) ? random() % 9 : mConfig.len;
+    pFrame.isReceived = true;
+
+    switch(mConfig.pattern)
+    {
+        case Counter:
+            memset(pFrame.data, 0, sizeof(pFrame.data));
+            pFrame.data[0] = (unsigned char) pId.count;
+            pFrame.data[1] = (unsigned char) (pId.count >> 8);
+            pFrame.data[2] = (unsigned char) pId.id;
+            pFrame.data[3] = (unsigned char) (pId.id >> 8);
+            break;
+        case Random:
+            for(int i=0 ; i<8 ; i++)
+                pFrame.data[i] = (unsigned char) random();
+            break;
+        case Walk:
+            memset(pFrame.data, 0, sizeof(pFrame.data));
+            if(pFrame.len)
+                pFrame.data[(pId.count / 8) % pFrame.len] = 1 << (pId.count % 8);
+            break;
+        case Zero:
+        default:
+            memset(pFrame.data, 0, sizeof(pFrame.data));
+            break;
+    }
+
+    pId.count++;
+}
+
+
+bool SimulatedConnection::queueFrame(SimId& pId, qint64 pTime)
+{
+    CANFrame* frame_p = getQueueSlot(pId.bus);
+    if(!frame_p) {
+        /* dropped, but the id goes on counting as a real device would */
+        pId.count++;
+        return false;
+    }
+
+    fillFrame(*frame_p, pId);
+
+    frame_p->timestamp = mEpoch + pTime;
+    if(!useSystemTime) frame_p->timestamp -= CANConManager::getInstance()->getTimeBasis();
+
+    checkTargettedFrame(*frame_p);
+    getQueue().queue();
+    return true;
+}
+
+
+void SimulatedConnection::handleTick()
+{
+    qint64 now = mClock.nsecsElapsed() / 1000;
+    qint64 elapsed = now - mLastTick;
+    mLastTick = now;
+
+    /* the thread has been starved, skip what we missed rather than flooding the queue */
+    if(elapsed > SIM_MAX_CATCHUP) {
+        for(int i=0 ; i<mIds.count() ; i++)
+            mIds[i].next += elapsed - SIM_MAX_CATCHUP;
+        elapsed = SIM_MAX_CATCHUP;
+    }
+
+    if(isCapSuspended())
+        return;
+
+    QVector<bool> active(getNumBuses());
+    QVector<int> speed(getNumBuses());
+    for(int i=0 ; i<getNumBuses() ; i++) {
+        CANBus bus;
+        active[i] = getBusConfig(i, bus) && bus.active;
+        speed[i] = (bus.speed > 0) ? bus.speed : SIM_DEFAULT_SPEED;
+    }
+
+    /* periodic ids, taken in time order so that the queue stays sorted */
+    SimIdLater later = { mIds };
+    while(!mSchedule.isEmpty() && mIds[mSchedule.first()].next <= now)
+    {
+        std::pop_heap(mSchedule.begin(), mSchedule.end(), later);
+        SimId& simId = mIds[mSchedule.last()];
+
+        if(active[simId.bus])
+            queueFrame(simId, simId.next);
+
+        int period = mConfig.period;
+        if(mConfig.jitter)
+            period += (int) (random() % (2 * mConfig.jitter + 1)) - mConfig.jitter;
+        simId.next += period;
+
+        std::push_heap(mSchedule.begin(), mSchedule.end(), later);
+    }
+
+    /* load generator, frames are spread over the ids of the bus and stamped with the tick time */
+    bool inBurst = (mConfig.every <= 0) || ((now % mConfig.every) < mConfig.burst);
+    for(int bus=0 ; bus<getNumBuses() ; bus++)
+    {
+        double& credit = mBitCredit[bus];
+
+        if(mConfig.load <= 0 || !inBurst || !active[bus]) {
+            credit = 0;
+            continue;
+        }
+
+        credit += (double) speed[bus] * mConfig.load / 100 * elapsed / 1000000;
+
+        while(true)
+        {
+            SimId& simId = mIds[bus * mConfig.numIds + mLoadIdx[bus]];
+            int len = (mConfig.len < 0) ? 8 : mConfig.len;
+            /* data frame and interframe space, without stuffing */
+            int bits = (mConfig.extended ? 67 : 47) + 8 * len;
+
+            if(credit < bits)
+                break;
+            credit -= bits;
+
+            queueFrame(simId, now);
+            mLoadIdx[bus] = (mLoadIdx[bus] + 1) % mConfig.numIds;
+        }
+    }
+
+    notifyFramesQueued();
+    flushTargettedFrames();
+}
@@ -0,0 +1,106 @@
+#ifndef SIMULATEDCONNECTION_H
+#define SIMULATEDCONNECTION_H
+
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "canconnection.h"
+
+/**
+ * Generates CAN traffic on its own thread, for load testing the capture pipeline without hardware.
+ *
+ * The traffic is described by the port name, a list of key=value pairs separated by ';':
+ * - buses: number of buses (1 to 8, default 1)
+ * - ids: number of ids per bus, at least 1 (default 32)
+ * - period: period of each id in ms, fractions allowed (default 10)
+ * - jitter: each period is randomly shortened or lengthened by up to that many ms (default 0)
+ * - len: payload length, 0 to 8 or "rand" (default 8)
+ * - pattern: payload, one of counter, random, zero, walk (default counter)
+ * - ext: 1 to use extended ids (default 0)
+ * - load: bus load in percent of the bus speed generated on top of the periodic ids,
+ *   may go beyond 100 (default 0, no load)
+ * - burst, every: the load is only generated during burst ms every "every" ms (default 0, continuous)
+ * - seed: seed of the random generator, the same seed gives the same traffic (default 1)
+ * e.g. "buses=2;ids=100;period=5;jitter=1;load=120;burst=200;every=1000"
+ */
+class SimulatedConnection : public CANConnection
+{
+    Q_OBJECT
+
+public:
+    enum Pattern {
+        Counter,    /*!< first byte counts frames of the id, the others hold the id */
+        Random,     /*!< random bytes */
+        Zero,       /*!< all bytes cleared */
+        Walk        /*!< a single bit walking through the payload */
+    };
+
+    struct Config {
+        int         numBuses;
+        int         numIds;
+        int         period;     /* us */
+        int         jitter;     /* us */
+        int         len;        /* -1: random */
+        Pattern     pattern;
+        bool        extended;
+        int         load;
+        int         burst;      /* us */
+        int         every;      /* us */
+        quint32     seed;
+    };
+
+    SimulatedConnection(const QString &portName);
+    virtual ~SimulatedConnection();
+
+    /**
+     * @brief parseConfig
+     * @param pPortName: the traffic description, see @ref SimulatedConnection
+     * @return the configuration, unknown keys and invalid values are ignored
+     */
+    static Config parseConfig(const QString &pPortName);
+
+    /**
+     * @brief getDefaultConfigs
+     * @return a few traffic descriptions offered in the connection window
+     */
+    static QStringList getDefaultConfigs();
+
+protected:
+
+    virtual void piStarted();
+    virtual void piStop();
+    virtual void piSetBusSettings(int pBusIdx, CANBus pBus);
+    virtual bool piGetBusSettings(int pBusIdx, CANBus& pBus);
+    virtual void piSuspend(bool pSuspend);
+    virtual bool piSendFrame(const CANFrame&);
+
+private slots:
+    void handleTick();
+
+public:
+    struct SimId {
+        quint32     id;
+        int         bus;
+        qint64      next;       /* us, mClock time of the next frame */
+        quint32     count;      /* frames generated */
+    };
+
+private:
+    quint32 random();
+    void fillFrame(CANFrame& pFrame, SimId& pId);
+    bool queueFrame(SimId& pId, qint64 pTime);
+
+    const Config        mConfig;
+    QTimer              mTimer;
+    QElapsedTimer       mClock;
+    qint64              mEpoch;     /* us, system time at which mClock started */
+    qint64              mLastTick;  /* us */
+    quint32             mRandom;
+    QVector<SimId>      mIds;
+    QVector<int>        mSchedule;  /* heap of mIds indices, earliest next frame first */
+    QVector<double>     mBitCredit; /* per bus, bits the load generator may still send */
+    QVector<int>        mLoadIdx;   /* per bus, next id used by the load generator */
+};
+
+#endif // SIMULATEDCONNECTION_H
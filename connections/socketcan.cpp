@@ -0,0 +1,386 @@
+#include <QDebug>
+#include <QDateTime>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "socketcan.h"
+#include "canconmanager.h"
+
+/* allocated once, recvmmsg fills it in place */
+struct SocketCanRx {
+    struct can_frame    frames[SOCKETCAN_BATCH];
+    struct iovec        iov[SOCKETCAN_BATCH];
+    struct mmsghdr      msgs[SOCKETCAN_BATCH];
+    char                ctrl[SOCKETCAN_BATCH][CMSG_SPACE(sizeof(struct scm_timestamping))];
+};
+
+
+/***********************************/
+/****    class definition       ****/
+/***********************************/
+
+SocketCan::SocketCan(const QString &portName) :
+    CANConnection(typeSocketCan(), portName, 1, 16384, true),
+    mSocket(-1),
+    mNotifier_p(NULL),
+    mTimer(this), /*NB: set connection as parent of timer to manage it from working thread */
+    mHwTimestamps(false),
+    mHwOffset(0)
+{
+    mRx_p = new SocketCanRx;
+    memset(mRx_p, 0, sizeof(SocketCanRx));
+
+    for(int i=0 ; i<SOCKETCAN_BATCH ; i++)
+    {
+        mRx_p->iov[i].iov_base = &mRx_p->frames[i];
+        mRx_p->iov[i].iov_len = sizeof(struct can_frame);
+        mRx_p->msgs[i].msg_hdr.msg_iov = &mRx_p->iov[i];
+        mRx_p->msgs[i].msg_hdr.msg_iovlen = 1;
+        mRx_p->msgs[i].msg_hdr.msg_control = mRx_p->ctrl[i];
+    }
+}
+
+
+SocketCan::~SocketCan()
+{
+    stop();
+    delete mRx_p;
+}
+
+
+void SocketCan::piStarted()
+{
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(testConnection()));
+    mTimer.setInterval(1000);
+    mTimer.setSingleShot(false); //keep ticking
+    mTimer.start();
+}
+
+
+void SocketCan::piSuspend(bool pSuspend)
+{
+    /* update capSuspended */
+    setCapSuspended(pSuspend);
+
+    /* what is queued gets dropped by the consumer, see CANConnection::suspend */
+}
+
+
+void SocketCan::piStop()
+{
+    mTimer.stop();
+    disconnectDevice();
+    setConnected(false);
+}
+
+
+bool SocketCan::piGetBusSettings(int pBusIdx, CANBus& pBus)
+{
+    return getBusConfig(pBusIdx, pBus);
+}
+
+
+void SocketCan::piSetBusSettings(int pBusIdx, CANBus bus)
+{
+    /* sanity checks */
+    if(0 != pBusIdx)
+        return;
+
+    /* disconnect device if we have one connected */
+    disconnectDevice();
+
+    /* copy bus config */
+    setBusConfig(0, bus);
+
+    /* if bus is not active we are done */
+    if(!bus.active) {
+        setConnected(false);
+        return;
+    }
+
+    //The speed of a socketcan interface has to be set with console commands.
+    setConnected(connectDevice());
+}
+
+
+bool SocketCan::piSendFrame(const CANFrame& pFrame)
+{
+    /* sanity checks */
+    if(0 != pFrame.bus || pFrame.len>8)
+        return false;
+
+    if(mSocket < 0) return false;
+
+    struct can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = pFrame.extended ? ((pFrame.ID & CAN_EFF_MASK) | CAN_EFF_FLAG) : (pFrame.ID & CAN_SFF_MASK);
+    frame.can_dlc = pFrame.len;
+    memcpy(frame.data, pFrame.data, pFrame.len);
+
+    return ::write(mSocket, &frame, sizeof(frame)) == (ssize_t) sizeof(frame);
+}
+
+
+bool SocketCan::piSetFilters(int pBusIdx, const QVector<CANFlt>& pFilters)
+{
+    Q_UNUSED(pBusIdx);
+
+    mFilters = pFilters;
+
+    /* applied when the socket is opened otherwise */
+    if(mSocket < 0)
+        return true;
+
+    return applyFilters();
+}
+
+
+/***********************************/
+/****   private methods         ****/
+/***********************************/
+
+
+bool SocketCan::connectDevice()
+{
+    QByteArray ifName = getPort().toLatin1();
+    struct ifreq ifr;
+    struct sockaddr_can addr;
+
+    if(ifName.isEmpty() || ifName.length() >= IFNAMSIZ)
+        return false;
+
+    mSocket = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if(mSocket < 0) {
+        qDebug() << "can't create socket:" << strerror(errno);
+        return false;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifName.constData(), IFNAMSIZ - 1);
+    if(ioctl(mSocket, SIOCGIFINDEX, &ifr) < 0) {
+        qDebug() << "can't find interface" << getPort();
+        disconnectDevice();
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if(bind(mSocket, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        qDebug() << "can't bind to" << getPort() << ":" << strerror(errno);
+        disconnectDevice();
+        return false;
+    }
+
+    /* hardware timestamps if the interface has them, software ones in any case */
+    int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if(setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        int on = 1;
+        setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    }
+    mHwTimestamps = false;
+
+    /* room for bursts between two reads, the kernel caps it to rmem_max */
+    int rcvBuf = 1024 * 1024;
+    setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+
+    if(!applyFilters())
+        qDebug() << "can't set filters on" << getPort();
+
+    mNotifier_p = new QSocketNotifier(mSocket, QSocketNotifier::Read, this);
+    connect(mNotifier_p, SIGNAL(activated(int)), this, SLOT(readFrames()));
+
+    return true;
+}
+
+
+/* disconnect device */
+void SocketCan::disconnectDevice()
+{
+    if(mNotifier_p) {
+        /* we may be in its activated() slot after a read error, it can't be deleted right away */
+        mNotifier_p->setEnabled(false);
+        mNotifier_p->deleteLater();
+        mNotifier_p = NULL;
+    }
+    if(mSocket >= 0) {
+        ::close(mSocket);
+        mSocket = -1;
+    }
+}
+
+
+void SocketCan::setConnected(bool pConnected)
+{
+    Status newStatus = pConnected ? Connected : Disconnected;
+
+    if(getStatus() != newStatus) {
+        setStatus(newStatus);
+        emit status(getStatus());
+    }
+}
+
+
+bool SocketCan::applyFilters()
+{
+    QVector<struct can_filter> filters(mFilters.count());
+
+    /* flags are left out of the mask so that a filter matches standard and extended frames alike */
+    for(int i=0 ; i<mFilters.count() ; i++) {
+        filters[i].can_id   = mFilters[i].id & CAN_EFF_MASK;
+        filters[i].can_mask = mFilters[i].mask & CAN_EFF_MASK;
+    }
+
+    /* no filter: everything passes */
+    if(filters.isEmpty()) {
+        struct can_filter all;
+        all.can_id = 0;
+        all.can_mask = 0;
+        filters.append(all);
+    }
+
+    return setsockopt(mSocket, SOL_CAN_RAW, CAN_RAW_FILTER,
+                      filters.constData(), filters.count() * sizeof(struct can_filter)) == 0;
+}
+
+
+/* time of reception in us since epoch */
+uint64_t SocketCan::getTimestamp(msghdr* pHdr_p)
+{
+    for(struct cmsghdr* cmsg_p = CMSG_FIRSTHDR(pHdr_p) ; cmsg_p ; cmsg_p = CMSG_NXTHDR(pHdr_p, cmsg_p))
+    {
+        if(cmsg_p->cmsg_level != SOL_SOCKET)
+            continue;
+
+        if(cmsg_p->cmsg_type == SCM_TIMESTAMPING)
+        {
+            struct scm_timestamping ts;
+            memcpy(&ts, CMSG_DATA(cmsg_p), sizeof(ts));
+
+            int64_t sw = (int64_t) ts.ts[0].tv_sec * 1000000 + ts.ts[0].tv_nsec / 1000;
+            int64_t hw = (int64_t) ts.ts[2].tv_sec * 1000000 + ts.ts[2].tv_nsec / 1000;
+
+            /* the hardware clock has its own origin, rebase it on the system clock once */
+            if(hw) {
+                if(!mHwTimestamps) {
+                    mHwTimestamps = true;
+                    mHwOffset = (sw ? sw : QDateTime::currentMSecsSinceEpoch() * 1000) - hw;
+                }
+                return hw + mHwOffset;
+            }
+            if(sw)
+                return sw;
+        }
+        else if(cmsg_p->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg_p), sizeof(ts));
+            return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        }
+    }
+
+    return QDateTime::currentMSecsSinceEpoch() * 1000;
+}
+
+
+void SocketCan::readFrames()
+{
+    uint64_t timeBasis = useSystemTime ? 0 : CANConManager::getInstance()->getTimeBasis();
+    int count;
+
+    do
+    {
+        /* the kernel overwrites the control length */
+        for(int i=0 ; i<SOCKETCAN_BATCH ; i++)
+            mRx_p->msgs[i].msg_hdr.msg_controllen = sizeof(mRx_p->ctrl[i]);
+
+        count = recvmmsg(mSocket, mRx_p->msgs, SOCKETCAN_BATCH, MSG_DONTWAIT, NULL);
+        if(count < 0) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                /* interface went down, testConnection reconnects */
+                qDebug() << "can't read from" << getPort() << ":" << strerror(errno);
+                disconnectDevice();
+                setConnected(false);
+            }
+            break;
+        }
+
+        /* drop frames if capture is suspended */
+        if(isCapSuspended())
+            continue;
+
+        for(int i=0 ; i<count ; i++)
+        {
+            const struct can_frame& frame = mRx_p->frames[i];
+
+            /* error frames are not captured */
+            if(mRx_p->msgs[i].msg_len < sizeof(struct can_frame) || (frame.can_id & CAN_ERR_FLAG))
+                continue;
+
+            CANFrame* frame_p = getQueueSlot(0);
+            if(!frame_p)
+                continue;
+
+            frame_p->bus        = 0;
+            frame_p->extended   = (frame.can_id & CAN_EFF_FLAG) != 0;
+            frame_p->ID         = frame.can_id & (frame_p->extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+            frame_p->len        = qMin((int) frame.can_dlc, 8);
+            frame_p->isReceived = true;
+            memcpy(frame_p->data, frame.data, 8);
+            frame_p->timestamp  = getTimestamp(&mRx_p->msgs[i].msg_hdr) - timeBasis;
+
+            checkTargettedFrame(*frame_p);
+
+            /* enqueue frame */
+            getQueue().queue();
+        }
+    } while(count == SOCKETCAN_BATCH);
+
+    notifyFramesQueued();
+    flushTargettedFrames();
+}
+
+
+void SocketCan::testConnection()
+{
+    CANBus bus;
+    if(!getBusConfig(0, bus) || !bus.active)
+        return;
+
+    /* (re)open the socket once the interface is up */
+    if(mSocket < 0) {
+        struct ifreq ifr;
+        int sock = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+        bool up = false;
+
+        if(sock >= 0) {
+            memset(&ifr, 0, sizeof(ifr));
+            strncpy(ifr.ifr_name, getPort().toLatin1().constData(), IFNAMSIZ - 1);
+            up = (ioctl(sock, SIOCGIFFLAGS, &ifr) == 0) && (ifr.ifr_flags & IFF_UP);
+            ::close(sock);
+        }
+
+        if(up)
+            setConnected(connectDevice());
+        return;
+    }
+
+    /* the interface may have disappeared (USB adapter unplugged for instance) */
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, getPort().toLatin1().constData(), IFNAMSIZ - 1);
+    if(ioctl(mSocket, SIOCGIFFLAGS, &ifr) < 0 || !(ifr.ifr_flags & IFF_UP)) {
+        disconnectDevice();
+        setConnected(false);
+    }
+}
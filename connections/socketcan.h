@@ -0,0 +1,63 @@
+#ifndef SOCKETCAN_H
+#define SOCKETCAN_H
+
+#include <QTimer>
+#include <QSocketNotifier>
+
+#include "canconnection.h"
+
+struct msghdr;
+struct SocketCanRx;
+
+/* number of frames read from the socket in a single recvmmsg call */
+#define SOCKETCAN_BATCH     64
+
+/**
+ * Native Linux SocketCAN connection (the port is the interface name, e.g. can0 or vcan0).
+ *
+ * Frames are read in batches with recvmmsg into buffers allocated once, and written to the
+ * queue without going through QCanBusFrame. Timestamps come from the kernel (SO_TIMESTAMPING):
+ * hardware timestamps when the interface provides them, rebased on the system clock, software
+ * receive timestamps otherwise. Receive filters are handed to the kernel with CAN_RAW_FILTER.
+ * The bus speed can't be set from here, it is configured with the ip command like any interface.
+ */
+class SocketCan : public CANConnection
+{
+    Q_OBJECT
+
+public:
+    SocketCan(const QString &portName);
+    virtual ~SocketCan();
+
+protected:
+
+    virtual void piStarted();
+    virtual void piStop();
+    virtual void piSetBusSettings(int pBusIdx, CANBus pBus);
+    virtual bool piGetBusSettings(int pBusIdx, CANBus& pBus);
+    virtual void piSuspend(bool pSuspend);
+    virtual bool piSendFrame(const CANFrame&);
+    virtual bool piSetFilters(int pBusIdx, const QVector<CANFlt>& pFilters);
+
+    bool connectDevice();
+    void disconnectDevice();
+
+private slots:
+    void readFrames();
+    void testConnection();
+
+private:
+    bool applyFilters();
+    void setConnected(bool pConnected);
+    uint64_t getTimestamp(msghdr* pHdr_p);
+
+    int                 mSocket;
+    QSocketNotifier*    mNotifier_p;
+    QTimer              mTimer;
+    QVector<CANFlt>     mFilters;
+    bool                mHwTimestamps;
+    int64_t             mHwOffset;      /* us, system time minus hardware time */
+    SocketCanRx*        mRx_p;      /* recvmmsg buffers */
+};
+
+#endif // SOCKETCAN_H
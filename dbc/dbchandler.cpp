@@ -1238,6 +1238,7 @@ int DBCHandler::createBlankFile()
     newFile.dbc_attributes.append(attr);
 
     loadedFiles.append(newFile);
+    emit filesChanged();
     return loadedFiles.count();
 }
 
@@ -1267,6 +1268,7 @@ DBCFile* DBCHandler::loadDBCFile(int idx)
         DBCFile newFile;
         newFile.loadFile(filename);
         loadedFiles.append(newFile);
+        emit filesChanged();
 
         return &loadedFiles.last();
     }
@@ -1280,11 +1282,13 @@ void DBCHandler::removeDBCFile(int idx)
     if (idx < 0) return;
     if (idx >= loadedFiles.count()) return;
     loadedFiles.removeAt(idx);
+    emit filesChanged();
 }
 
 void DBCHandler::removeAllFiles()
 {
     loadedFiles.clear();
+    emit filesChanged();
 }
 
 void DBCHandler::swapFiles(int pos1, int pos2)
@@ -1296,6 +1300,12 @@ void DBCHandler::swapFiles(int pos1, int pos2)
     if (pos2 >= loadedFiles.count()) return;
 
     loadedFiles.swap(pos1, pos2);
+    emit filesChanged();
+}
+
+void DBCHandler::notifyFilesChanged()
+{
+    emit filesChanged();
 }
 
 /*
@@ -92,8 +92,14 @@ public:
     DBCFile* getFileByIdx(int idx);
     DBCFile* getFileByName(QString name);
     int createBlankFile();
+    //for the editors, tells everyone about changes they made to the loaded files
+    void notifyFilesChanged();
     static DBCHandler *getReference();
 
+signals:
+    //files were loaded, removed, reordered or edited. Pointers into them may be stale
+    void filesChanged();
+
 private:
     QList<DBCFile> loadedFiles;
 
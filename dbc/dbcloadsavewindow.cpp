@@ -1,7 +1,7 @@
 #include "dbcloadsavewindow.h"
 #include "ui_dbcloadsavewindow.h"
 
-DBCLoadSaveWindow::DBCLoadSaveWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+DBCLoadSaveWindow::DBCLoadSaveWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::DBCLoadSaveWindow)
 {
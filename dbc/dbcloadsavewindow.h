@@ -15,7 +15,7 @@ class DBCLoadSaveWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit DBCLoadSaveWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit DBCLoadSaveWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~DBCLoadSaveWindow();
 
 private slots:
@@ -32,7 +32,7 @@ private slots:
 private:
     Ui::DBCLoadSaveWindow *ui;
     DBCHandler *dbcHandler;
-    const QVector<CANFrame> *referenceFrames;
+    const CANFrameList *referenceFrames;
     DBCMainEditor *editorWindow;
 
     void swapTableRows(bool up);
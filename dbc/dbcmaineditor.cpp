@@ -6,7 +6,7 @@
 #include <QSettings>
 #include <QColorDialog>
 
-DBCMainEditor::DBCMainEditor( const QVector<CANFrame> *frames, QWidget *parent) :
+DBCMainEditor::DBCMainEditor( const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::DBCMainEditor)
 {
@@ -81,6 +81,7 @@ void DBCMainEditor::closeEvent(QCloseEvent *event)
 {
     Q_UNUSED(event);
     writeSettings();
+    dbcHandler->notifyFilesChanged();
 }
 
 void DBCMainEditor::readSettings()
@@ -16,7 +16,7 @@ class DBCMainEditor : public QDialog
     Q_OBJECT
 
 public:
-    explicit DBCMainEditor(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit DBCMainEditor(const CANFrameList *frames, QWidget *parent = 0);
     ~DBCMainEditor();
     void setFileIdx(int idx);
 
@@ -33,7 +33,7 @@ private slots:
 private:
     Ui::DBCMainEditor *ui;
     DBCHandler *dbcHandler;
-    const QVector<CANFrame> *referenceFrames;
+    const CANFrameList *referenceFrames;
     DBCSignalEditor *sigEditor;
     int currRow;
     DBCFile *dbcFile;
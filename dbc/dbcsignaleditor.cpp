@@ -216,6 +216,7 @@ void DBCSignalEditor::closeEvent(QCloseEvent *event)
 {
     Q_UNUSED(event);
     writeSettings();
+    dbcHandler->notifyFilesChanged();
 }
 
 void DBCSignalEditor::setFileIdx(int idx)
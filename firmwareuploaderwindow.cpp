@@ -4,7 +4,7 @@
 
 #include <QFile>
 
-FirmwareUploaderWindow::FirmwareUploaderWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FirmwareUploaderWindow::FirmwareUploaderWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FirmwareUploaderWindow)
 {
@@ -67,6 +67,11 @@ void FirmwareUploaderWindow::updatedFrames(int numFrames)
     }
 }
 
+void FirmwareUploaderWindow::gotTargettedFrames(const QVector<CANFrame> &frames)
+{
+    foreach (const CANFrame &frame, frames) gotTargettedFrame(frame);
+}
+
 void FirmwareUploaderWindow::gotTargettedFrame(CANFrame frame)
 {
     qDebug() << "FUW: Got targetted frame with id " << frame.ID;
@@ -16,7 +16,7 @@ class FirmwareUploaderWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FirmwareUploaderWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FirmwareUploaderWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FirmwareUploaderWindow();
 
 signals:
@@ -24,6 +24,7 @@ signals:
 
 public slots:
     void gotTargettedFrame(CANFrame frame);
+    void gotTargettedFrames(const QVector<CANFrame> &frames);
 
 private slots:
     void handleLoadFile();
@@ -46,7 +47,7 @@ private:
     int bus;
     uint32_t token;
     QByteArray firmwareData;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QTimer *timer;
 };
 
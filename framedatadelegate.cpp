@@ -0,0 +1,78 @@
+#include "framedatadelegate.h"
+
+#include <QPainter>
+#include <QStyle>
+#include <QApplication>
+#include <QFontMetrics>
+#include "canframemodel.h"
+#include "utility.h"
+
+FrameDataDelegate::FrameDataDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+    hexAdvance = 0;
+    decAdvance = 0;
+}
+
+void FrameDataDelegate::layoutBytes(const QFont &font) const
+{
+    QFontMetrics metrics(font);
+
+    hexBytes.resize(256);
+    decBytes.resize(256);
+    hexAdvance = 0;
+    decAdvance = 0;
+    //same text as Utility::formatBytes() in both modes
+    for (int i = 0; i < 256; i++)
+    {
+        QString hex = Utility::formatHexNum(i);
+        hexBytes[i].setText(hex);
+        hexBytes[i].prepare(QTransform(), font);
+        hexAdvance = qMax(hexAdvance, metrics.width(hex + " "));
+
+        QString dec = QString::number(i);
+        decBytes[i].setText(dec);
+        decBytes[i].prepare(QTransform(), font);
+        decAdvance = qMax(decAdvance, metrics.width(dec + " "));
+    }
+    layoutFont = font;
+}
+
+void FrameDataDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QVariant bytes = index.data(CANFrameModel::BytesRole);
+    if (!bytes.isValid())
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    //background, selection and focus as usual, without the text
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+    opt.text.clear();
+    const QWidget *widget = opt.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+
+    if (hexBytes.isEmpty() || opt.font != layoutFont) layoutBytes(opt.font);
+
+    QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &opt, widget);
+    QByteArray data = bytes.toByteArray();
+    const QVector<QStaticText> &texts = Utility::decimalMode ? decBytes : hexBytes;
+    int advance = Utility::decimalMode ? decAdvance : hexAdvance;
+    int x = textRect.left() + style->pixelMetric(QStyle::PM_FocusFrameHMargin, 0, widget) + 1; //same margin as the styled text
+    int y = textRect.top() + (textRect.height() - QFontMetrics(opt.font).height()) / 2;
+
+    painter->save();
+    painter->setFont(opt.font);
+    if (opt.state & QStyle::State_Selected) painter->setPen(opt.palette.color(QPalette::HighlightedText));
+    else painter->setPen(opt.palette.color(QPalette::Text));
+    painter->setClipRect(textRect);
+    for (int i = 0; i < data.count(); i++)
+    {
+        painter->drawStaticText(x, y, texts.at((unsigned char) data.at(i)));
+        x += advance;
+    }
+    painter->restore();
+}
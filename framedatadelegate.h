@@ -0,0 +1,34 @@
+#ifndef FRAMEDATADELEGATE_H
+#define FRAMEDATADELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QStaticText>
+#include <QFont>
+#include <QVector>
+
+/*
+ * Paints the data column of the main frame table straight from the payload bytes
+ * (CANFrameModel::BytesRole). Every byte value is laid out once as a QStaticText for hex
+ * and decimal, a paint only draws those so scrolling creates no strings.
+ * Rows showing decoded signals are left to QStyledItemDelegate.
+ */
+class FrameDataDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit FrameDataDelegate(QObject *parent = 0);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+private:
+    void layoutBytes(const QFont &font) const;
+
+    mutable QVector<QStaticText> hexBytes;
+    mutable QVector<QStaticText> decBytes;
+    mutable QFont layoutFont; //font the byte texts were laid out with
+    mutable int hexAdvance; //width of a byte followed by a space
+    mutable int decAdvance;
+};
+
+#endif // FRAMEDATADELEGATE_H
@@ -12,7 +12,7 @@ FrameFileIO::FrameFileIO()
 
 }
 
-bool FrameFileIO::saveFrameFile(QString &fileName, const QVector<CANFrame>* frameCache)
+bool FrameFileIO::saveFrameFile(QString &fileName, const CANFrameList *frameCache)
 {
     QString filename;
     QFileDialog dialog(qApp->activeWindow());
@@ -255,7 +255,7 @@ bool FrameFileIO::loadVehicleSpyFile(QString filename, QVector<CANFrame> *frames
     return !foundErrors;
 }
 
-bool FrameFileIO::saveVehicleSpyFile(QString filename, const QVector<CANFrame> *frames)
+bool FrameFileIO::saveVehicleSpyFile(QString filename, const CANFrameList *frames)
 {
     Q_UNUSED(filename);
     Q_UNUSED(frames);
@@ -357,7 +357,7 @@ bool FrameFileIO::loadCRTDFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveCRTDFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveCRTDFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     int lineCounter = 0;
@@ -553,7 +553,7 @@ bool FrameFileIO::loadNativeCSVFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveNativeCSVFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveNativeCSVFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     int lineCounter = 0;
@@ -662,7 +662,7 @@ bool FrameFileIO::loadGenericCSVFile(QString filename, QVector<CANFrame>* frames
 }
 
 //4f5,ff 34 23 45 24 e4
-bool FrameFileIO::saveGenericCSVFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveGenericCSVFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     int lineCounter = 0;
@@ -789,7 +789,7 @@ bool FrameFileIO::loadLogFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveLogFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveLogFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     QDateTime timestamp, tempStamp;
@@ -926,7 +926,7 @@ bool FrameFileIO::loadIXXATFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveIXXATFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveIXXATFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     QDateTime timestamp, tempStamp;
@@ -1039,7 +1039,7 @@ bool FrameFileIO::loadCANDOFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveCANDOFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveCANDOFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     int lineCounter = 0;
@@ -1177,7 +1177,7 @@ tokens:
 3 = data length
 4-x = data bytes in hex with 0x prefix
 */
-bool FrameFileIO::saveMicrochipFile(QString filename, const QVector<CANFrame>* frames)
+bool FrameFileIO::saveMicrochipFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     QDateTime timestamp, tempStamp;
@@ -1324,7 +1324,7 @@ bool FrameFileIO::loadTraceFile(QString filename, QVector<CANFrame>* frames)
     return !foundErrors;
 }
 
-bool FrameFileIO::saveTraceFile(QString filename, const QVector<CANFrame> * frames)
+bool FrameFileIO::saveTraceFile(QString filename, const CANFrameList *frames)
 {
     QFile *outFile = new QFile(filename);
     QDateTime timestamp;
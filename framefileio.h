@@ -27,7 +27,7 @@ public:
     //The QVector is used as either the target for loading or the source for saving.
     //These routines call the below loading/saving functions so no need to use them directly if you don't want.
     static bool loadFrameFile(QString &, QVector<CANFrame>*);
-    static bool saveFrameFile(QString &, const QVector<CANFrame>*);
+    static bool saveFrameFile(QString &, const CANFrameList *);
 
     //These do the actual loading and saving and can be used directly if you'd prefer
     static bool loadCRTDFile(QString, QVector<CANFrame>*);
@@ -42,15 +42,15 @@ public:
     static bool loadCanDumpFile(QString, QVector<CANFrame>*);
     static bool loadPCANFile(QString, QVector<CANFrame>*);
     static bool loadKvaserFile(QString, QVector<CANFrame>*, bool);
-    static bool saveCRTDFile(QString, const QVector<CANFrame>*);    
-    static bool saveNativeCSVFile(QString, const QVector<CANFrame>*);
-    static bool saveGenericCSVFile(QString, const QVector<CANFrame>*);
-    static bool saveLogFile(QString, const QVector<CANFrame>*);
-    static bool saveMicrochipFile(QString, const QVector<CANFrame>*);
-    static bool saveTraceFile(QString, const QVector<CANFrame>*);
-    static bool saveIXXATFile(QString, const QVector<CANFrame>*);
-    static bool saveCANDOFile(QString, const QVector<CANFrame>*);
-    static bool saveVehicleSpyFile(QString, const QVector<CANFrame>*);
+    static bool saveCRTDFile(QString, const CANFrameList *);    
+    static bool saveNativeCSVFile(QString, const CANFrameList *);
+    static bool saveGenericCSVFile(QString, const CANFrameList *);
+    static bool saveLogFile(QString, const CANFrameList *);
+    static bool saveMicrochipFile(QString, const CANFrameList *);
+    static bool saveTraceFile(QString, const CANFrameList *);
+    static bool saveIXXATFile(QString, const CANFrameList *);
+    static bool saveCANDOFile(QString, const CANFrameList *);
+    static bool saveVehicleSpyFile(QString, const CANFrameList *);
 };
 
 #endif // FRAMEFILEIO_H
@@ -5,6 +5,7 @@
 #include <QMenu>
 #include <QSettings>
 #include "connections/canconmanager.h"
+#include "mainwindow.h"
 
 /*
  * Notes about new functionality:
@@ -19,7 +20,7 @@
  *
 */
 
-FramePlaybackWindow::FramePlaybackWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FramePlaybackWindow::FramePlaybackWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FramePlaybackWindow)
 {
@@ -61,6 +62,7 @@ FramePlaybackWindow::FramePlaybackWindow(const QVector<CANFrame> *frames, QWidge
     connect(ui->comboCANBus, SIGNAL(currentIndexChanged(int)), this, SLOT(changeSendingBus(int)));
     connect(ui->listID, SIGNAL(itemClicked(QListWidgetItem*)), this, SLOT(changeIDFiltering(QListWidgetItem*)));
     connect(playbackTimer, SIGNAL(timeout()), this, SLOT(timerTriggered()));
+    connect(CANConManager::getInstance(), &CANConManager::txReady, this, &FramePlaybackWindow::sendPending);
     connect(ui->btnLoadFile, SIGNAL(clicked(bool)), this, SLOT(btnLoadFile()));
     connect(ui->btnLoadLive, SIGNAL(clicked(bool)), this, SLOT(btnLoadLive()));
     connect(ui->tblSequence, SIGNAL(cellPressed(int,int)), this, SLOT(seqTableCellClicked(int,int)));
@@ -375,8 +377,10 @@ void FramePlaybackWindow::btnLoadLive()
     item.filename = "<CAPTURED DATA>";
     item.currentLoopCount = 0;
     item.maxLoops = 1;
-    item.data = QVector<CANFrame>(*modelFrames); //create a copy of the current frames from the main view
-    fillIDHash(item);
+    item.data = modelFrames->toVector(); //create a copy of the current frames from the main view
+    //the IDs are already known by the model, no need to go through the copy
+    foreach (quint32 id, MainWindow::getReference()->getCANFrameModel()->getIds(modelFrames))
+        item.idFilters.insert(id, true);
     if (ui->tblSequence->currentRow() == -1)
     {
         ui->tblSequence->setCurrentCell(0,0);
@@ -403,7 +407,7 @@ void FramePlaybackWindow::btnBackOneClick()
     playbackActive = false;
 
     updatePosition(false);
-    CANConManager::getInstance()->sendFrames(sendingBuffer);
+    queueSendingBuffer();
 }
 
 void FramePlaybackWindow::btnPauseClick()
@@ -423,6 +427,7 @@ void FramePlaybackWindow::btnStopClick()
 {
     playbackTimer->stop(); //pushing this button halts automatic playback
     playbackActive = false;
+    pendingFrames.clear();
     currentPosition = 0;
     if (seqItems.count() > 0)
     {
@@ -454,7 +459,7 @@ void FramePlaybackWindow::btnFwdOneClick()
     playbackTimer->stop();
     playbackActive = false;
     updatePosition(true);
-    CANConManager::getInstance()->sendFrames(sendingBuffer);
+    queueSendingBuffer();
 }
 
 void FramePlaybackWindow::changePlaybackSpeed(int newSpeed)
@@ -501,6 +506,10 @@ void FramePlaybackWindow::btnSelectNoneClick()
 
 void FramePlaybackWindow::timerTriggered()
 {
+    //the devices are behind, don't move on until what was already played got out
+    sendPending();
+    if (!pendingFrames.isEmpty()) return;
+
     sendingBuffer.clear();
     for (int count = 0; count < ui->spinBurstSpeed->value(); count++)
     {
@@ -518,7 +527,22 @@ void FramePlaybackWindow::timerTriggered()
             updatePosition(false);
         }
     }
-    CANConManager::getInstance()->sendFrames(sendingBuffer);
+    queueSendingBuffer();
+}
+
+//frames are never dropped when a transmit queue is full, they wait in pendingFrames
+void FramePlaybackWindow::queueSendingBuffer()
+{
+    pendingFrames.append(sendingBuffer);
+    sendingBuffer.clear();
+    sendPending();
+}
+
+void FramePlaybackWindow::sendPending()
+{
+    if (pendingFrames.isEmpty()) return;
+    int sent = CANConManager::getInstance()->queueFrames(pendingFrames);
+    pendingFrames.erase(pendingFrames.begin(), pendingFrames.begin() + sent);
 }
 
 void FramePlaybackWindow::updatePosition(bool forward)
@@ -26,7 +26,7 @@ class FramePlaybackWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FramePlaybackWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FramePlaybackWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FramePlaybackWindow();
 
 private slots:
@@ -51,13 +51,15 @@ private slots:
     void contextMenuFilters(QPoint);
     void saveFilters();
     void loadFilters();
+    void sendPending();
 
 private:
     Ui::FramePlaybackWindow *ui;
     QList<int> foundID;
     QList<CANFrame> frameCache;
     QList<CANFrame> sendingBuffer;
-    const QVector<CANFrame> *modelFrames;
+    QList<CANFrame> pendingFrames; //frames the transmit queues had no room for yet, sent first
+    const CANFrameList *modelFrames;
     int currentPosition;
     QTimer *playbackTimer;
     bool playbackActive;
@@ -70,6 +72,7 @@ private:
     void refreshIDList();
     void updateFrameLabel();
     void updatePosition(bool forward);
+    void queueSendingBuffer();
     void fillIDHash(SequenceItem &item);    
     void showEvent(QShowEvent *);
     void closeEvent(QCloseEvent *event);
@@ -14,7 +14,7 @@
  * Also, rows default to enabled which is odd because the button state does not reflect that.
 */
 
-FrameSenderWindow::FrameSenderWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FrameSenderWindow::FrameSenderWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FrameSenderWindow)
 {
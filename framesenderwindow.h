@@ -17,7 +17,7 @@ class FrameSenderWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FrameSenderWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FrameSenderWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FrameSenderWindow();
 
 private slots:
@@ -34,7 +34,7 @@ private:
     Ui::FrameSenderWindow *ui;
     QList<FrameSendData> sendingData;
     QHash<int, CANFrame> frameCache; //hash with frame ID as the key and the most recent frame as the value
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QTimer *intervalTimer;
     QElapsedTimer elapsedTimer;
     bool inhibitChanged = false;
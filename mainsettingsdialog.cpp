@@ -13,6 +13,11 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     ui->comboSendingBus->addItem(tr("Both"));
     ui->comboSendingBus->addItem(tr("From File"));
 
+    //order matches CANConnection::OverflowPolicy
+    ui->comboQueuePolicy->addItem(tr("Drop newest frame"));
+    ui->comboQueuePolicy->addItem(tr("Drop oldest frame"));
+    ui->comboQueuePolicy->addItem(tr("Grow queue"));
+
     settings = new QSettings();
 
     //update the GUI with all the settings we have stored giving things
@@ -55,6 +60,11 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     ui->comboSendingBus->setCurrentIndex(settings->value("Playback/SendingBus", 4).toInt());
     ui->cbUseFiltered->setChecked(settings->value("Main/UseFiltered", false).toBool());
     ui->cbUseOpenGL->setChecked(settings->value("Main/UseOpenGL", false).toBool());
+    ui->comboQueuePolicy->setCurrentIndex(settings->value("Main/QueueOverflowPolicy", 0).toInt());
+    ui->spinQueueMaxMemory->setValue(settings->value("Main/QueueMaxMemory", 64).toInt());
+    ui->spinCaptureMaxFrames->setValue(settings->value("Main/CaptureMaxFrames", 0).toInt());
+    ui->spinCaptureMaxSeconds->setValue(settings->value("Main/CaptureMaxSeconds", 0).toInt());
+    ui->cbSpillToDisk->setChecked(settings->value("Main/CaptureSpillToDisk", false).toBool());
 
     //just for simplicity they all call the same function and that function updates all settings at once
     connect(ui->cbDisplayHex, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
@@ -73,6 +83,11 @@ MainSettingsDialog::MainSettingsDialog(QWidget *parent) :
     connect(ui->cbUseFiltered, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
     connect(ui->lineClockFormat, SIGNAL(editingFinished()), this, SLOT(updateSettings()));
     connect(ui->cbUseOpenGL, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
+    connect(ui->comboQueuePolicy, SIGNAL(currentIndexChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->spinQueueMaxMemory, SIGNAL(valueChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->spinCaptureMaxFrames, SIGNAL(valueChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->spinCaptureMaxSeconds, SIGNAL(valueChanged(int)), this, SLOT(updateSettings()));
+    connect(ui->cbSpillToDisk, SIGNAL(toggled(bool)), this, SLOT(updateSettings()));
 }
 
 MainSettingsDialog::~MainSettingsDialog()
@@ -104,6 +119,11 @@ void MainSettingsDialog::updateSettings()
     settings->setValue("Main/UseFiltered", ui->cbUseFiltered->isChecked());
     settings->setValue("Main/UseOpenGL", ui->cbUseOpenGL->isChecked());
     settings->setValue("Main/TimeFormat", ui->lineClockFormat->text());
+    settings->setValue("Main/QueueOverflowPolicy", ui->comboQueuePolicy->currentIndex());
+    settings->setValue("Main/QueueMaxMemory", ui->spinQueueMaxMemory->value());
+    settings->setValue("Main/CaptureMaxFrames", ui->spinCaptureMaxFrames->value());
+    settings->setValue("Main/CaptureMaxSeconds", ui->spinCaptureMaxSeconds->value());
+    settings->setValue("Main/CaptureSpillToDisk", ui->cbSpillToDisk->isChecked());
 
     settings->sync();
     emit updatedSettings();
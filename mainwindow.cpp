@@ -3,10 +3,12 @@
 #include "can_structs.h"
 #include <QDateTime>
 #include <QFileDialog>
+#include <QDir>
 #include <QtSerialPort/QSerialPortInfo>
 #include "connections/canconmanager.h"
 #include "connections/connectionwindow.h"
 #include "utility.h"
+#include "framedatadelegate.h"
 
 /*
 Compile for all platforms and create release and make Win32 binary.
@@ -50,6 +52,7 @@ MainWindow::MainWindow(QWidget *parent) :
     model = new CANFrameModel(this); // set parent to mainwindow to prevent canframemodel to change thread (might be done by setModel but just in case)
 
     ui->canFramesView->setModel(model);
+    ui->canFramesView->setItemDelegateForColumn(6, new FrameDataDelegate(ui->canFramesView));
 
     readSettings();
 
@@ -120,6 +123,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->listFilters, &QListWidget::itemChanged, this, &MainWindow::filterListItemChanged);
     connect(ui->btnFilterAll, &QAbstractButton::clicked, this, &MainWindow::filterSetAll);
     connect(ui->btnFilterNone, &QAbstractButton::clicked, this, &MainWindow::filterClearAll);
+    connect(ui->lineQuery, &QLineEdit::returnPressed, this, &MainWindow::queryEntered);
+    connect(model, &CANFrameModel::queryFailed, this, &MainWindow::queryFailed);
     connect(ui->actionFirmware_Update, &QAction::triggered, this, &MainWindow::showFirmwareUploaderWindow);
     connect(ui->actionDBC_File_Manager, &QAction::triggered, this, &MainWindow::showDBCFileWindow);
     connect(ui->actionFuzzing, &QAction::triggered, this, &MainWindow::showFuzzingWindow);
@@ -138,6 +143,7 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->statusBar->addWidget(&lbStatusConnected);
     ui->statusBar->addWidget(&lbStatusFilename);
     ui->statusBar->addWidget(&lbStatusDatabase);
+    ui->statusBar->addWidget(&lbStatusEvicted);
 
     ui->lbFPS->setText("0");
     ui->lbNumFrames->setText("0");
@@ -273,6 +279,10 @@ void MainWindow::readUpdateableSettings()
     model->setSysTimeMode(useSystemClock);
     useFiltered = settings.value("Main/UseFiltered", false).toBool();
     model->setTimeFormat(settings.value("Main/TimeFormat", "MMM-dd HH:mm:ss.zzz").toString());
+    model->setCaptureLimit(settings.value("Main/CaptureMaxFrames", 0).toInt(),
+                           settings.value("Main/CaptureMaxSeconds", 0).toInt());
+    model->setSpillToDisk(settings.value("Main/CaptureSpillToDisk", false).toBool(),
+                          settings.value("Main/CaptureSpillDir", QDir::tempPath()).toString());
 
 }
 
@@ -318,7 +328,9 @@ void MainWindow::gridClicked(QModelIndex idx)
 void MainWindow::gridDoubleClicked(QModelIndex idx)
 {
     //grab ID and timestamp and send them away
-    CANFrame frame = model->getListReference()->at(idx.row());
+    int row = model->getFilteredIndex(idx.row());
+    if (row < 0 || row >= model->getFilteredListReference()->count()) return;
+    CANFrame frame = model->getFilteredListReference()->at(row);
     emit sendCenterTimeID(frame.ID, frame.timestamp / 1000000.0);
 }
 
@@ -390,6 +402,28 @@ void MainWindow::filterClearAll()
     model->setAllFilters(false);
 }
 
+void MainWindow::queryEntered()
+{
+    QString error;
+    if (model->setQuery(ui->lineQuery->text(), &error))
+    {
+        ui->lineQuery->setStyleSheet(QString());
+        ui->lineQuery->setToolTip(tr("Shows only the frames matching a query, e.g. id in 0x100-0x1FF && b3.2 toggled"));
+    }
+    else
+    {
+        //the view keeps the previous query until this one is fixed
+        ui->lineQuery->setStyleSheet("color: red");
+        ui->lineQuery->setToolTip(error);
+    }
+}
+
+void MainWindow::queryFailed(const QString &error)
+{
+    ui->lineQuery->setStyleSheet("color: red");
+    ui->lineQuery->setToolTip(error);
+}
+
 void MainWindow::tickGUIUpdate()
 {
     rxFrames = model->sendBulkRefresh();
@@ -406,9 +440,14 @@ void MainWindow::tickGUIUpdate()
         ui->lbNumFrames->setText(QString::number(model->rowCount()));
         if (ui->cbAutoScroll->isChecked()) ui->canFramesView->scrollToBottom();
         ui->lbFPS->setText(QString::number(framesPerSec));
+        if (model->getEvictedCount() > 0)
+            lbStatusEvicted.setText(tr("%1 oldest frames dropped").arg(model->getEvictedCount()));
+        else lbStatusEvicted.clear();
         if (rxFrames > 0)
         {
             bDirty = true;
+            //with a bounded capture part of the new frames may already be gone
+            if (rxFrames > model->totalFrameCount()) rxFrames = model->totalFrameCount();
             emit framesUpdated(rxFrames); //anyone care that frames were updated?
         }
 
@@ -438,10 +477,10 @@ void MainWindow::addFrameToDisplay(CANFrame &frame, bool autoRefresh = false)
 //try to find the relevant frame in the list and focus on it.
 void MainWindow::gotCenterTimeID(int32_t ID, double timestamp)
 {
-    int idx = model->getIndexFromTimeID(ID, timestamp);
-    if (idx > -1)
+    int row = model->getRowFromTimeID(ID, timestamp);
+    if (row > -1)
     {
-        ui->canFramesView->selectRow(idx);
+        ui->canFramesView->selectRow(row);
     }
 }
 
@@ -449,6 +488,7 @@ void MainWindow::clearFrames()
 {
     ui->canFramesView->scrollToTop();
     model->clearFrames();
+    updateNormalizeButton();
     CANConManager::getInstance()->resetTimeBasis();
     ui->lbNumFrames->setText(QString::number(model->rowCount()));
     bDirty = false;
@@ -457,12 +497,21 @@ void MainWindow::clearFrames()
     emit framesUpdated(-1);
 }
 
+//the button toggles between relative timestamps and the timestamps as captured
 void MainWindow::normalizeTiming()
 {
-    model->normalizeTiming();
+    if (model->isTimingNormalized()) model->restoreTiming();
+    else model->normalizeTiming();
+    updateNormalizeButton();
     emit framesUpdated(-2); //claim an all new set of frames because every frame was updated.
 }
 
+void MainWindow::updateNormalizeButton()
+{
+    if (model->isTimingNormalized()) ui->btnNormalize->setText(tr("Restore Frame Timing"));
+    else ui->btnNormalize->setText(tr("Normalize Frame Timing"));
+}
+
 void MainWindow::handleLoadFile()
 {
     QString filename;
@@ -472,6 +521,7 @@ void MainWindow::handleLoadFile()
     {
         ui->canFramesView->scrollToTop();
         model->clearFrames();
+        updateNormalizeButton();
         model->insertFrames(tempFrames);
         loadedFileName = filename;
         model->recalcOverwrite();
@@ -572,7 +622,7 @@ void MainWindow::handleSaveDecoded()
 void MainWindow::saveDecodedTextFile(QString filename)
 {
     QFile *outFile = new QFile(filename);
-    const QVector<CANFrame> *frames = model->getFilteredListReference();
+    const CANFrameList *frames = model->getFilteredListReference();
 
     if (!outFile->open(QIODevice::WriteOnly | QIODevice::Text))
         return;
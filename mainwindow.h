@@ -94,6 +94,8 @@ private slots:
     void filterListItemChanged(QListWidgetItem *item);
     void filterSetAll();
     void filterClearAll();
+    void queryEntered();
+    void queryFailed(const QString &error);
 
 public slots:
     void gotFrames(int);
@@ -159,6 +161,7 @@ private:
     QLabel lbStatusConnected;
     QLabel lbStatusFilename;
     QLabel lbStatusDatabase;
+    QLabel lbStatusEvicted;
     int normalRowHeight;
     bool isConnected;
 
@@ -166,6 +169,7 @@ private:
     void saveDecodedTextFile(QString);
     void addFrameToDisplay(CANFrame &, bool);
     void updateFileStatus();
+    void updateNormalizeButton();
     void closeEvent(QCloseEvent *event);
     void killEmAll();
     void killWindow(QDialog *win);
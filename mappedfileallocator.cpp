@@ -0,0 +1,123 @@
+#include "mappedfileallocator.h"
+
+#include <QDebug>
+#include <stdlib.h>
+#include <new>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+/* mappings start on a multiple of this, a multiple of every page size in use */
+#define MAPPING_ALIGN   65536
+
+
+MappedFileAllocator::MappedFileAllocator(const QString& pDir) :
+    mFile(pDir + "/SavvyCAN-capture-XXXXXX.spill"),
+    mEnd(0)
+{
+    if (!mFile.open())
+        qDebug() << "Cannot create capture file in" << pDir << ":" << mFile.errorString();
+}
+
+MappedFileAllocator::~MappedFileAllocator()
+{
+    if (!mMappings.isEmpty())
+        qDebug() << mMappings.count() << "capture blocks still mapped";
+    /* QTemporaryFile unmaps and removes the file */
+}
+
+bool MappedFileAllocator::isValid() const
+{
+    return mFile.isOpen();
+}
+
+qint64 MappedFileAllocator::fileSize() const
+{
+    QMutexLocker locker(&mMutex);
+    return mEnd;
+}
+
+void* MappedFileAllocator::allocate(qint64 pBytes)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (isValid())
+    {
+        qint64 size = (pBytes + MAPPING_ALIGN - 1) & ~((qint64) MAPPING_ALIGN - 1);
+        qint64 offset;
+        QVector<qint64>& freeOffsets = mFreeOffsets[size];
+
+        if (!freeOffsets.isEmpty())
+            offset = freeOffsets.takeLast();
+        else
+        {
+            offset = mEnd;
+            if (!reserveSpace(offset, size))
+            {
+                qDebug() << "Cannot extend capture file:" << mFile.errorString();
+                mFile.resize(offset);
+                return heapAllocate(pBytes);
+            }
+            mEnd += size;
+        }
+
+        uchar* block_p = mFile.map(offset, size);
+        if (block_p)
+        {
+            Mapping mapping;
+            mapping.offset = offset;
+            mapping.size = size;
+            mMappings.insert(block_p, mapping);
+            return block_p;
+        }
+
+        qDebug() << "Cannot map capture file:" << mFile.errorString();
+        freeOffsets.append(offset);
+    }
+
+    return heapAllocate(pBytes);
+}
+
+/*
+ * Extending the file with resize() only makes it sparse: with the disk full the first write
+ * to the mapped page raises SIGBUS. The blocks are given their disk space before being mapped.
+ */
+bool MappedFileAllocator::reserveSpace(qint64 pOffset, qint64 pSize)
+{
+#ifdef Q_OS_LINUX
+    return posix_fallocate(mFile.handle(), pOffset, pSize) == 0;
+#else
+    static const QByteArray zeros(MAPPING_ALIGN, 0);
+    if (!mFile.seek(pOffset)) return false;
+    for (qint64 done = 0; done < pSize; done += zeros.size())
+    {
+        if (mFile.write(zeros) != zeros.size()) return false;
+    }
+    return mFile.flush();
+#endif
+}
+
+//fallback when the file can't take the block, fails the way new would
+void* MappedFileAllocator::heapAllocate(qint64 pBytes)
+{
+    void* block_p = malloc(pBytes);
+    if (!block_p) throw std::bad_alloc();
+    return block_p;
+}
+
+void MappedFileAllocator::release(void* pBlock_p)
+{
+    QMutexLocker locker(&mMutex);
+    QHash<void*, Mapping>::iterator it = mMappings.find(pBlock_p);
+
+    if (it == mMappings.end())
+    {
+        /* heap fallback */
+        free(pBlock_p);
+        return;
+    }
+
+    mFreeOffsets[it->size].append(it->offset);
+    mFile.unmap(static_cast<uchar*>(pBlock_p));
+    mMappings.erase(it);
+}
@@ -0,0 +1,60 @@
+#ifndef MAPPEDFILEALLOCATOR_H
+#define MAPPEDFILEALLOCATOR_H
+
+#include <QTemporaryFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include "canframestore.h"
+
+/*
+ * Hands out blocks mapped from a temporary file so that a capture can grow beyond RAM.
+ * The OS keeps the recently used blocks in memory and writes the others back to the file,
+ * readers page them in when they are accessed.
+ * Released blocks are unmapped and their place in the file is reused.
+ * If the file cannot be extended or mapped (disk full...), blocks come from the heap instead.
+ * The file is deleted when the allocator is destroyed, all its blocks must be released by then,
+ * which the stores take care of by holding it with a QSharedPointer.
+ * Thread safe, snapshots of a store release their blocks from the thread that drops them.
+ */
+class MappedFileAllocator : public BlockAllocator
+{
+public:
+    /**
+     * @brief MappedFileAllocator
+     * @param pDir: directory of the temporary file
+     */
+    explicit MappedFileAllocator(const QString& pDir);
+    virtual ~MappedFileAllocator();
+
+    /**
+     * @brief isValid
+     * @return true if the temporary file could be created
+     */
+    bool isValid() const;
+
+    virtual void* allocate(qint64 pBytes);
+    virtual void release(void* pBlock_p);
+
+    /* size of the temporary file */
+    qint64 fileSize() const;
+
+private:
+    struct Mapping
+    {
+        qint64 offset;
+        qint64 size;
+    };
+
+    bool reserveSpace(qint64 pOffset, qint64 pSize);
+    static void* heapAllocate(qint64 pBytes);
+
+    mutable QMutex                  mMutex;
+    QTemporaryFile                  mFile;
+    qint64                          mEnd;
+    QHash<void*, Mapping>           mMappings;
+    QMap<qint64, QVector<qint64> >  mFreeOffsets;   //by size
+};
+
+#endif // MAPPEDFILEALLOCATOR_H
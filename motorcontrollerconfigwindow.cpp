@@ -4,7 +4,7 @@
 #include "mainwindow.h"
 #include <QDebug>
 
-MotorControllerConfigWindow::MotorControllerConfigWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+MotorControllerConfigWindow::MotorControllerConfigWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::MotorControllerConfigWindow)
 {
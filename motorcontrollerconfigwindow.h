@@ -41,7 +41,7 @@ class MotorControllerConfigWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit MotorControllerConfigWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit MotorControllerConfigWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~MotorControllerConfigWindow();
 
 signals:
@@ -57,7 +57,7 @@ private slots:
 
 private:
     Ui::MotorControllerConfigWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QTimer timer;
     CANFrame outFrame;
     bool doingRequest;
@@ -2,13 +2,14 @@
 #include "ui_discretestatewindow.h"
 #include "mainwindow.h"
 
-DiscreteStateWindow::DiscreteStateWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+DiscreteStateWindow::DiscreteStateWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::DiscreteStateWindow)
 {
     ui->setupUi(this);
 
     modelFrames = frames;
+    knownIds = 0;
     operatingState = DWStates::IDLE;
 
     timer = new QTimer();
@@ -106,6 +107,7 @@ void DiscreteStateWindow::updatedFrames(int numFrames)
     {
         ui->listID->clear();
         idFilters.clear();
+        knownIds = 0;
     }
     else if (numFrames == -2) //all new set of frames. Reset
     {
@@ -113,15 +115,16 @@ void DiscreteStateWindow::updatedFrames(int numFrames)
     }
     else //just got some new frames. See if they are relevant.
     {
-        if (numFrames > modelFrames->count()) return;
-        for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
+        //new IDs come from the catalog of the model
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        QVector<quint32> newIds = model->getIds(modelFrames, knownIds);
+        knownIds = model->getIdCatalog()->count();
+        foreach (quint32 id, newIds)
         {
-            thisFrame = modelFrames->at(i);
-
-            if (!idFilters.contains(thisFrame.ID))
+            if (!idFilters.contains(id))
             {
-                idFilters.insert(thisFrame.ID, true);
-                QListWidgetItem* listItem = new QListWidgetItem(Utility::formatNumber(thisFrame.ID), ui->listID);
+                idFilters.insert(id, true);
+                QListWidgetItem* listItem = new QListWidgetItem(Utility::formatNumber(id), ui->listID);
                 listItem->setFlags(listItem->flags() | Qt::ItemIsUserCheckable); // set checkable flag
                 listItem->setCheckState(Qt::Checked); //default all filters to be set active
             }
@@ -134,14 +137,14 @@ void DiscreteStateWindow::updatedFrames(int numFrames)
 
 void DiscreteStateWindow::refreshFilterList()
 {
-    int id;
-
     idFilters.clear();
     ui->listID->clear();
 
-    for (int i = 0; i < modelFrames->length(); i++)
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
+    foreach (quint32 id, ids)
     {
-        id = modelFrames->at(i).ID;
         if (!idFilters.contains(id))
         {
             idFilters.insert(id, true);
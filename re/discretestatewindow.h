@@ -26,7 +26,7 @@ class DiscreteStateWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit DiscreteStateWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit DiscreteStateWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~DiscreteStateWindow();
     void showEvent(QShowEvent*);
 
@@ -38,7 +38,8 @@ private slots:
 
 private:
     Ui::DiscreteStateWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
     QList< QVector<CANFrame> *> stateFrames;
     QTimer *timer;
     DiscreteWindowState operatingState;
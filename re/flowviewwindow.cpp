@@ -2,11 +2,13 @@
 #include "ui_flowviewwindow.h"
 #include "mainwindow.h"
 
+#include <algorithm>
+
 const QColor FlowViewWindow::graphColors[8] = {Qt::blue, Qt::green, Qt::black, Qt::red, //0 1 2 3
                                                Qt::gray, Qt::yellow, Qt::cyan, Qt::darkMagenta}; //4 5 6 7
 
 
-FlowViewWindow::FlowViewWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FlowViewWindow::FlowViewWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FlowViewWindow)
 {
@@ -15,6 +17,7 @@ FlowViewWindow::FlowViewWindow(const QVector<CANFrame> *frames, QWidget *parent)
     readSettings();
 
     modelFrames = frames;
+    knownIds = 0;
 
     playbackTimer = new QTimer();
 
@@ -231,15 +234,10 @@ void FlowViewWindow::gotCenterTimeID(int32_t ID, double timestamp)
         }
     }
 
-    int bestIdx = -1;
-    for (int i = 0; i < frameCache.count(); i++)
-    {
-        if (frameCache[i].timestamp > t_stamp)
-        {
-            bestIdx = i - 1;
-            break;
-        }
-    }
+    //frameCache is in time order, take the last frame at or before t_stamp
+    QList<CANFrame>::const_iterator next = std::upper_bound(frameCache.constBegin(), frameCache.constEnd(), t_stamp,
+                                                            [](uint64_t t, const CANFrame& f) { return t < f.timestamp; });
+    int bestIdx = (next - frameCache.constBegin()) - 1;
     qDebug() << "Best index " << bestIdx;
     if (bestIdx > -1)
     {
@@ -378,15 +376,23 @@ void FlowViewWindow::updatedFrames(int numFrames)
         if (frameCache.count() > 0) refID = frameCache[0].ID;
             else refID = 0;
         bool needRefresh = false;
-        for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
-        {
-            thisFrame = modelFrames->at(i);
 
-            if (!foundID.contains(thisFrame.ID))
+        //new IDs come from the catalog of the model
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        QVector<quint32> newIds = model->getIds(modelFrames, knownIds);
+        knownIds = model->getIdCatalog()->count();
+        foreach (quint32 id, newIds)
+        {
+            if (!foundID.contains(id))
             {
-                foundID.append(thisFrame.ID);
-                /*QListWidgetItem* item =*/ new QListWidgetItem(Utility::formatNumber(thisFrame.ID), ui->listFrameID);
+                foundID.append(id);
+                /*QListWidgetItem* item =*/ new QListWidgetItem(Utility::formatNumber(id), ui->listFrameID);
             }
+        }
+
+        for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
+        {
+            thisFrame = modelFrames->at(i);
 
             if (thisFrame.ID == refID)
             {
@@ -491,10 +497,11 @@ void FlowViewWindow::createGraph(int byteNum)
 
 void FlowViewWindow::refreshIDList()
 {
-    int id;
-    for (int i = 0; i < modelFrames->count(); i++)
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
+    foreach (quint32 id, ids)
     {
-        id = modelFrames->at(i).ID;
         if (!foundID.contains(id))
         {
             foundID.append(id);
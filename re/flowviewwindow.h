@@ -14,7 +14,7 @@ class FlowViewWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FlowViewWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FlowViewWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FlowViewWindow();
     void showEvent(QShowEvent*);
 
@@ -45,7 +45,8 @@ private:
     Ui::FlowViewWindow *ui;
     QList<int> foundID;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
     unsigned char refBytes[8];
     unsigned char currBytes[8];
     int triggerValues[8];
@@ -3,7 +3,7 @@
 #include "mainwindow.h"
 #include <QtDebug>
 
-FrameInfoWindow::FrameInfoWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FrameInfoWindow::FrameInfoWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FrameInfoWindow)
 {
@@ -12,6 +12,7 @@ FrameInfoWindow::FrameInfoWindow(const QVector<CANFrame> *frames, QWidget *paren
     readSettings();
 
     modelFrames = frames;
+    knownIds = 0;
 
     connect(ui->listFrameID, &QListWidget::currentTextChanged, this, &FrameInfoWindow::updateDetailsWindow);
     connect(MainWindow::getReference(), &MainWindow::framesUpdated, this, &FrameInfoWindow::updatedFrames);
@@ -81,31 +82,14 @@ void FrameInfoWindow::updatedFrames(int numFrames)
             ui->listFrameID->setCurrentRow(0);
         }
     }
-    else //just got some new frames. See if they are relevant.
+    else //just got some new frames. List the IDs the catalog got since last time
     {
-        if (numFrames > modelFrames->count()) return;
-        unsigned int currID = 0;
-        if (ui->listFrameID->currentItem())
-            currID = ui->listFrameID->currentItem()->text().toInt(NULL, 16);
-        bool foundID = false;
-        for (int x = modelFrames->count() - numFrames; x < modelFrames->count(); x++)
-        {
-            if (currID == modelFrames->at(x).ID)
-            {
-                foundID = true;
-                break;
-            }
-        }
-        if (foundID)
-        {
-            //the problem here is that it'll blast us out of the details as soon as this
-            //happens. The only way to do this properly is to actually traverse
-            //the details structure and change the text. We don't do that yet.
-            //so, the line is commented out. If people need to see the updated
-            //data they can click another ID and back and it'll be OK
-
-            //updateDetailsWindow(ui->listFrameID->currentItem()->text());
-        }
+        //the details of the current ID are not redone, it would blast us out of the tree.
+        //If people need to see the updated data they can click another ID and back
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        QVector<quint32> ids = model->getIds(modelFrames, knownIds);
+        knownIds = model->getIdCatalog()->count();
+        if (addIDs(ids)) ui->listFrameID->sortItems();
     }
 }
 
@@ -195,6 +179,42 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
         tempItem->setText(0, tr("# of frames: ") + QString::number(frameCache.count(),10));
         baseNode->addChild(tempItem);
 
+        //buses, lengths and first/last seen come from the catalog of the whole capture
+        CANIdInfo idInfo;
+        if (MainWindow::getReference()->getCANFrameModel()->getIdInfo(targettedID, &idInfo))
+        {
+            const CANIdInfo *info = &idInfo;
+            QString builder;
+            for (int b = 0; b < info->busCounts.count(); b++)
+            {
+                if (info->busCounts[b] == 0) continue;
+                if (!builder.isEmpty()) builder += ", ";
+                builder += QString::number(b) + " (" + QString::number(info->busCounts[b]) + ")";
+            }
+            tempItem = new QTreeWidgetItem();
+            tempItem->setText(0, tr("Buses: ") + builder);
+            baseNode->addChild(tempItem);
+
+            builder.clear();
+            for (int l = 0; l < 32; l++)
+            {
+                if (!(info->dlcMask & (1u << l))) continue;
+                if (!builder.isEmpty()) builder += ", ";
+                builder += QString::number(l);
+            }
+            tempItem = new QTreeWidgetItem();
+            tempItem->setText(0, tr("Data lengths seen: ") + builder);
+            baseNode->addChild(tempItem);
+
+            tempItem = new QTreeWidgetItem();
+            tempItem->setText(0, tr("First seen: ") + QString::number(info->firstSeen / 1000000.0, 'f', 6) + "s");
+            baseNode->addChild(tempItem);
+
+            tempItem = new QTreeWidgetItem();
+            tempItem->setText(0, tr("Last seen: ") + QString::number(info->lastSeen / 1000000.0, 'f', 6) + "s");
+            baseNode->addChild(tempItem);
+        }
+
         //clear out all the counters and accumulators
         minLen = 8;
         maxLen = 0;
@@ -330,19 +350,32 @@ void FrameInfoWindow::updateDetailsWindow(QString newID)
 
 void FrameInfoWindow::refreshIDList()
 {
-    int id;
-    for (int i = 0; i < modelFrames->count(); i++)
+    //the model keeps a catalog of the IDs, no need to go through the frames
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
+    foundID.clear();
+    ui->listFrameID->clear();
+    addIDs(ids);
+    //default is to sort in ascending order
+    ui->listFrameID->sortItems();
+}
+
+//returns true if any of the IDs was not listed yet
+bool FrameInfoWindow::addIDs(const QVector<quint32> &ids)
+{
+    bool added = false;
+    foreach (quint32 id, ids)
     {
-        id = modelFrames->at(i).ID;
         if (!foundID.contains(id))
         {
             foundID.append(id);
             ui->listFrameID->addItem(Utility::formatNumber(id));
+            added = true;
         }
     }
-    //default is to sort in ascending order
-    ui->listFrameID->sortItems();
     ui->lblFrameID->setText(tr("Frame IDs: (") + QString::number(ui->listFrameID->count()) + tr(" unique ids)"));
+    return added;
 }
 
 void FrameInfoWindow::saveDetails()
@@ -17,7 +17,7 @@ class FrameInfoWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FrameInfoWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FrameInfoWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FrameInfoWindow();
     void showEvent(QShowEvent*);
 
@@ -31,9 +31,11 @@ private:
 
     QList<int> foundID;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
 
     void refreshIDList();
+    bool addIDs(const QVector<quint32> &ids);
     void closeEvent(QCloseEvent *event);
     void readSettings();
     void writeSettings();
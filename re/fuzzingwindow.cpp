@@ -5,13 +5,14 @@
 #include "mainwindow.h"
 #include "connections/canconmanager.h"
 
-FuzzingWindow::FuzzingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+FuzzingWindow::FuzzingWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FuzzingWindow)
 {
     ui->setupUi(this);
 
     modelFrames = frames;
+    knownIds = 0;
 
     fuzzTimer = new QTimer();
 
@@ -19,6 +20,7 @@ FuzzingWindow::FuzzingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
     connect(ui->btnAllFilters, &QPushButton::clicked, this, &FuzzingWindow::setAllFilters);
     connect(ui->btnNoFilters, &QPushButton::clicked, this, &FuzzingWindow::clearAllFilters);
     connect(fuzzTimer, &QTimer::timeout, this, &FuzzingWindow::timerTriggered);
+    connect(CANConManager::getInstance(), &CANConManager::txReady, this, &FuzzingWindow::sendPending);
     connect(ui->spinTiming, SIGNAL(valueChanged(int)), this, SLOT(changePlaybackSpeed(int)));
     connect(ui->listID, &QListWidget::itemChanged, this, &FuzzingWindow::idListChanged);
     connect(ui->spinBytes, SIGNAL(valueChanged(int)), this, SLOT(changedNumDataBytes(int)));
@@ -50,7 +52,6 @@ FuzzingWindow::~FuzzingWindow()
 
 void FuzzingWindow::updatedFrames(int numFrames)
 {
-    int id;
     if (numFrames == -1) //all frames deleted. Kill the display
     {
         ui->listID->clear();
@@ -65,10 +66,12 @@ void FuzzingWindow::updatedFrames(int numFrames)
     }
     else //just got some new frames. See if they are relevant.
     {
-        if (numFrames > modelFrames->count()) return;
-        for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
+        //the catalog of the model tells which IDs are new, no need to look at the frames
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        QVector<quint32> newIds = model->getIds(modelFrames, knownIds);
+        knownIds = model->getIdCatalog()->count();
+        foreach (quint32 id, newIds)
         {
-            id = modelFrames->at(i).ID;
             if (!foundIDs.contains(id))
             {
                 foundIDs.append(id);
@@ -111,6 +114,11 @@ void FuzzingWindow::changedNumDataBytes(int newVal)
 void FuzzingWindow::timerTriggered()
 {
     CANFrame thisFrame;
+
+    //don't generate a new burst before the last one got out completely
+    sendPending();
+    if (!pendingFrames.isEmpty()) return;
+
     sendingBuffer.clear();
     int buses = ui->cbBuses->currentIndex();
     for (int count = 0; count < ui->spinBurst->value(); count++)
@@ -140,10 +148,18 @@ void FuzzingWindow::timerTriggered()
         calcNextBitPattern();
         numSentFrames++;
     }
-    CANConManager::getInstance()->sendFrames(sendingBuffer);
+    pendingFrames = sendingBuffer;
+    sendPending();
     ui->lblNumFrames->setText("# of sent frames: " + QString::number(numSentFrames));
 }
 
+void FuzzingWindow::sendPending()
+{
+    if (pendingFrames.isEmpty()) return;
+    int sent = CANConManager::getInstance()->queueFrames(pendingFrames);
+    pendingFrames.erase(pendingFrames.begin(), pendingFrames.begin() + sent);
+}
+
 void FuzzingWindow::clearAllFilters()
 {
     for (int i = 0; i < ui->listID->count(); i++)
@@ -274,6 +290,7 @@ void FuzzingWindow::toggleFuzzing()
         ui->btnStartStop->setText("Start Fuzzing");
         currentlyFuzzing = false;
         fuzzTimer->stop();
+        pendingFrames.clear();
     }
     else //start it then
     {
@@ -344,10 +361,11 @@ void FuzzingWindow::refreshIDList()
     ui->listID->clear();
     foundIDs.clear();
 
-    int id;
-    for (int i = 0; i < modelFrames->count(); i++)
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
+    foreach (quint32 id, ids)
     {
-        id = modelFrames->at(i).ID;
         if (!foundIDs.contains(id))
         {
             foundIDs.append(id);
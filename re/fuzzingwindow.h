@@ -25,7 +25,7 @@ class FuzzingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit FuzzingWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit FuzzingWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~FuzzingWindow();
 
 signals:
@@ -42,14 +42,17 @@ private slots:
     void bitfieldClicked(int, int);
     void changedNumDataBytes(int newVal);
     void updatedFrames(int numFrames);
+    void sendPending();
 
 private:
     Ui::FuzzingWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
     QTimer *fuzzTimer;
     QList<int> foundIDs;
     QList<int> selectedIDs;
     QList<CANFrame> sendingBuffer;
+    QList<CANFrame> pendingFrames; //part of the last burst the transmit queues had no room for
     int startID, endID, currentID, currentIdx;
     bool seqIDScan, rangeIDSelect;
     int bitSequenceType;
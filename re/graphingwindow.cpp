@@ -4,7 +4,7 @@
 #include "mainwindow.h"
 #include <QDebug>
 
-GraphingWindow::GraphingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+GraphingWindow::GraphingWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::GraphingWindow)
 {
@@ -36,7 +36,7 @@ class GraphingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit GraphingWindow(const QVector<CANFrame> *, QWidget *parent = 0);
+    explicit GraphingWindow(const CANFrameList *, QWidget *parent = 0);
     ~GraphingWindow();
     void showEvent(QShowEvent*);
 
@@ -75,7 +75,7 @@ private:
     Ui::GraphingWindow *ui;
     DBCHandler *dbcHandler;
     QList<CANFrame> frameCache;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QList<GraphParams> graphParams;
     QPen selectedPen;
     QCPSelectionDecorator *selDecorator;
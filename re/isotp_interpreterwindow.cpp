@@ -2,7 +2,7 @@
 #include "ui_isotp_interpreterwindow.h"
 #include "mainwindow.h"
 
-ISOTP_InterpreterWindow::ISOTP_InterpreterWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+ISOTP_InterpreterWindow::ISOTP_InterpreterWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::ISOTP_InterpreterWindow)
 {
@@ -16,7 +16,7 @@ class ISOTP_InterpreterWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit ISOTP_InterpreterWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit ISOTP_InterpreterWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~ISOTP_InterpreterWindow();
     void showEvent(QShowEvent*);
 
@@ -29,7 +29,7 @@ private:
     Ui::ISOTP_InterpreterWindow *ui;
     ISOTP_HANDLER *decoder;
 
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QVector<ISOTP_MESSAGE> messages;
 
     void closeEvent(QCloseEvent *event);
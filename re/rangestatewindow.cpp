@@ -3,13 +3,14 @@
 #include "mainwindow.h"
 #include "utility.h"
 
-RangeStateWindow::RangeStateWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+RangeStateWindow::RangeStateWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::RangeStateWindow)
 {
     ui->setupUi(this);
 
     modelFrames = frames;
+    knownIds = 0;
 
     ui->graphSignal->xAxis->setRange(0, 8);
     ui->graphSignal->yAxis->setRange(-10, 265); //run range a bit outside possible number so they aren't plotted in a hard to see place
@@ -119,11 +120,11 @@ void RangeStateWindow::writeSettings()
 
 void RangeStateWindow::updatedFrames(int numFrames)
 {
-    CANFrame thisFrame;
     if (numFrames == -1) //all frames deleted. We don't need to do a thing on this window but erase everything in the filters section
     {
         ui->listFilter->clear();
         idFilters.clear();
+        knownIds = 0;
     }
     else if (numFrames == -2) //all new set of frames. Reset
     {
@@ -131,14 +132,16 @@ void RangeStateWindow::updatedFrames(int numFrames)
     }
     else //just got some new frames. See if we need to update the filters list. Otherwise nothing to do - no recalc happens until the button is pressed
     {
-        if (numFrames > modelFrames->count()) return;
-        for (int i = modelFrames->count() - numFrames; i < modelFrames->count(); i++)
+        //new IDs come from the catalog of the model
+        CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+        QVector<quint32> newIds = model->getIds(modelFrames, knownIds);
+        knownIds = model->getIdCatalog()->count();
+        foreach (quint32 id, newIds)
         {
-            thisFrame = modelFrames->at(i);
-            if (!idFilters.contains(thisFrame.ID))
+            if (!idFilters.contains(id))
             {
-                idFilters.insert(thisFrame.ID, true);
-                QListWidgetItem* listItem = new QListWidgetItem(Utility::formatNumber(thisFrame.ID), ui->listFilter);
+                idFilters.insert(id, true);
+                QListWidgetItem* listItem = new QListWidgetItem(Utility::formatNumber(id), ui->listFilter);
                 listItem->setFlags(listItem->flags() | Qt::ItemIsUserCheckable); // set checkable flag
                 listItem->setCheckState(Qt::Checked); //default all filters to be set active
             }
@@ -148,14 +151,14 @@ void RangeStateWindow::updatedFrames(int numFrames)
 
 void RangeStateWindow::refreshFilterList()
 {
-    int id;
-
     idFilters.clear();
     ui->listFilter->clear();
 
-    for (int i = 0; i < modelFrames->length(); i++)
+    CANFrameModel *model = MainWindow::getReference()->getCANFrameModel();
+    QVector<quint32> ids = model->getIds(modelFrames);
+    knownIds = model->getIdCatalog()->count();
+    foreach (quint32 id, ids)
     {
-        id = modelFrames->at(i).ID;
         if (!idFilters.contains(id))
         {
             idFilters.insert(id, true);
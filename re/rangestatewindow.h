@@ -13,7 +13,7 @@ class RangeStateWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit RangeStateWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit RangeStateWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~RangeStateWindow();
     void showEvent(QShowEvent*);
 
@@ -24,7 +24,8 @@ private slots:
 
 private:
     Ui::RangeStateWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
+    int knownIds; //IDs of the catalog already listed, see CANFrameModel::getIds()
     QVector<CANFrame> frameCache;
     QList<int64_t> foundSignals;
     QHash<int, bool> idFilters;
@@ -228,7 +228,7 @@ void SnifferModel::filter(fltType pType, int pId)
 /**********         slots       ****************/
 /***********************************************/
 
-void SnifferModel::update(CANConnection*, QVector<CANFrame>& pFrames)
+void SnifferModel::update(const QVector<CANFrame>& pFrames)
 {
     foreach(const CANFrame& frame, pFrames)
     {
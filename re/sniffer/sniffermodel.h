@@ -42,7 +42,7 @@ public:
     void filter(fltType pType, int pId=0);
 
 public slots:
-    void update(CANConnection*, QVector<CANFrame>&);
+    void update(const QVector<CANFrame>&);
     void notch();
     void unNotch();
 
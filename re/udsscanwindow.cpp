@@ -5,7 +5,7 @@
 #include "bus_protocols/uds_handler.h"
 #include "utility.h"
 
-UDSScanWindow::UDSScanWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+UDSScanWindow::UDSScanWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::UDSScanWindow)
 {
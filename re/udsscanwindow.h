@@ -18,7 +18,7 @@ class UDSScanWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit UDSScanWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit UDSScanWindow(const CANFrameList *frames, QWidget *parent = 0);
     ~UDSScanWindow();
 
 private slots:
@@ -37,7 +37,7 @@ private slots:
 
 private:
     Ui::UDSScanWindow *ui;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     UDS_HANDLER *udsHandler;
     QTimer *waitTimer;
     QList<UDS_MESSAGE> sendingFrames;
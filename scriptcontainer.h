@@ -28,6 +28,7 @@ public slots:
 
 private slots:
     void gotTargettedFrame(const CANFrame &frame);
+    void gotTargettedFrames(const QVector<CANFrame> &frames);
 
 private:
     QList<CANFilter> filters;
@@ -7,7 +7,7 @@
 
 #include "connections/canconmanager.h"
 
-ScriptingWindow::ScriptingWindow(const QVector<CANFrame> *frames, QWidget *parent) :
+ScriptingWindow::ScriptingWindow(const CANFrameList *frames, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::ScriptingWindow)
 {
@@ -48,10 +48,9 @@ ScriptingWindow::~ScriptingWindow()
 }
 
 
-void ScriptingWindow::newFrames(const CANConnection* pConn, const QVector<CANFrame>& pFrames)
+void ScriptingWindow::newFrames(const QVector<CANFrame>& pFrames)
 {
-    /*FIXME: name of the probe and bus should be checked */
-    Q_UNUSED(pConn);
+    /*FIXME: bus should be checked */
 
     for (int j = 0; j < scripts.length(); j++)
     {
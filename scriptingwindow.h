@@ -20,7 +20,7 @@ class ScriptingWindow : public QDialog
     Q_OBJECT
 
 public:
-    explicit ScriptingWindow(const QVector<CANFrame> *frames, QWidget *parent = 0);
+    explicit ScriptingWindow(const CANFrameList *frames, QWidget *parent = 0);
     void showEvent(QShowEvent*);
     ~ScriptingWindow();
 
@@ -36,7 +36,7 @@ private slots:
     void revertScript();
     void recompileScript();
     void changeCurrentScript();
-    void newFrames(const CANConnection*, const QVector<CANFrame>&);
+    void newFrames(const QVector<CANFrame>&);
     void clickedLogClear();
 
 private:
@@ -48,7 +48,7 @@ private:
     JSEdit *editor;
     QList<ScriptContainer *> scripts;
     ScriptContainer *currentScript;
-    const QVector<CANFrame> *modelFrames;
+    const CANFrameList *modelFrames;
     QElapsedTimer elapsedTime;
 };
 
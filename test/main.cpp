@@ -1,12 +1,22 @@
 #include <QtTest>
+#include <QApplication>
 
 #include "tst_lfqueue.h"
 #include "tst_cancon.h"
+#include "tst_canconmanager.h"
+#include "tst_gvretserial.h"
+#include "tst_canframestore.h"
+#include "tst_canidfilter.h"
+#include "tst_canframemodel.h"
+#include "tst_canframequery.h"
 
 
 int main(int argc, char** argv)
 {
-   QCoreApplication app(argc, argv);
+   //the model tests need a GUI application, they run without a display
+   if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+       qputenv("QT_QPA_PLATFORM", "offscreen");
+   QApplication app(argc, argv);
 
    int status = 0;
    auto ASSERT_TEST = [&status, argc, argv](QObject* obj) {
@@ -15,7 +25,13 @@ int main(int argc, char** argv)
    };
 
    ASSERT_TEST(new TestLFQueue());
-   ASSERT_TEST(new TestCanCon(CANCon::SOCKETCAN, "vcan0", 1));
+   ASSERT_TEST(new TestCanConManager());
+   ASSERT_TEST(new TestGVRetSerial());
+   ASSERT_TEST(new TestCANFrameStore());
+   ASSERT_TEST(new TestCANIdFilter());
+   ASSERT_TEST(new TestCANFrameModel());
+   ASSERT_TEST(new TestCANFrameQuery());
+   ASSERT_TEST(new TestCanCon(CANConnection::typeSocketCan(), "vcan0", 1));
 
    return status;
 }
@@ -1,4 +1,4 @@
-QT += core gui serialbus widgets testlib serialbus
+QT += core gui serialbus widgets testlib serialbus concurrent
 
 
 CONFIG += c++11
@@ -9,11 +9,31 @@ SOURCES += \
     tst_lfqueue.cpp \
     main.cpp \
     tst_cancon.cpp \
+    tst_canconmanager.cpp \
+    tst_gvretserial.cpp \
+    tst_canframestore.cpp \
+    tst_canidfilter.cpp \
+    tst_canframemodel.cpp \
+    tst_canframequery.cpp \
+    ../canframestore.cpp \
+    ../canframetimeindex.cpp \
+    ../mappedfileallocator.cpp \
+    ../canidfilter.cpp \
+    ../canidcatalog.cpp \
+    ../canframequery.cpp \
+    ../canframemodel.cpp \
+    ../framedatadelegate.cpp \
+    ../utility.cpp \
+    ../dbc/dbchandler.cpp \
+    ../dbc/dbc_classes.cpp \
+    ../connections/canconmanager.cpp \
+    ../connections/canconingest.cpp \
     ../connections/canconfactory.cpp \
     ../connections/canconnection.cpp \
+    ../connections/serialbusconnection.cpp \
     ../connections/gvretserial.cpp \
-    ../connections/socketcan.cpp \
-    ../canbus.cpp
+    ../connections/simulatedconnection.cpp \
+    ../connections/canbus.cpp
 
 
 #HEADERS += \
@@ -25,9 +45,33 @@ INSTALLS += target
 HEADERS += \
     tst_lfqueue.h \
     tst_cancon.h \
-    ../connections/canconconst.h \
+    tst_canconmanager.h \
+    tst_gvretserial.h \
+    tst_canframestore.h \
+    tst_canidfilter.h \
+    tst_canframemodel.h \
+    tst_canframequery.h \
+    ../canframestore.h \
+    ../canframetimeindex.h \
+    ../mappedfileallocator.h \
+    ../canidfilter.h \
+    ../canidcatalog.h \
+    ../canframequery.h \
+    ../canframemodel.h \
+    ../framedatadelegate.h \
+    ../utility.h \
+    ../dbc/dbchandler.h \
+    ../dbc/dbc_classes.h \
+    ../connections/canconmanager.h \
+    ../connections/canconingest.h \
     ../connections/canconfactory.h \
     ../connections/canconnection.h \
+    ../connections/serialbusconnection.h \
     ../connections/gvretserial.h \
-    ../connections/socketcan.h \
-    ../canbus.h
+    ../connections/simulatedconnection.h \
+    ../connections/canbus.h
+
+linux {
+   SOURCES += ../connections/socketcan.cpp
+   HEADERS += ../connections/socketcan.h
+}
@@ -22,11 +22,28 @@ Q_DECLARE_METATYPE(QVector<CANFlt>);
 
 
 
-TestCanCon::TestCanCon(CANCon::type pType, QString pPortName, int pNbBus):
+TestCanCon::TestCanCon(QString pType, QString pPortName, int pNbBus):
     mType(pType),
     mPortName(pPortName),
     mNbBus(pNbBus){}
 
+
+void TestCanCon::initTestCase()
+{
+    CANConnection* conn_p = CanConFactory::create(mType, mPortName);
+    QVERIFY(conn_p);
+
+    conn_p->start();
+    pConfig(conn_p);
+    bool connected = (conn_p->getStatus() == CANConnection::Connected);
+    conn_p->stop();
+    delete conn_p;
+
+    if(!connected)
+        QSKIP(qPrintable(mPortName + " is not available"));
+}
+
+
 void TestCanCon::create()
 {
     CANConnection* conn_p;
@@ -43,20 +60,25 @@ void TestCanCon::connectToDevice()
     CANConnection* conn_p;
     QVERIFY(pCreate(conn_p));
 
-    QSignalSpy spy(conn_p, SIGNAL(status(CANCon::status)));
+    /* status is emitted from the working thread */
+    QAtomicInt statusCount;
+    QAtomicInt lastStatus(CANConnection::Disconnected);
+    connect(conn_p, &CANConnection::status, this,
+        [&](CANConnection::Status pStatus) {
+            lastStatus.store(pStatus);
+            statusCount.ref();
+        }, Qt::DirectConnection);
 
     /* start connection */
     conn_p->start();
+    QVERIFY(pConfig(conn_p));
 
     /* wait for a signal */
-    for(int i=0 ; (spy.count() != 1) && (i < 10) ; i++)
+    for(int i=0 ; (statusCount.load() != 1) && (i < 10) ; i++)
         QTest::qWait(500);
 
-
-    QCOMPARE(spy.count(), 1); // make sure the signal was emitted exactly one time
-    QList<QVariant> arguments = spy.takeFirst(); // take the first signal
-
-    QVERIFY(arguments.at(0).toInt() == CANCon::CONNECTED); // verify the first argument
+    QCOMPARE(statusCount.load(), 1); // make sure the signal was emitted exactly one time
+    QCOMPARE(lastStatus.load(), (int) CANConnection::Connected);
 
     /* stop connection */
     conn_p->stop();
@@ -66,195 +88,166 @@ void TestCanCon::connectToDevice()
 void TestCanCon::recvFrames()
 {
     CANConnection* conn_p;
+    CANConnection* tx_p;
     QVERIFY(pCreate(conn_p));
+    QVERIFY(pCreate(tx_p));
 
-    /* start connection */
+    /* start connections */
     conn_p->start();
+    tx_p->start();
 
     /* configure */
     QVERIFY(pConfig(conn_p));
+    QVERIFY(pConfig(tx_p));
 
-    LFQueue<CANFrame>& queue = conn_p->getQueue();
+    pSend(tx_p, 0x100, 100);
 
-    /* wait for frames to arrive */
-    QTest::qWait(1000);
+    QVector<CANFrame> frames;
+    QCOMPARE(pReceive(conn_p, frames, 100), 100);
 
-    int i;
-    for(i=0 ; queue.peek() && i<1000 ; i++)
+    for(int i=0 ; i<frames.count() ; i++)
     {
-        CANFrame* canf_p = queue.peek();
-        QVERIFY(pValidateFrame(conn_p, canf_p));
-
-        queue.dequeue();
+        QVERIFY(pValidateFrame(conn_p, &frames[i]));
+        QCOMPARE(frames[i].ID, (uint32_t) (0x100 + i));
+        QCOMPARE(frames[i].data[0], (unsigned char) i);
+        if(i)
+            QVERIFY(frames[i].timestamp >= frames[i-1].timestamp);
     }
 
-    QVERIFY(i>0);
-
-    /* stop connection */
+    /* stop connections */
     conn_p->stop();
+    tx_p->stop();
     delete conn_p;
+    delete tx_p;
 }
 
 
 void TestCanCon::suspend()
 {
     CANConnection* conn_p;
+    CANConnection* tx_p;
     QVERIFY(pCreate(conn_p));
+    QVERIFY(pCreate(tx_p));
 
-    /* start connection */
+    /* start connections */
     conn_p->start();
+    tx_p->start();
 
     /* configure */
     QVERIFY(pConfig(conn_p));
+    QVERIFY(pConfig(tx_p));
 
     LFQueue<CANFrame>& queue = conn_p->getQueue();
 
-    /* wait for frames to arrive */
-    QTest::qWait(1000);
+    pSend(tx_p, 0x100, 10);
+    QTest::qWait(100);
 
     CANFrame* canf_p = queue.peek();
     QVERIFY(pValidateFrame(conn_p, canf_p));
 
     conn_p->suspend(true);
+    QVERIFY(conn_p->isCapSuspended());
 
-    /* the queue should be flushed */
+    /* we are the consumer, what was queued before the suspend is ours to drop */
+    QVERIFY(queue.discard() > 0);
     canf_p = queue.peek();
     QVERIFY(!canf_p);
 
+    /* nothing is captured while suspended */
+    pSend(tx_p, 0x200, 10);
+    QTest::qWait(100);
+    QVERIFY(!queue.peek());
+
     /* restart capture */
     conn_p->suspend(false);
 
-    /* wait for frames to arrive */
-    QTest::qWait(1000);
+    pSend(tx_p, 0x300, 10);
 
     /* get a frame */
-    canf_p = queue.peek();
-    QVERIFY(pValidateFrame(conn_p, canf_p));
+    QVector<CANFrame> frames;
+    QCOMPARE(pReceive(conn_p, frames, 10), 10);
+    QCOMPARE(frames[0].ID, (uint32_t) 0x300);
 
-    /* stop connection */
+    /* stop connections */
     conn_p->stop();
+    tx_p->stop();
     delete conn_p;
+    delete tx_p;
 }
 
 
 void TestCanCon::filter_data()
 {
-    CANConnection* conn_p;
-    QVERIFY(pCreate(conn_p));
-
-    /* start connection */
-    conn_p->start();
-
-    /* configure */
-    QVERIFY(pConfig(conn_p));
-
-    LFQueue<CANFrame>& queue = conn_p->getQueue();
-
-    /* wait for frames to arrive */
-    QTest::qWait(1000);
-
-    /* find 3 different ids */
-    QVector<quint32> ids;
-
-    while( queue.peek() && ids.count()!=3 )
-    {
-        CANFrame* canf_p = queue.peek();
-        QVERIFY(pValidateFrame(conn_p, canf_p));
-
-        if(!ids.contains(canf_p->ID))
-            ids.append(canf_p->ID);
-
-        queue.dequeue();
-    }
-
-    QCOMPARE(ids.count(), 3);
-
-    /* stop connection */
-    conn_p->stop();
-    delete conn_p;
-
-    /* prepare test vector */
-
     QTest::addColumn<QVector<CANFlt>>("filters");
-    QTest::addColumn<bool>("filterOut");
-    QTest::addColumn<bool>("signalReceived");
     QTest::addColumn<QVector<quint32>>("filtered");
 
     QVector<CANFlt> filters;
     QVector<quint32> filteredIds;
 
-    /* one filter no signal*/
-    filters.clear();
-    filteredIds.clear();
-    filters.append({ids[0], 0xFFFF, false});
-    filteredIds.append(ids[0]);
-    QTest::newRow("1filternosignal")        << filters << false << false << filteredIds;
+    /* no filter */
+    for(quint32 id=0x100 ; id<0x110 ; id++)
+        filteredIds.append(id);
+    QTest::newRow("nofilter")       << filters << filteredIds;
 
-    /* one filter & signal*/
+    /* one filter */
     filters.clear();
     filteredIds.clear();
-    filters.append({ids[0], 0xFFFF, true});
-    filteredIds.append(ids[0]);
-    QTest::newRow("1filtersignal")          << filters << false << true << filteredIds;
+    filters.append({0x105, 0x7FF});
+    filteredIds.append(0x105);
+    QTest::newRow("1filter")        << filters << filteredIds;
 
-    /* 3 filters */
+    /* 3 filters, one of them masked */
     filters.clear();
     filteredIds.clear();
-    foreach(quint32 id, ids) {
-        filters.append({id, 0xFFFF, false});
-        filteredIds.append(id);
-    }
-    QTest::newRow("3filters")               << filters << false << false << filteredIds;
+    filters.append({0x101, 0x7FF});
+    filters.append({0x10A, 0x7FF});
+    filters.append({0x10C, 0x7FC});
+    filteredIds << 0x101 << 0x10A << 0x10C << 0x10D << 0x10E << 0x10F;
+    QTest::newRow("3filters")       << filters << filteredIds;
 }
 
 
 void TestCanCon::filter()
 {
     QFETCH(QVector<CANFlt>, filters);
-    QFETCH(bool, filterOut);
-    QFETCH(bool, signalReceived);
     QFETCH(QVector<quint32>, filtered);
 
     CANConnection* conn_p;
+    CANConnection* tx_p;
     QVERIFY(pCreate(conn_p));
+    QVERIFY(pCreate(tx_p));
 
-    /* start connection */
+    /* start connections */
     conn_p->start();
+    tx_p->start();
 
     /* set filters */
     for(int i=0 ; i<conn_p->getNumBuses() ; i++)
-        QVERIFY(conn_p->setFilters(i, filters, filterOut));
-
-    /* spy signal */
-    QSignalSpy spy(conn_p, SIGNAL(notify()));
+        QVERIFY(conn_p->setFilters(i, filters));
 
     /* configure */
     QVERIFY(pConfig(conn_p));
+    QVERIFY(pConfig(tx_p));
 
-    LFQueue<CANFrame>& queue = conn_p->getQueue();
+    pSend(tx_p, 0x100, 16);
 
-    /* wait for frames to arrive */
-    QTest::qWait(1000);
+    QVector<CANFrame> frames;
+    QCOMPARE(pReceive(conn_p, frames, filtered.count()), filtered.count());
 
-    if(signalReceived)
-        QVERIFY(spy.count()>0);
+    /* nothing else comes in */
+    QTest::qWait(100);
+    QVERIFY(!conn_p->getQueue().peek());
 
-    int i;
-    for(i=0 ; queue.peek() && i<1000 ; i++)
+    for(int i=0 ; i<frames.count() ; i++)
     {
-        CANFrame* canf_p = queue.peek();
-        QVERIFY(pValidateFrame(conn_p, canf_p));
-
-        if(filterOut)
-            QVERIFY(filtered.contains(canf_p->ID));
-
-        queue.dequeue();
+        QVERIFY(pValidateFrame(conn_p, &frames[i]));
+        QCOMPARE(frames[i].ID, filtered[i]);
     }
 
-    QVERIFY(i>0);
-
     conn_p->stop();
+    tx_p->stop();
     delete conn_p;
+    delete tx_p;
 }
 
 
@@ -269,9 +262,18 @@ void TestCanCon::write()
     /* configure */
     QVERIFY(pConfig(conn_p));
 
+    int sent = 0;
+    int failed = 0;
+    QMetaObject::Connection tx = connect(conn_p, &CANConnection::framesSent, this,
+        [&](quint64, int pCount, int pFailed) {
+            sent += pCount;
+            failed += pFailed;
+        });
+
     QList<CANFrame> frames;
     /* build frames */
     CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
     frame.bus       = 0;
     frame.ID        = 0x1DE;
     frame.data[0]   = 0xDE;
@@ -302,26 +304,58 @@ void TestCanCon::write()
     QCOMPARE(conn_p->sendFrame(frame), false);
     frame.bus       = oldVal;
 
-    qDebug() << "Sending DE AD DE AD";
     /* send */
     QVERIFY(conn_p->sendFrame(frame));
+    QVERIFY(conn_p->sendFrames(frames));
 
-    /* leave some time for the frame to be sent */
-    QTest::qWait(1000);
+    /* leave some time for the frames to be sent */
+    for(int i=0 ; (sent < 3) && (i < 50) ; i++)
+        QTest::qWait(20);
 
-    qDebug() << "Sending DE AD C0 DE";
-    qDebug() << "Sending DE AD BE EF";
-    /* send */
-    QVERIFY(conn_p->sendFrames(frames));
+    disconnect(tx);
 
-    /* leave some time for the frame to be sent */
-    QTest::qWait(1000);
+    QCOMPARE(sent, 3);
+    QCOMPARE(failed, 0);
 
     conn_p->stop();
     delete conn_p;
 }
 
 
+void TestCanCon::recvThroughput()
+{
+    const int count = 10000;
+
+    CANConnection* conn_p;
+    CANConnection* tx_p;
+    QVERIFY(pCreate(conn_p));
+    QVERIFY(pCreate(tx_p));
+
+    conn_p->start();
+    tx_p->start();
+    QVERIFY(pConfig(conn_p));
+    QVERIFY(pConfig(tx_p));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pSend(tx_p, 0, count);
+
+    QVector<CANFrame> frames;
+    int received = pReceive(conn_p, frames, count);
+    qint64 elapsed = timer.elapsed();
+
+    conn_p->stop();
+    tx_p->stop();
+    delete conn_p;
+    delete tx_p;
+
+    /* vcan doesn't drop, a real bus might */
+    QVERIFY(received > 0);
+    qDebug() << "received" << received << "of" << count << "frames in" << elapsed << "ms";
+}
+
+
 /*********************************************************/
 
 bool TestCanCon::pCreate(CANConnection*& pConn_p)
@@ -332,7 +366,7 @@ bool TestCanCon::pCreate(CANConnection*& pConn_p)
     QCOMPAREB(pConn_p->getPort(),     mPortName);
     QCOMPAREB(pConn_p->getNumBuses(), mNbBus);
     QCOMPAREB(pConn_p->getType(),     mType);
-    QCOMPAREB(pConn_p->getStatus(),   CANCon::NOT_CONNECTED);
+    QCOMPAREB(pConn_p->getStatus(),   CANConnection::Disconnected);
 
     return true;
 }
@@ -344,8 +378,8 @@ bool TestCanCon::pConfig(CANConnection* pConn_p)
     CANBus retBus;
     for(int i=0 ; i<pConn_p->getNumBuses() ; i++)
     {
-        /* TODO: fix configuration */
         bus.active = true;
+        bus.speed = 500000;
         pConn_p->setBusSettings(i, bus);
         QVERIFYB(pConn_p->getBusSettings(i, retBus));
         QCOMPAREB(bus, retBus);
@@ -357,10 +391,53 @@ bool TestCanCon::pConfig(CANConnection* pConn_p)
 bool TestCanCon::pValidateFrame(CANConnection* pConn_p, CANFrame* pCan_p)
 {
     QVERIFYB( pCan_p );
-    QVERIFYB( (0<=pCan_p->bus) && (pCan_p->bus <= pConn_p->getNumBuses()) );
+    QVERIFYB( pCan_p->bus < (uint32_t) pConn_p->getNumBuses() );
     QVERIFYB( pCan_p->isReceived);
     QVERIFYB( pCan_p->len<=8 );
-    QVERIFYB( (0<=pCan_p->ID) && (pCan_p->ID<2048) );
+    QVERIFYB( pCan_p->ID<2048 );
+    QVERIFYB( pCan_p->timestamp );
 
     return true;
 }
+
+/* sends pCount frames with consecutive ids, the first data byte holds the index of the frame */
+void TestCanCon::pSend(CANConnection* pConn_p, quint32 pFirstId, int pCount)
+{
+    QList<CANFrame> frames;
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+
+    for(int i=0 ; i<pCount ; i++) {
+        frame.ID = (pFirstId + i) & 0x7FF;
+        frame.data[0] = (unsigned char) i;
+        frames.append(frame);
+    }
+
+    pConn_p->sendFrames(frames);
+}
+
+/* drains the queue until pExpected frames have been received or nothing came in for a second */
+int TestCanCon::pReceive(CANConnection* pConn_p, QVector<CANFrame>& pFrames, int pExpected)
+{
+    LFQueue<CANFrame>& queue = pConn_p->getQueue();
+    CANFrame* first_p;
+    int idle = 0;
+
+    while( (pFrames.count() < pExpected) && (idle < 50) )
+    {
+        int count = queue.peekBatch(first_p, queue.capacity());
+        if(!count) {
+            QTest::qWait(20);
+            idle++;
+            continue;
+        }
+
+        for(int i=0 ; i<count ; i++)
+            pFrames.append(first_p[i]);
+        queue.dequeueBatch(count);
+        idle = 0;
+    }
+
+    return pFrames.count();
+}
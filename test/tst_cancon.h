@@ -2,20 +2,25 @@
 #define TESTCANCON_H
 
 #include <QObject>
-#include "canconconst.h"
 #include "canconnection.h"
 
+/*
+ * Tests a connection type against a live port. Frames are produced by a second
+ * connection of the same type on the same port, for SocketCAN a vcan interface will do:
+ * ip link add dev vcan0 type vcan && ip link set up vcan0
+ */
 class TestCanCon: public QObject
 {
     Q_OBJECT
 public:
-    TestCanCon(CANCon::type, QString pPortName, int pNbBus);
+    TestCanCon(QString pType, QString pPortName, int pNbBus);
 private:
-    CANCon::type mType;
+    QString      mType;
     QString      mPortName;
     int          mNbBus;
 
 private slots:
+    void initTestCase();
     void create();
     void connectToDevice();
     void recvFrames();
@@ -23,11 +28,14 @@ private slots:
     void filter();
     void filter_data();
     void write();
+    void recvThroughput();
 
 private:
     bool pCreate(CANConnection*& pConn_p);
     bool pConfig(CANConnection* pConn_p);
     bool pValidateFrame(CANConnection* pConn_p, CANFrame* pCan_p);
+    void pSend(CANConnection* pConn_p, quint32 pFirstId, int pCount);
+    int  pReceive(CANConnection* pConn_p, QVector<CANFrame>& pFrames, int pExpected);
 };
 
 #endif // TESTCANCON_H
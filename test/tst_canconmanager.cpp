@@ -0,0 +1,376 @@
+#include <QtTest>
+
+#include <QtConcurrent/qtconcurrentrun.h>
+
+#include "canconnection.h"
+#include "canconmanager.h"
+#include "canconfactory.h"
+#include "tst_canconmanager.h"
+
+
+/* connection fed directly by the test, frames carry the time they were queued (ns) as timestamp */
+class LoopbackConnection : public CANConnection
+{
+public:
+    LoopbackConnection(bool pNotify) :
+        CANConnection("LOOPBACK", "loop0", 1, 256, false),
+        mNotify(pNotify) {}
+
+    void push(CANFrame& pFrame) {
+        pFrame.timestamp = getElapsedNs();
+        pushStamped(pFrame);
+    }
+
+    void pushStamped(const CANFrame& pFrame) {
+        CANFrame* frame_p = getQueueSlot(0);
+        if(frame_p) {
+            *frame_p = pFrame;
+            getQueue().queue();
+        }
+        if(mNotify)
+            notifyFramesQueued();
+    }
+
+    /* a received batch, as a device would do it */
+    void receive(const QVector<CANFrame>& pFrames) {
+        foreach(const CANFrame& frame, pFrames)
+            checkTargettedFrame(frame);
+        flushTargettedFrames();
+    }
+
+protected:
+    virtual void piStarted() {}
+    virtual void piStop() {}
+    virtual void piSetBusSettings(int, CANBus) {}
+    virtual bool piGetBusSettings(int, CANBus&) { return false; }
+    virtual void piSuspend(bool) {}
+    virtual bool piSendFrame(const CANFrame&) { return true; }
+
+private:
+    bool mNotify;
+};
+
+
+/* threaded connection taking 1ms to send each frame */
+class SlowTxConnection : public CANConnection
+{
+public:
+    SlowTxConnection() :
+        CANConnection("SLOWTX", "slow0", 1, 256, true) {}
+
+protected:
+    virtual void piStarted() {}
+    virtual void piStop() {}
+    virtual void piSetBusSettings(int, CANBus) {}
+    virtual bool piGetBusSettings(int, CANBus&) { return false; }
+    virtual void piSuspend(bool) {}
+    virtual bool piSendFrame(const CANFrame& pFrame) {
+        QThread::msleep(1);
+        return (pFrame.ID != 0x7FF);
+    }
+};
+
+
+void loopbackWriterThread(LoopbackConnection* pConn_p, int pCount)
+{
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+
+    for(int i=0 ; i<pCount ; i++) {
+        frame.ID = i;
+        pConn_p->push(frame);
+        QThread::msleep(3);
+    }
+}
+
+
+void TestCanConManager::wakeupLatency_data()
+{
+    QTest::addColumn<bool>("notify");
+    QTest::addColumn<int>("pollInterval");
+
+    /* previous behaviour: 20ms poll, no wakeup */
+    QTest::newRow("poll")   << false << 20;
+    QTest::newRow("event")  << true  << 250;
+}
+
+
+void TestCanConManager::wakeupLatency()
+{
+    QFETCH(bool, notify);
+    QFETCH(int, pollInterval);
+    const int count = 200;
+
+    CANConManager* manager = CANConManager::getInstance();
+    LoopbackConnection conn(notify);
+
+    manager->setPollInterval(pollInterval);
+    manager->add(&conn);
+
+    int received = 0;
+    qint64 sum = 0;
+    qint64 max = 0;
+    /* the context object makes the lambda run in our thread, not in the ingest thread */
+    QMetaObject::Connection rx = connect(manager, &CANConManager::framesReceived, this,
+        [&](const QVector<CANFrame>& pFrames) {
+            qint64 now = CANConnection::getElapsedNs();
+            foreach(const CANFrame& frame, pFrames) {
+                qint64 latency = now - (qint64) frame.timestamp;
+                sum += latency;
+                if(latency > max) max = latency;
+                received++;
+            }
+        });
+
+    QFuture<void> thread = QtConcurrent::run(loopbackWriterThread, &conn, count);
+    for(int i=0 ; (received < count) && (i < 100) ; i++)
+        QTest::qWait(50);
+    thread.waitForFinished();
+
+    disconnect(rx);
+    manager->remove(&conn);
+    manager->setPollInterval(250);
+
+    QCOMPARE(received, count);
+    qDebug() << QTest::currentDataTag() << "end to end latency: avg"
+             << sum / received / 1000 << "us, max" << max / 1000 << "us";
+}
+
+
+void TestCanConManager::mergeOrder()
+{
+    const int count = 100;
+
+    CANConManager* manager = CANConManager::getInstance();
+    LoopbackConnection connA(false);
+    LoopbackConnection connB(false);
+
+    /* interleaved timestamps, everything is queued before the ingest thread sees the connections */
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+    for(int i=0 ; i<count ; i++) {
+        frame.ID = 0x100;
+        frame.timestamp = 2*i;
+        connA.pushStamped(frame);
+        frame.ID = 0x200;
+        frame.timestamp = 2*i + 1;
+        connB.pushStamped(frame);
+    }
+
+    QVector<CANFrame> received;
+    QMetaObject::Connection rx = connect(manager, &CANConManager::framesReceived, this,
+        [&](const QVector<CANFrame>& pFrames) {
+            received += pFrames;
+        });
+
+    /* no drain until both connections are known */
+    manager->setPollInterval(60000);
+    manager->add(&connA);
+    manager->add(&connB);
+    manager->setPollInterval(20);
+
+    for(int i=0 ; (received.count() < 2*count) && (i < 100) ; i++)
+        QTest::qWait(20);
+
+    disconnect(rx);
+    manager->remove(&connA);
+    manager->remove(&connB);
+    manager->setPollInterval(250);
+
+    QCOMPARE(received.count(), 2*count);
+    for(int i=0 ; i<received.count() ; i++) {
+        QCOMPARE(received[i].timestamp, (uint64_t) i);
+        /* connB comes second, its local bus 0 is global bus 1 */
+        QCOMPARE(received[i].bus, (uint32_t) (i & 1));
+        QCOMPARE(received[i].ID, (uint32_t) ((i & 1) ? 0x200 : 0x100));
+    }
+}
+
+
+void TestCanConManager::txNonBlocking()
+{
+    const int count = 100;
+
+    SlowTxConnection conn;
+    conn.start();
+
+    int sent = 0;
+    int failed = 0;
+    quint64 lastSeq = 0;
+    QMetaObject::Connection tx = connect(&conn, &CANConnection::framesSent, this,
+        [&](quint64 pLastSeq, int pCount, int pFailed) {
+            lastSeq = pLastSeq;
+            sent += pCount;
+            failed += pFailed;
+        });
+
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+
+    /* queueing must not wait for the device */
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0 ; i<count ; i++) {
+        frame.ID = (i == count/2) ? 0x7FF : i;
+        QVERIFY(conn.sendFrame(frame));
+    }
+    qint64 queueTime = timer.elapsed();
+    QCOMPARE(conn.getTxSequence(), (quint64) count);
+
+    /* invalid bus is refused right away */
+    frame.bus = 1;
+    QVERIFY(!conn.sendFrame(frame));
+
+    for(int i=0 ; (sent < count) && (i < 100) ; i++)
+        QTest::qWait(20);
+
+    disconnect(tx);
+    conn.stop();
+
+    QCOMPARE(sent, count);
+    QCOMPARE(failed, 1);
+    QCOMPARE(lastSeq, (quint64) count);
+    QVERIFY(queueTime < count);
+    qDebug() << "queued" << count << "frames in" << queueTime << "ms, sent in" << timer.elapsed() << "ms";
+}
+
+
+/* more frames than the transmit queue holds, the rest is queued again each time a batch went out */
+void TestCanConManager::txBackpressure()
+{
+    const int count = 600;
+
+    SlowTxConnection conn;
+    conn.start();
+
+    QList<CANFrame> pending;
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+    for(int i=0 ; i<count ; i++) {
+        frame.ID = i;
+        pending.append(frame);
+    }
+
+    int sent = 0;
+    int failed = 0;
+    quint64 lastSeq = 0;
+    QMetaObject::Connection tx = connect(&conn, &CANConnection::framesSent, this,
+        [&](quint64 pLastSeq, int pCount, int pFailed) {
+            lastSeq = pLastSeq;
+            sent += pCount;
+            failed += pFailed;
+            int queued = conn.queueFrames(pending);
+            pending.erase(pending.begin(), pending.begin() + queued);
+        });
+
+    int queued = conn.queueFrames(pending);
+    pending.erase(pending.begin(), pending.begin() + queued);
+    QVERIFY(queued > 0);
+    QVERIFY(queued < count);
+
+    quint64 stSent, stFailed;
+    QVERIFY(conn.getTxStats(stSent, stFailed) <= queued);
+
+    for(int i=0 ; (sent < count) && (i < 200) ; i++)
+        QTest::qWait(20);
+
+    disconnect(tx);
+    conn.stop();
+
+    QVERIFY(pending.isEmpty());
+    QCOMPARE(sent, count);
+    QCOMPARE(failed, 0);
+    QCOMPARE(lastSeq, (quint64) count);
+    QCOMPARE(conn.getTxStats(stSent, stFailed), 0);
+    QCOMPARE(stSent, (quint64) count);
+}
+
+
+void TestCanConManager::targettedDispatch()
+{
+    LoopbackConnection conn(false);
+    TargetReceiver exact;
+    TargetReceiver masked;
+
+    QVERIFY(conn.addTargettedFrame(0, 0x123, 0x7FF, &exact));
+    QVERIFY(conn.addTargettedFrame(-1, 0x700, 0x700, &masked));
+
+    QVector<CANFrame> frames;
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    const uint32_t ids[] = {0x123, 0x124, 0x7AB, 0x123, 0x600};
+    for(uint32_t id : ids) {
+        frame.ID = id;
+        frames.append(frame);
+    }
+
+    conn.receive(frames);
+
+    /* one delivery per observer for the whole batch */
+    QTRY_COMPARE(exact.batches, 1);
+    QCOMPARE(exact.frames.count(), 2);
+    QTRY_COMPARE(masked.batches, 1);
+    QCOMPARE(masked.frames.count(), 1);
+    QCOMPARE(masked.frames[0].ID, (uint32_t) 0x7AB);
+
+    /* nothing is delivered once unregistered */
+    QVERIFY(conn.removeAllTargettedFrames(&exact));
+    conn.receive(frames);
+    /* both deliveries are queued by the same flush, the one that went through tells it is done */
+    QTRY_COMPARE(masked.batches, 2);
+    QCOMPARE(exact.batches, 1);
+}
+
+
+void TestCanConManager::simulatedTraffic()
+{
+    CANConManager* manager = CANConManager::getInstance();
+    CANConnection* conn_p = CanConFactory::create(CANConnection::typeSimulated(),
+                                                  "buses=2;ids=10;period=1;pattern=counter");
+    QVERIFY(conn_p);
+    QCOMPARE(conn_p->getNumBuses(), 2);
+
+    CANBus bus;
+    bus.active = true;
+    bus.speed = 500000;
+    conn_p->setBusSettings(0, bus);
+    conn_p->setBusSettings(1, bus);
+
+    QVector<CANFrame> received;
+    QMetaObject::Connection rx = connect(manager, &CANConManager::framesReceived, this,
+        [&](const QVector<CANFrame>& pFrames) {
+            received += pFrames;
+        });
+
+    manager->add(conn_p);
+    conn_p->start();
+    QTest::qWait(500);
+    conn_p->stop();
+    QTest::qWait(50);
+
+    disconnect(rx);
+    manager->remove(conn_p);
+    delete conn_p;
+
+    /* 20 ids every ms, leave room for a loaded machine */
+    QVERIFY(received.count() > 2000);
+
+    /* each id counts its frames in the first two bytes, in order */
+    QHash<quint32, int> counters;
+    for(int i=0 ; i<received.count() ; i++) {
+        const CANFrame& frame = received[i];
+        quint32 key = frame.bus << 16 | frame.ID;
+        int count = frame.data[0] | frame.data[1] << 8;
+        if(counters.contains(key))
+            QCOMPARE(count, (counters[key] + 1) & 0xFFFF);
+        counters[key] = count;
+        if(i)
+            QVERIFY(frame.timestamp >= received[i-1].timestamp);
+    }
+    QCOMPARE(counters.count(), 20);
+    qDebug() << "simulated" << received.count() << "frames in 500 ms";
+}
@@ -0,0 +1,36 @@
+#ifndef TST_CANCONMANAGER_H
+#define TST_CANCONMANAGER_H
+
+#include <QObject>
+#include <QVector>
+
+#include "can_structs.h"
+
+/* receives targetted frames in batches */
+class TargetReceiver: public QObject
+{
+    Q_OBJECT
+public:
+    TargetReceiver() : batches(0) {}
+    int                 batches;
+    QVector<CANFrame>   frames;
+public slots:
+    void gotTargettedFrames(const QVector<CANFrame>& pFrames) { batches++; frames += pFrames; }
+};
+
+class TestCanConManager: public QObject
+{
+    Q_OBJECT
+private:
+
+private slots:
+    void wakeupLatency_data();
+    void wakeupLatency();
+    void mergeOrder();
+    void txNonBlocking();
+    void txBackpressure();
+    void targettedDispatch();
+    void simulatedTraffic();
+};
+
+#endif // TST_CANCONMANAGER_H
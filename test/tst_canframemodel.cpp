@@ -0,0 +1,502 @@
+#include <QtTest>
+#include <QTableView>
+
+#include "canframemodel.h"
+#include "framedatadelegate.h"
+#include "utility.h"
+#include "tst_canframemodel.h"
+
+
+static QVector<CANFrame> makeFrames(int pFirst, int pCount)
+{
+    QVector<CANFrame> frames;
+    for(int i=pFirst ; i<pFirst+pCount ; i++) {
+        CANFrame frame;
+        frame.timestamp  = (uint64_t) i * 100;
+        frame.ID         = i & 0x7FF;
+        frame.extended   = false;
+        frame.isReceived = true;
+        frame.bus        = 0;
+        frame.len        = 8;
+        for(int j=0 ; j<8 ; j++)
+            frame.data[j] = (unsigned char) (i + j);
+        frames.append(frame);
+    }
+    return frames;
+}
+
+
+void TestCANFrameModel::incrementalInsert()
+{
+    CANFrameModel model;
+    QSignalSpy resets(&model, SIGNAL(modelReset()));
+    QSignalSpy inserts(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+
+    /* rows are announced by the bulk refresh, not frame by frame */
+    model.addFrames(makeFrames(0, 100));
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(model.sendBulkRefresh(), 100);
+    QCOMPARE(model.rowCount(), 100);
+
+    model.addFrames(makeFrames(100, 50));
+    QCOMPARE(model.sendBulkRefresh(), 50);
+    QCOMPARE(model.rowCount(), 150);
+    QCOMPARE(model.sendBulkRefresh(), 0);
+
+    QCOMPARE(resets.count(), 0);
+    QCOMPARE(inserts.count(), 2);
+    QCOMPARE(inserts.at(0).at(1).toInt(), 0);
+    QCOMPARE(inserts.at(0).at(2).toInt(), 99);
+    QCOMPARE(inserts.at(1).at(1).toInt(), 100);
+    QCOMPARE(inserts.at(1).at(2).toInt(), 149);
+}
+
+
+void TestCANFrameModel::evictedRows()
+{
+    CANFrameModel model;
+    model.setCaptureLimit(100, 0);
+
+    model.addFrames(makeFrames(0, 150));
+    model.sendBulkRefresh();
+    QCOMPARE(model.rowCount(), 100);
+    QCOMPARE(model.getFilteredListReference()->at(model.getFilteredIndex(0)).ID, 50u);
+
+    QSignalSpy resets(&model, SIGNAL(modelReset()));
+    QSignalSpy removes(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy inserts(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+
+    /* until the refresh the view still shows the evicted rows at the top */
+    model.addFrames(makeFrames(150, 30));
+    QCOMPARE(model.rowCount(), 100);
+    QVERIFY(model.getFilteredIndex(0) < 0);
+    QVERIFY(!model.data(model.index(0, 0), Qt::DisplayRole).isValid());
+    QCOMPARE(model.getFilteredListReference()->at(model.getFilteredIndex(30)).ID, 80u);
+
+    model.sendBulkRefresh();
+    QCOMPARE(model.rowCount(), 100);
+    QCOMPARE(model.getFilteredListReference()->at(model.getFilteredIndex(0)).ID, 80u);
+    QCOMPARE(resets.count(), 0);
+    QCOMPARE(removes.count(), 1);
+    QCOMPARE(removes.at(0).at(1).toInt(), 0);
+    QCOMPARE(removes.at(0).at(2).toInt(), 29);
+    QCOMPARE(inserts.count(), 1);
+    QCOMPARE(inserts.at(0).at(1).toInt(), 70);
+    QCOMPARE(inserts.at(0).at(2).toInt(), 99);
+}
+
+
+void TestCANFrameModel::tickCost_data()
+{
+    QTest::addColumn<int>("rate");
+
+    QTest::newRow("1k frames/s")    << 1000;
+    QTest::newRow("10k frames/s")   << 10000;
+    QTest::newRow("50k frames/s")   << 50000;
+}
+
+
+/* GUI thread time of one 250ms refresh tick of the main window, with a view attached */
+void TestCANFrameModel::tickCost()
+{
+    QFETCH(int, rate);
+    CANFrameModel model;
+    QTableView view;
+    int tick = rate / 4;
+    int next = 0;
+
+    view.setModel(&model);
+    view.resize(800, 600);
+    view.show();
+
+    /* a few seconds of traffic already in the view */
+    model.addFrames(makeFrames(next, rate * 5));
+    next += rate * 5;
+    model.sendBulkRefresh();
+    QCoreApplication::processEvents();
+
+    QBENCHMARK {
+        model.addFrames(makeFrames(next, tick));
+        next += tick;
+        model.sendBulkRefresh();
+        view.scrollToBottom();
+        QCoreApplication::processEvents();
+    }
+    QCOMPARE(model.rowCount(), next);
+}
+
+
+void TestCANFrameModel::timeSync()
+{
+    CANFrameModel model;
+
+    /* IDs 0 to 0x7FF, one frame every 100us */
+    model.addFrames(makeFrames(0, 10000));
+    model.sendBulkRefresh();
+
+    QCOMPARE(model.getIndexFromTimeID(0x10, 0.5), 4112);
+    QCOMPARE(model.getIndexFromTimeID(0x10, 0.0001), -1);
+    QCOMPARE(model.getIndexFromTimeID(0x7FF, 1.0), 8191);
+    QCOMPARE(model.getIndexFromTimeID(0x1234, 1.0), -1);
+    QCOMPARE(model.getRowFromTimeID(0x10, 0.5), 4112);
+
+    /* a hidden ID falls back on the last shown frame at that time */
+    model.setFilterState(0x10, false);
+    QCOMPARE(model.getIndexFromTimeID(0x10, 0.5), 4112);
+    QCOMPARE(model.getRowFromTimeID(0x10, 0.5), 5000 - 3);
+}
+
+
+void TestCANFrameModel::normalizeTiming()
+{
+    CANFrameModel model;
+    QVector<CANFrame> frames = makeFrames(5000, 1000);
+
+    model.addFrames(frames);
+    model.sendBulkRefresh();
+    QVERIFY(!model.isTimingNormalized());
+
+    model.normalizeTiming();
+    QVERIFY(model.isTimingNormalized());
+    QCOMPARE(model.getListReference()->at(0).timestamp, (uint64_t) 0);
+    QCOMPARE(model.getFilteredListReference()->at(999).timestamp, frames.last().timestamp - frames.first().timestamp);
+    /* time sync takes the times as shown */
+    QCOMPARE(model.getIndexFromTimeID(frames.at(500).ID, 0.05), 500);
+
+    /* frames coming in afterwards are shown relative as well */
+    model.addFrames(makeFrames(6000, 1));
+    QCOMPARE(model.getListReference()->last().timestamp, (uint64_t) 100000);
+
+    model.restoreTiming();
+    QVERIFY(!model.isTimingNormalized());
+    QCOMPARE(model.getListReference()->at(0).timestamp, frames.first().timestamp);
+}
+
+
+void TestCANFrameModel::batchInsert_data()
+{
+    QTest::addColumn<bool>("batch");
+
+    QTest::newRow("addFrame")   << false;
+    QTest::newRow("addFrames")  << true;
+}
+
+
+/* ingest cost of a second of 50k frames/s traffic, in batches like the connections send them */
+void TestCANFrameModel::batchInsert()
+{
+    QFETCH(bool, batch);
+    QVector<QVector<CANFrame>> batches;
+    for(int i=0 ; i<50000 ; i+=100)
+        batches.append(makeFrames(i, 100));
+
+    QBENCHMARK {
+        CANFrameModel model;
+        foreach(const QVector<CANFrame>& frames, batches) {
+            if(batch)
+                model.addFrames(frames);
+            else
+                foreach(const CANFrame& frame, frames)
+                    model.addFrame(frame, false);
+        }
+        QCOMPARE(model.totalFrameCount(), 50000);
+    }
+}
+
+
+void TestCANFrameModel::renderedRows()
+{
+    CANFrameModel model;
+    QVector<CANFrame> frames = makeFrames(0x1F0, 20);
+
+    model.addFrames(frames);
+    model.sendBulkRefresh();
+
+    /* same text as the byte by byte formatting */
+    for(int i=0 ; i<256 ; i++) {
+        unsigned char byte = i;
+        QCOMPARE(Utility::formatBytes(&byte, 1), Utility::formatNumber(byte) + " ");
+    }
+
+    const CANFrame& frame = frames.at(15);
+    QString expected;
+    for(int i=0 ; i<frame.len ; i++)
+        expected += Utility::formatNumber(frame.data[i]) + " ";
+    QCOMPARE(model.data(model.index(15, 6), Qt::DisplayRole).toString(), expected);
+    QCOMPARE(model.data(model.index(15, 1), Qt::DisplayRole).toString(), Utility::formatNumber(frame.ID));
+    QCOMPARE(model.data(model.index(15, 6), CANFrameModel::BytesRole).toByteArray(),
+             QByteArray((const char*) frame.data, frame.len));
+    QVERIFY(!model.data(model.index(15, 5), CANFrameModel::BytesRole).isValid());
+
+    /* cached rows follow the settings */
+    model.setHexMode(false);
+    QCOMPARE(model.data(model.index(15, 1), Qt::DisplayRole).toString(), QString::number(frame.ID));
+    model.setHexMode(true);
+    QCOMPARE(model.data(model.index(15, 1), Qt::DisplayRole).toString(), Utility::formatNumber(frame.ID));
+}
+
+
+void TestCANFrameModel::paint_data()
+{
+    QTest::addColumn<bool>("delegate");
+
+    QTest::newRow("QStyledItemDelegate")  << false;
+    QTest::newRow("FrameDataDelegate")    << true;
+}
+
+
+/* repaint of a full table, like while scrolling */
+void TestCANFrameModel::paint()
+{
+    QFETCH(bool, delegate);
+    CANFrameModel model;
+    QTableView view;
+
+    view.setModel(&model);
+    if(delegate)
+        view.setItemDelegateForColumn(6, new FrameDataDelegate(&view));
+    view.resize(800, 1000);
+    view.show();
+    model.addFrames(makeFrames(0, 100000));
+    model.sendBulkRefresh();
+    QCoreApplication::processEvents();
+
+    int row = 0;
+    QBENCHMARK {
+        view.scrollTo(model.index(row, 0), QAbstractItemView::PositionAtTop);
+        view.viewport()->repaint();
+        row = (row + 40) % 100000;
+    }
+}
+
+
+void TestCANFrameModel::idCatalog()
+{
+    CANFrameModel model;
+    model.setCaptureLimit(100, 0);
+
+    /* 4 IDs in turn, ID 0x103 only on bus 1 with a shorter length */
+    QVector<CANFrame> frames = makeFrames(0, 80);
+    for(int i=0 ; i<frames.count() ; i++) {
+        frames[i].ID = 0x100 + (i & 3);
+        if(frames[i].ID == 0x103) {
+            frames[i].bus = 1;
+            frames[i].len = 2;
+        }
+    }
+    model.addFrames(frames);
+    model.sendBulkRefresh();
+
+    const CANIdCatalog* catalog_p = model.getIdCatalog();
+    QCOMPARE(catalog_p->count(), 4);
+    QCOMPARE(catalog_p->at(0).id, 0x100u);
+    QCOMPARE(catalog_p->at(0).count, (quint64) 20);
+    QCOMPARE(catalog_p->at(0).firstSeen, (uint64_t) 0);
+    QCOMPARE(catalog_p->at(0).lastSeen, (uint64_t) 7600);
+    QCOMPARE(catalog_p->find(0x103)->busCounts.count(), 2);
+    QCOMPARE(catalog_p->find(0x103)->busCounts.at(1), (quint64) 20);
+    QCOMPARE(catalog_p->find(0x103)->dlcMask, 1u << 2);
+    QVERIFY(catalog_p->find(0x104) == NULL);
+
+    /* a new ID is appended, callers pick it up from the count they remembered */
+    QVector<CANFrame> more = makeFrames(80, 40);
+    for(int i=0 ; i<more.count() ; i++)
+        more[i].ID = (i < 30) ? 0x104 : 0x100;
+    model.addFrames(more);
+    model.sendBulkRefresh();
+    QCOMPARE(model.getIds(model.getListReference(), 4), QVector<quint32>() << 0x104);
+
+    /* 20 frames were evicted, the IDs that lost all their frames are not listed anymore */
+    QCOMPARE(catalog_p->at(0).count, (quint64) 15 + 10);
+    QCOMPARE(catalog_p->find(0x104)->count, (quint64) 30);
+    QCOMPARE(model.getIds(model.getListReference()).count(), 5);
+
+    /* the catalog keeps the stored times, getIdInfo() gives them as shown */
+    CANIdInfo info;
+    model.normalizeTiming();
+    QVERIFY(model.getIdInfo(0x100, &info));
+    QCOMPARE(info.firstSeen, (uint64_t) 0);
+    QCOMPARE(info.lastSeen, (uint64_t) 11900 - 2000);
+    QCOMPARE(catalog_p->at(0).lastSeen, (uint64_t) 11900);
+    QVERIFY(!model.getIdInfo(0x105, &info));
+    model.restoreTiming();
+
+    QVector<CANFrame> flood = makeFrames(120, 100);
+    for(int i=0 ; i<flood.count() ; i++)
+        flood[i].ID = 0x104;
+    model.addFrames(flood);
+    model.sendBulkRefresh();
+    QCOMPARE(catalog_p->count(), 5);
+    QCOMPARE(catalog_p->find(0x100)->count, (quint64) 0);
+    QCOMPARE(model.getIds(model.getListReference()), QVector<quint32>() << 0x104);
+
+    /* the filtered list leaves out the hidden IDs */
+    model.setFilterState(0x104, false);
+    QVERIFY(model.getIds(model.getFilteredListReference()).isEmpty());
+
+    /* shown again later, the filtered list picks it up whatever was remembered */
+    model.setFilterState(0x104, true);
+    QCOMPARE(model.getIds(model.getFilteredListReference(), catalog_p->count()), QVector<quint32>() << 0x104);
+
+    model.clearFrames();
+    QCOMPARE(catalog_p->count(), 0);
+
+    /* in overwrite mode a replaced frame leaves the catalog */
+    model.setOverwriteMode(true);
+    QVector<CANFrame> dups = makeFrames(0, 10);
+    for(int i=0 ; i<dups.count() ; i++)
+        dups[i].ID = 0x100;
+    model.addFrames(dups);
+    QCOMPARE(catalog_p->find(0x100)->count, (quint64) 1);
+    QCOMPARE(catalog_p->find(0x100)->lastSeen, (uint64_t) 900);
+    model.setOverwriteMode(false);
+}
+
+
+/* bit 2 of byte 3 flips every 2 frames of each ID, the IDs come back every 2048 frames */
+static QVector<CANFrame> makeToggles(int pFirst, int pCount)
+{
+    QVector<CANFrame> frames = makeFrames(pFirst, pCount);
+    for(int i=0 ; i<pCount ; i++)
+        frames[i].data[3] = (((pFirst + i) >> 12) & 1) << 2;
+    return frames;
+}
+
+static int countToggles(const QVector<CANFrame>& pFrames, quint32 pHiddenId)
+{
+    QHash<quint32, unsigned char> last;
+    int count = 0;
+    foreach(const CANFrame& frame, pFrames) {
+        if(last.contains(frame.ID) && ((last[frame.ID] ^ frame.data[3]) & 0x04) && frame.ID != pHiddenId)
+            count++;
+        last.insert(frame.ID, frame.data[3]);
+    }
+    return count;
+}
+
+void TestCANFrameModel::query()
+{
+    CANFrameModel model;
+    QVector<CANFrame> frames = makeToggles(0, 250000);
+    QString error;
+
+    model.addFrames(frames);
+    model.sendBulkRefresh();
+    QCOMPARE(model.rowCount(), 250000);
+
+    QVERIFY(!model.setQuery("b3.2 ==", &error));
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(model.rowCount(), 250000);
+
+    /* large captures are filtered in parallel, the chunks are stitched for the first frame of each ID */
+    QVERIFY(model.setQuery("b3.2 toggled", &error));
+    QTRY_COMPARE(model.rowCount(), countToggles(frames, ~0u));
+    QCOMPARE(model.getQuery(), QString("b3.2 toggled"));
+
+    /* new frames are compared to the last frame of their ID in the capture */
+    QVector<CANFrame> more = makeToggles(250000, 8192);
+    model.addFrames(more);
+    model.sendBulkRefresh();
+    frames += more;
+    QCOMPARE(model.rowCount(), countToggles(frames, ~0u));
+
+    /* the per ID filters still apply */
+    model.setFilterState(0x10, false);
+    QTRY_COMPARE(model.rowCount(), countToggles(frames, 0x10));
+
+    int shown = 0;
+    foreach(const CANFrame& frame, frames)
+        shown += (frame.ID != 0x10);
+    QVERIFY(model.setQuery("", &error));
+    QTRY_COMPARE(model.rowCount(), shown);
+}
+
+/* a query on a signal is compiled again when the DBC files change, and dropped once the signal is gone */
+void TestCANFrameModel::queryDbcChange()
+{
+    DBCHandler* dbc = DBCHandler::getReference();
+    dbc->removeAllFiles();
+    DBCFile* file = dbc->getFileByIdx(dbc->createBlankFile() - 1);
+    file->setAssocBus(-1);
+    DBC_MESSAGE msg;
+    msg.ID = 0x105;
+    msg.name = "Engine";
+    msg.len = 8;
+    msg.sender = NULL;
+    msg.multiplexorSignal = NULL;
+    file->messageHandler->addMessage(msg);
+    DBC_SIGNAL sig;
+    sig.name = "Counter";
+    sig.startBit = 0;
+    sig.signalSize = 8;
+    sig.intelByteOrder = true;
+    sig.valType = UNSIGNED_INT;
+    sig.factor = 1;
+    sig.bias = 0;
+    sig.isMultiplexor = false;
+    sig.isMultiplexed = false;
+    sig.multiplexValue = 0;
+    sig.receiver = NULL;
+    sig.parentMessage = file->messageHandler->findMsgByID(0x105);
+    sig.parentMessage->sigHandler->addSignal(sig);
+
+    CANFrameModel model;
+    QSignalSpy failures(&model, SIGNAL(queryFailed(QString)));
+    model.addFrames(makeFrames(0, 20480));
+    model.sendBulkRefresh();
+    QString error;
+    QVERIFY(model.setQuery("Counter < 0x80", &error));
+    /* 0x105 comes back every 2048 frames, byte 0 is the low byte of the frame number */
+    QCOMPARE(model.rowCount(), 10);
+
+    /* decoded rows are formatted once, until the DBC files change */
+    model.setInterpetMode(true);
+    QVERIFY(model.data(model.index(0, 6), Qt::DisplayRole).toString().contains("Engine"));
+    sig.parentMessage->name = "Motor";
+    model.sendBulkRefresh();
+    QVERIFY(model.data(model.index(0, 6), Qt::DisplayRole).toString().contains("Engine"));
+    dbc->notifyFilesChanged();
+    QVERIFY(model.data(model.index(0, 6), Qt::DisplayRole).toString().contains("Motor"));
+    model.setInterpetMode(false);
+
+    dbc->createBlankFile();
+    QCOMPARE(model.getQuery(), QString("Counter < 0x80"));
+    QCOMPARE(model.rowCount(), 10);
+    QCOMPARE(failures.count(), 0);
+
+    dbc->removeAllFiles();
+    QCOMPARE(failures.count(), 1);
+    QVERIFY(model.getQuery().isEmpty());
+    QCOMPARE(model.rowCount(), 20480);
+}
+
+void TestCANFrameModel::snapshot()
+{
+    CANFrameModel model;
+    model.setCaptureLimit(250000, 0);
+    model.addFrames(makeFrames(0, 250000));
+    model.sendBulkRefresh();
+    CANFrameSnapshot before = model.getSnapshot();
+
+    /* the parallel refresh reads a snapshot, evictions go on while it runs */
+    model.setFilterState(0x10, false);
+    model.addFrames(makeFrames(250000, 100000));
+    model.sendBulkRefresh();
+
+    int shown = 0;
+    for(int i=100000 ; i<350000 ; i++)
+        shown += ((i & 0x7FF) != 0x10);
+    QTRY_COMPARE(model.rowCount(), shown);
+    QCOMPARE(model.getFilteredListReference()->first().timestamp, (uint64_t) 100000 * 100);
+    QCOMPARE(model.getFilteredListReference()->last().timestamp, (uint64_t) 349999 * 100);
+
+    /* snapshots stay as they were taken, even across a clear */
+    CANFrameSnapshot filtered = model.getSnapshot(true);
+    model.clearFrames();
+    QCOMPARE(before.count(), 250000);
+    QCOMPARE(before.first().timestamp, (uint64_t) 0);
+    QCOMPARE(before.last().timestamp, (uint64_t) 249999 * 100);
+    QCOMPARE(filtered.count(), shown);
+    QCOMPARE(filtered.sourceIndex(0), 0);
+    QCOMPARE(filtered.at(0x10).ID, (uint32_t) ((100000 + 0x10) & 0x7FF));
+}
@@ -0,0 +1,28 @@
+#ifndef TST_CANFRAMEMODEL_H
+#define TST_CANFRAMEMODEL_H
+
+#include <QObject>
+
+class TestCANFrameModel: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void incrementalInsert();
+    void evictedRows();
+    void tickCost_data();
+    void tickCost();
+    void timeSync();
+    void normalizeTiming();
+    void batchInsert_data();
+    void batchInsert();
+    void renderedRows();
+    void paint_data();
+    void paint();
+    void idCatalog();
+    void query();
+    void queryDbcChange();
+    void snapshot();
+};
+
+#endif // TST_CANFRAMEMODEL_H
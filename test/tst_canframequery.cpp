@@ -0,0 +1,313 @@
+#include <QtTest>
+
+#include "canframequery.h"
+#include "canframestore.h"
+#include "dbc/dbchandler.h"
+#include "tst_canframequery.h"
+
+
+/* mixed traffic: standard and extended IDs, random lengths, both directions, 3 buses */
+void TestCANFrameQuery::initTestCase()
+{
+    quint32 seed = 1234;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 8); };
+
+    mRecs.clear();
+    for(int i=0 ; i<50000 ; i++) {
+        CANFrameRecord rec;
+        rec.timestamp  = 1000000 + (uint64_t) i * 100;
+        rec.ID         = (i % 7 == 0) ? 0x18DAF100 + rnd() % 3 : 0x100 + rnd() % 40;
+        rec.len        = rnd() % 9;
+        rec.extended   = rec.ID > 0x7FF;
+        rec.isReceived = rnd() & 1;
+        rec.bus        = rnd() % 3;
+        for(int j=0 ; j<8 ; j++)
+            rec.data[j] = rnd();
+        mRecs.append(rec);
+    }
+}
+
+
+/*
+ * Runs a query over all the records. Chunked, the records are split as a parallel refresh does
+ * and the first frame of each ID in a chunk is resolved afterwards against the chunks before.
+ */
+int TestCANFrameQuery::pCount(const QString& pQuery, bool pChunked, DBCHandler* pDbc_p)
+{
+    CANFrameQuery query;
+    QString error;
+    if(!query.compile(pQuery, pDbc_p, &error))
+        return -1;
+
+    QVector<quint32> rows;
+    QHash<quint32, CANFrameRecord> history;
+    if(!pChunked) {
+        query.filter(mRecs.constData(), mRecs.count(), 0, &history, &rows, NULL);
+        return rows.count();
+    }
+
+    for(int first=0 ; first<mRecs.count() ; first+=1000) {
+        QVector<quint32> pending;
+        QHash<quint32, CANFrameRecord> last;
+        query.filter(mRecs.constData() + first, 1000, first, &last, &rows, &pending);
+        foreach(quint32 idx, pending) {
+            const CANFrameRecord& rec = mRecs.at(idx);
+            if(query.matches(rec, history.contains(rec.ID) ? &history[rec.ID] : NULL))
+                rows.append(idx);
+        }
+        for(QHash<quint32, CANFrameRecord>::const_iterator it=last.constBegin() ; it!=last.constEnd() ; ++it)
+            history.insert(it.key(), it.value());
+    }
+    return rows.count();
+}
+
+
+void TestCANFrameQuery::fields_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<int>("field");
+
+    QTest::newRow("id range")   << QString("id in 0x100-0x10F") << 0;
+    QTest::newRow("id mask")    << QString("id & 0x7F0 == 0x110 && bus == 1") << 1;
+    QTest::newRow("flags")      << QString("ext || rx") << 2;
+    QTest::newRow("not")        << QString("not (tx and std)") << 3;
+    QTest::newRow("byte")       << QString("b3 != 5") << 4;
+    QTest::newRow("bit")        << QString("b3.2 == 1 && dlc >= 4") << 5;
+    QTest::newRow("byte mask")  << QString("b0 & 0xF0 < 0x30") << 6;
+    QTest::newRow("time")       << QString("time in 1.5-2") << 7;
+    QTest::newRow("never")      << QString("len < 0 || len in 5-2") << 8;
+}
+
+void TestCANFrameQuery::fields()
+{
+    QFETCH(QString, query);
+    QFETCH(int, field);
+
+    int expected = 0;
+    foreach(const CANFrameRecord& rec, mRecs) {
+        bool match = false;
+        switch(field) {
+        case 0: match = rec.ID >= 0x100 && rec.ID <= 0x10F; break;
+        case 1: match = (rec.ID & 0x7F0) == 0x110 && rec.bus == 1; break;
+        case 2: match = rec.extended || rec.isReceived; break;
+        case 3: match = rec.isReceived || rec.extended; break;
+        /* bytes past the length never match */
+        case 4: match = rec.len > 3 && rec.data[3] != 5; break;
+        case 5: match = rec.len >= 4 && (rec.data[3] & 0x04); break;
+        case 6: match = rec.len > 0 && (rec.data[0] & 0xF0) < 0x30; break;
+        case 7: match = rec.timestamp >= 1500000 && rec.timestamp <= 2000000; break;
+        case 8: match = false; break;
+        }
+        expected += match;
+    }
+
+    QCOMPARE(pCount(query, false), expected);
+    QCOMPARE(pCount(query, true), expected);
+}
+
+
+void TestCANFrameQuery::toggled()
+{
+    QHash<quint32, CANFrameRecord> last;
+    int expected = 0;
+    foreach(const CANFrameRecord& rec, mRecs) {
+        if(last.contains(rec.ID)) {
+            const CANFrameRecord& prev = last[rec.ID];
+            if(rec.len > 3 && prev.len > 3 && ((rec.data[3] ^ prev.data[3]) & 0x04))
+                expected++;
+        }
+        last.insert(rec.ID, rec);
+    }
+
+    QCOMPARE(pCount("b3.2 toggled", false), expected);
+    QCOMPARE(pCount("b3.2 toggled", true), expected);
+    QCOMPARE(pCount("b3 & 0x04 changed", true), expected);
+
+    /* the time offset is applied before the comparison */
+    CANFrameQuery query;
+    QVERIFY(query.compile("time < 1", NULL, NULL));
+    QVERIFY(query.usesTime());
+    QVERIFY(!query.matches(mRecs.at(0), NULL));
+    query.setTimeOffset(mRecs.at(0).timestamp);
+    QVERIFY(query.matches(mRecs.at(0), NULL));
+}
+
+
+void TestCANFrameQuery::errors_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("unknown signal")     << QString("EngineRPM > 3000");
+    QTest::newRow("no value")           << QString("id >");
+    QTest::newRow("extra")              << QString("id == 1 )");
+    QTest::newRow("parenthesis")        << QString("(id == 1");
+    QTest::newRow("time changed")       << QString("time changed");
+    QTest::newRow("character")          << QString("id $ 3");
+    QTest::newRow("time mask")          << QString("time & 3 == 1");
+    QTest::newRow("range")              << QString("id in 0x100");
+}
+
+void TestCANFrameQuery::errors()
+{
+    QFETCH(QString, query);
+
+    CANFrameQuery compiled;
+    QString error;
+    QVERIFY(compiled.compile("bus == 1", NULL, &error));
+    QVERIFY(!compiled.compile(query, NULL, &error));
+    QVERIFY(!error.isEmpty());
+    /* the previous program stays */
+    QCOMPARE(compiled.text(), QString("bus == 1"));
+}
+
+
+/*
+ * Loads a DBC file with message 0x105: EngineRPM in bytes 1-2 and, multiplexed on the low
+ * nibble of byte 0, a signed ModeVal in byte 3 when the nibble is 2
+ */
+static DBC_MESSAGE* loadEngineDbc(DBCHandler* pDbc_p)
+{
+    pDbc_p->removeAllFiles();
+    DBCFile* file = pDbc_p->getFileByIdx(pDbc_p->createBlankFile() - 1);
+    file->setAssocBus(-1);
+
+    DBC_MESSAGE msg;
+    msg.ID = 0x105;
+    msg.name = "Engine";
+    msg.len = 8;
+    msg.sender = NULL;
+    msg.multiplexorSignal = NULL;
+    file->messageHandler->addMessage(msg);
+    DBC_MESSAGE* msg_p = file->messageHandler->findMsgByID(0x105);
+
+    DBC_SIGNAL sig;
+    sig.receiver = NULL;
+    sig.parentMessage = msg_p;
+    sig.min = 0;
+    sig.max = 0;
+    sig.isMultiplexor = false;
+    sig.isMultiplexed = false;
+    sig.multiplexValue = 0;
+    sig.intelByteOrder = true;
+
+    sig.name = "EngineRPM";
+    sig.startBit = 8;
+    sig.signalSize = 16;
+    sig.valType = UNSIGNED_INT;
+    sig.factor = 0.25;
+    sig.bias = 0;
+    msg_p->sigHandler->addSignal(sig);
+
+    sig.name = "Mode";
+    sig.startBit = 0;
+    sig.signalSize = 4;
+    sig.factor = 1;
+    sig.isMultiplexor = true;
+    msg_p->sigHandler->addSignal(sig);
+    msg_p->multiplexorSignal = msg_p->sigHandler->findSignalByName("Mode");
+
+    sig.name = "ModeVal";
+    sig.startBit = 24;
+    sig.signalSize = 8;
+    sig.valType = SIGNED_INT;
+    sig.factor = -1.5;
+    sig.bias = 2;
+    sig.isMultiplexor = false;
+    sig.isMultiplexed = true;
+    sig.multiplexValue = 2;
+    msg_p->sigHandler->addSignal(sig);
+
+    return msg_p;
+}
+
+
+/* signals decode as DBC_SIGNAL::processAsDouble() does, and keep working once the DBC is gone */
+void TestCANFrameQuery::dbcSignals()
+{
+    DBCHandler* dbc = DBCHandler::getReference();
+    DBC_MESSAGE* msg_p = loadEngineDbc(dbc);
+    DBC_SIGNAL* rpm_p = msg_p->sigHandler->findSignalByName("EngineRPM");
+    DBC_SIGNAL* modeVal_p = msg_p->sigHandler->findSignalByName("ModeVal");
+
+    int rpmCount = 0;
+    int modeCount = 0;
+    int eitherCount = 0;
+    int rpmChanged = 0;
+    QHash<quint32, CANFrameRecord> last;
+    foreach(const CANFrameRecord& rec, mRecs) {
+        double val, prevVal;
+        if(rec.ID != 0x105)
+            continue;
+        bool rpm = rpm_p->processAsDouble(rec.toFrame(), val) && val > 3000;
+        bool mode = modeVal_p->processAsDouble(rec.toFrame(), val) && val <= -10;
+        rpmCount += rpm;
+        modeCount += mode;
+        eitherCount += (rpm || mode);
+        if(last.contains(rec.ID) && rpm_p->processAsDouble(rec.toFrame(), val)
+                && rpm_p->processAsDouble(last[rec.ID].toFrame(), prevVal) && val != prevVal)
+            rpmChanged++;
+        last.insert(rec.ID, rec);
+    }
+    QVERIFY(rpmCount > 0);
+    QVERIFY(modeCount > 0);
+
+    QCOMPARE(pCount("EngineRPM > 3000", false, dbc), rpmCount);
+    QCOMPARE(pCount("EngineRPM > 3000", true, dbc), rpmCount);
+    QCOMPARE(pCount("ModeVal <= -10", true, dbc), modeCount);
+    QCOMPARE(pCount("EngineRPM changed", true, dbc), rpmChanged);
+
+    /* the compiled query holds its own copy of the signals */
+    CANFrameQuery query;
+    QVERIFY(query.compile("EngineRPM > 3000 || ModeVal <= -10", dbc, NULL));
+    dbc->removeAllFiles();
+    QVector<quint32> rows;
+    query.filter(mRecs.constData(), mRecs.count(), 0, NULL, &rows, NULL);
+    QCOMPARE(rows.count(), eitherCount);
+
+    QString error;
+    QVERIFY(!query.compile(query.text(), dbc, &error));
+    QVERIFY(error.contains("EngineRPM"));
+}
+
+
+void TestCANFrameQuery::throughput_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("id range")   << QString("id in 0x100-0x11F && bus == 1");
+    QTest::newRow("bytes")      << QString("b0 & 0xF0 == 0x20 && len >= 4 || ext");
+    QTest::newRow("toggled")    << QString("b3.2 toggled");
+    QTest::newRow("signal")     << QString("EngineRPM > 3000");
+}
+
+/*
+ * 1M frames through a single thread, the way the model runs a query over the runs of its store.
+ * The refresh spreads this over all cores. Reported by QBENCHMARK, nothing is asserted on time.
+ */
+void TestCANFrameQuery::throughput()
+{
+    QFETCH(QString, query);
+    const int frames = 1000000;
+
+    DBCHandler* dbc = DBCHandler::getReference();
+    loadEngineDbc(dbc);
+    CANFrameQuery compiled;
+    QVERIFY(compiled.compile(query, dbc, NULL));
+    dbc->removeAllFiles();
+
+    CANFrameStore store;
+    for(int i=0 ; i<frames ; i++)
+        store.append(mRecs.at(i % mRecs.count()));
+
+    QVector<quint32> rows;
+    QBENCHMARK {
+        rows.clear();
+        QHash<quint32, CANFrameRecord> history;
+        int len;
+        for(int i=0 ; i<frames ; i+=len) {
+            const CANFrameRecord* recs_p = store.contiguous(i, &len);
+            compiled.filter(recs_p, len, i, &history, &rows, NULL);
+        }
+    }
+    QVERIFY(rows.count() > 0);
+}
@@ -0,0 +1,30 @@
+#ifndef TST_CANFRAMEQUERY_H
+#define TST_CANFRAMEQUERY_H
+
+#include <QObject>
+#include <QVector>
+#include "can_structs.h"
+
+class DBCHandler;
+
+class TestCANFrameQuery: public QObject
+{
+    Q_OBJECT
+private:
+    QVector<CANFrameRecord> mRecs;
+
+    int pCount(const QString& pQuery, bool pChunked, DBCHandler* pDbc_p = NULL);
+
+private slots:
+    void initTestCase();
+    void fields_data();
+    void fields();
+    void toggled();
+    void errors_data();
+    void errors();
+    void dbcSignals();
+    void throughput_data();
+    void throughput();
+};
+
+#endif // TST_CANFRAMEQUERY_H
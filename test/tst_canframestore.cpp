@@ -0,0 +1,448 @@
+#include <QtTest>
+#include <QtConcurrent/qtconcurrentrun.h>
+
+#include "canframestore.h"
+#include "canframetimeindex.h"
+#include "mappedfileallocator.h"
+#include "tst_canframestore.h"
+
+
+static CANFrame makeFrame(int pIdx)
+{
+    CANFrame frame;
+    frame.timestamp  = (uint64_t) pIdx * 250;
+    frame.ID         = (pIdx & 1) ? (0x18DA0000u + pIdx) & 0x1FFFFFFF : pIdx & 0x7FF;
+    frame.extended   = pIdx & 1;
+    frame.isReceived = !(pIdx & 2);
+    frame.bus        = (pIdx >> 2) & 3;
+    frame.len        = pIdx % 9;
+    for(int i=0 ; i<8 ; i++)
+        frame.data[i] = (unsigned char) (pIdx + i);
+    return frame;
+}
+
+
+void TestCANFrameStore::roundTrip()
+{
+    CANFrameStore store;
+
+    for(int i=0 ; i<1000 ; i++)
+        store.append(makeFrame(i));
+
+    QCOMPARE(store.count(), 1000);
+    for(int i=0 ; i<store.count() ; i++) {
+        CANFrame expected = makeFrame(i);
+        CANFrame frame = store.at(i);
+        QCOMPARE(frame.timestamp, expected.timestamp);
+        QCOMPARE(frame.ID, expected.ID);
+        QCOMPARE(frame.extended, expected.extended);
+        QCOMPARE(frame.isReceived, expected.isReceived);
+        QCOMPARE(frame.bus, expected.bus);
+        QCOMPARE(frame.len, expected.len);
+        QVERIFY(!memcmp(frame.data, expected.data, 8));
+    }
+
+    store.setTimestamp(10, 42);
+    QCOMPARE(store.at(10).timestamp, (uint64_t) 42);
+    store.replace(11, makeFrame(500));
+    QCOMPARE(store.at(11).ID, makeFrame(500).ID);
+    store.removeLast();
+    QCOMPARE(store.last().ID, makeFrame(998).ID);
+}
+
+
+void TestCANFrameStore::indexView()
+{
+    CANFrameStore store;
+    CANFrameIndexView view(&store);
+
+    for(int i=0 ; i<1000 ; i++) {
+        store.append(makeFrame(i));
+        if(i % 3 == 0)
+            view.append(i);
+    }
+
+    QCOMPARE(view.count(), 334);
+    for(int i=0 ; i<view.count() ; i++) {
+        QCOMPARE(view.sourceIndex(i), i * 3);
+        QCOMPARE(view.at(i).ID, makeFrame(i * 3).ID);
+        QCOMPARE(view.at(i).timestamp, makeFrame(i * 3).timestamp);
+    }
+
+    QCOMPARE(view.rowOf(300), 100);
+    QCOMPARE(view.rowOf(301), -1);
+    QCOMPARE(view.rowOf(999), 333);
+
+    /* frames are shared with the store */
+    store.setTimestamp(3, 42);
+    QCOMPARE(view.at(1).timestamp, (uint64_t) 42);
+
+    CANFrameIndexView other(&store);
+    other.append(999);
+    other.append(0);
+    view.swap(other);
+    QCOMPARE(other.count(), 334);
+    QCOMPARE(view.count(), 2);
+    QCOMPARE(view.first().ID, makeFrame(999).ID);
+    QCOMPARE(view.last().ID, makeFrame(0).ID);
+}
+
+
+void TestCANFrameStore::segmentedVector()
+{
+    SegmentedVector<quint32> vect;
+
+    vect.append(0);
+    const quint32* first_p = &vect.at(0);
+    for(int i=1 ; i<3*STORE_BLOCK_SIZE+1 ; i++)
+        vect.append(i);
+
+    /* growing never moves elements */
+    QVERIFY(first_p == &vect.at(0));
+    QCOMPARE(vect.count(), 3*STORE_BLOCK_SIZE+1);
+    QCOMPARE(vect.memoryUsage(), (qint64) 4*STORE_BLOCK_SIZE*sizeof(quint32));
+    for(int i=0 ; i<vect.count() ; i++)
+        QCOMPARE(vect.at(i), (quint32) i);
+
+    vect.removeLast();
+    vect.squeeze();
+    QCOMPARE(vect.memoryUsage(), (qint64) 3*STORE_BLOCK_SIZE*sizeof(quint32));
+    vect.append(42);
+    QCOMPARE(vect.at(3*STORE_BLOCK_SIZE), (quint32) 42);
+
+    vect.clear();
+    QCOMPARE(vect.count(), 0);
+    QCOMPARE(vect.memoryUsage(), (qint64) 0);
+}
+
+
+void TestCANFrameStore::ringEviction()
+{
+    CANFrameStore store;
+    CANFrameIndexView view(&store);
+    const int limit = 2*STORE_BLOCK_SIZE + 100;
+
+    /* keep the last "limit" frames, every 10th one is selected in the view */
+    for(int i=0 ; i<10*STORE_BLOCK_SIZE ; i++) {
+        store.append(makeFrame(i));
+        if(i % 10 == 0)
+            view.append(store.count() - 1);
+        if(store.count() > limit) {
+            store.removeFirst(store.count() - limit);
+            view.dropEvicted();
+        }
+    }
+
+    int first = 10*STORE_BLOCK_SIZE - limit;
+    QCOMPARE(store.count(), limit);
+    QCOMPARE(store.evictedCount(), (quint64) first);
+    QCOMPARE(store.first().timestamp, makeFrame(first).timestamp);
+    QCOMPARE(store.last().timestamp, makeFrame(10*STORE_BLOCK_SIZE - 1).timestamp);
+    /* evicted blocks are released, one spare is kept */
+    QVERIFY(store.memoryUsage() <= (qint64) 5*STORE_BLOCK_SIZE*24);
+
+    /* the view follows the moving window */
+    QVERIFY(view.count() > 0);
+    QVERIFY(makeFrame(first).timestamp <= view.first().timestamp);
+    for(int i=0 ; i<view.count() ; i++) {
+        int src = view.sourceIndex(i);
+        QVERIFY(src >= 0 && src < store.count());
+        QCOMPARE((src + first) % 10, 0);
+        QCOMPARE(view.at(i).timestamp, makeFrame(src + first).timestamp);
+    }
+
+    store.clear();
+    view.clear();
+    QCOMPARE(store.evictedCount(), (quint64) 0);
+}
+
+
+void TestCANFrameStore::contiguousRuns()
+{
+    CANFrameStore store;
+
+    for(int i=0 ; i<3*STORE_BLOCK_SIZE+5 ; i++)
+        store.append(makeFrame(i));
+    store.removeFirst(100);
+
+    /* runs end on block boundaries and cover the whole store */
+    int total = 0;
+    int runs = 0;
+    for(int i=0 ; i<store.count() ; ) {
+        int len;
+        const CANFrameRecord* rec_p = store.contiguous(i, &len);
+        QVERIFY(len >= 1);
+        for(int k=0 ; k<len ; k++)
+            QCOMPARE(rec_p[k].timestamp, makeFrame(i + k + 100).timestamp);
+        i += len;
+        total += len;
+        runs++;
+    }
+    QCOMPARE(total, store.count());
+    QCOMPARE(runs, 4);
+}
+
+
+void TestCANFrameStore::timeIndex()
+{
+    CANFrameStore store;
+    CANFrameTimeIndex index(&store);
+    quint32 seed = 7;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 8; };
+    uint64_t now = 1000;
+
+    /* reference answers, by scanning the store */
+    auto scanId = [&store](quint32 id, uint64_t t) {
+        int best = -1;
+        for(int i=0 ; i<store.count() ; i++)
+            if(store.record(i).ID == id && store.record(i).timestamp <= t) best = i;
+        return best;
+    };
+    auto scanTime = [&store](uint64_t t) {
+        uint64_t latest = 0;
+        for(int i=0 ; i<store.count() ; i++) {
+            latest = qMax(latest, store.record(i).timestamp);
+            if(latest > t) return i - 1;
+        }
+        return store.count() - 1;
+    };
+
+    /* bounded capture with a few frames of ID 7 going back in time */
+    for(int i=0 ; i<300000 ; i++) {
+        CANFrame frame = makeFrame(i);
+        frame.ID = rnd() % 50;
+        now += rnd() % 200;
+        frame.timestamp = (frame.ID == 7 && rnd() % 100 == 0) ? now - 5000 : now;
+        store.append(frame);
+        index.append(store.count() - 1);
+        if(store.count() > 70000)
+            store.removeFirst(store.count() - 70000);
+
+        if(i % 9973 == 0) {
+            for(int k=0 ; k<40 ; k++) {
+                uint64_t t = rnd() % (now + 2000);
+                quint32 id = rnd() % 52;
+                QCOMPARE(index.find(id, t), scanId(id, t));
+                QCOMPARE(index.findTime(t), scanTime(t));
+            }
+        }
+    }
+
+    index.clear();
+    QCOMPARE(index.find(3, now), -1);
+    index.rebuild();
+    QCOMPARE(index.find(3, now), scanId(3, now));
+}
+
+
+void TestCANFrameStore::timeOffset()
+{
+    CANFrameStore store;
+    CANFrameIndexView view(&store);
+
+    for(int i=0 ; i<100 ; i++) {
+        store.append(makeFrame(i + 1000));
+        view.append(i);
+    }
+
+    /* applied when frames are read, records keep the captured time */
+    store.setTimeOffset(makeFrame(1000).timestamp);
+    QCOMPARE(store.at(0).timestamp, (uint64_t) 0);
+    QCOMPARE(store.at(99).timestamp, makeFrame(1099).timestamp - makeFrame(1000).timestamp);
+    QCOMPARE(view.at(10).timestamp, store.at(10).timestamp);
+    QCOMPARE(store.record(0).timestamp, makeFrame(1000).timestamp);
+
+    store.setTimeOffset(0);
+    QCOMPARE(store.at(99).timestamp, makeFrame(1099).timestamp);
+}
+
+
+void TestCANFrameStore::spillToDisk()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QSharedPointer<MappedFileAllocator> alloc(new MappedFileAllocator(dir.path()));
+    QVERIFY(alloc->isValid());
+
+    CANFrameStore store;
+    CANFrameIndexView view(&store);
+    store.setAllocator(alloc);
+    view.setAllocator(alloc);
+
+    const int num = 4*STORE_BLOCK_SIZE + 10;
+    for(int i=0 ; i<num ; i++) {
+        store.append(makeFrame(i));
+        if(i & 1)
+            view.append(i);
+    }
+    QVERIFY(alloc->fileSize() >= (qint64) num * (qint64) sizeof(CANFrameRecord));
+
+    for(int i=0 ; i<num ; i += 997)
+        QCOMPARE(store.at(i).timestamp, makeFrame(i).timestamp);
+    QCOMPARE(view.count(), num / 2);
+    QCOMPARE(view.last().ID, makeFrame(num - 1).ID);
+
+    /* evicted blocks are given back and the file does not grow anymore */
+    store.removeFirst(3*STORE_BLOCK_SIZE);
+    view.dropEvicted();
+    qint64 size = alloc->fileSize();
+    for(int i=num ; i<num + 2*STORE_BLOCK_SIZE ; i++)
+        store.append(makeFrame(i));
+    QCOMPARE(alloc->fileSize(), size);
+    QCOMPARE(store.first().timestamp, makeFrame(3*STORE_BLOCK_SIZE).timestamp);
+    QCOMPARE(store.last().timestamp, makeFrame(num + 2*STORE_BLOCK_SIZE - 1).timestamp);
+
+    /* a snapshot keeps its blocks and the allocator after the store is done with them */
+    CANFrameSnapshot snap = store.snapshot();
+    store.setAllocator(QSharedPointer<BlockAllocator>());
+    view.setAllocator(QSharedPointer<BlockAllocator>());
+    alloc.clear();
+    QCOMPARE(store.count(), 0);
+    QCOMPARE(snap.count(), num - STORE_BLOCK_SIZE);
+    QCOMPARE(snap.at(0).timestamp, makeFrame(3*STORE_BLOCK_SIZE).timestamp);
+    QCOMPARE(snap.last().timestamp, makeFrame(num + 2*STORE_BLOCK_SIZE - 1).timestamp);
+}
+
+
+void TestCANFrameStore::snapshot()
+{
+    CANFrameStore store;
+    CANFrameIndexView view(&store);
+    const int num = 2*STORE_BLOCK_SIZE + 100;
+
+    for(int i=0 ; i<num ; i++) {
+        store.append(makeFrame(i));
+        if(i % 3 == 0)
+            view.append(i);
+    }
+    store.setTimeOffset(1000);
+
+    CANFrameSnapshot snap = store.snapshot();
+    CANFrameSnapshot viewSnap = view.snapshot();
+    QCOMPARE(snap.count(), num);
+    QCOMPARE(snap.evictedCount(), (quint64) 0);
+    QCOMPARE(viewSnap.count(), view.count());
+
+    /* nothing the store does afterwards shows through */
+    store.removeLast();
+    store.append(makeFrame(424242));
+    for(int i=num ; i<num + STORE_BLOCK_SIZE ; i++)
+        store.append(makeFrame(i));
+    store.replace(num - 5, makeFrame(999999));
+    store.setTimestamp(11, 5);
+    store.removeFirst(STORE_BLOCK_SIZE + 7);
+    view.dropEvicted();
+    store.setTimeOffset(0);
+
+    QCOMPARE(snap.count(), num);
+    for(int i=0 ; i<num ; i += 101) {
+        QCOMPARE(snap.record(i).ID, makeFrame(i).ID);
+        QCOMPARE(snap.at(i).timestamp, makeFrame(i).timestamp - 1000);
+    }
+    QCOMPARE(snap.record(num - 5).ID, makeFrame(num - 5).ID);
+    QCOMPARE(snap.record(11).timestamp, makeFrame(11).timestamp);
+    QCOMPARE(snap.last().ID, makeFrame(num - 1).ID);
+    QCOMPARE(viewSnap.at(5).ID, makeFrame(15).ID);
+    QCOMPARE(viewSnap.sourceIndex(viewSnap.count() - 1), ((num - 1) / 3) * 3);
+
+    /* the store saw its own changes */
+    const int evicted = STORE_BLOCK_SIZE + 7;
+    QCOMPARE(store.record(num - 5 - evicted).ID, makeFrame(999999).ID);
+    QCOMPARE(store.record(num - 1 - evicted).ID, makeFrame(424242).ID);
+    QCOMPARE(store.first().ID, makeFrame(evicted).ID);
+
+    /* the runs of a snapshot cover it */
+    int total = 0;
+    for(int i=0 ; i<snap.count() ; ) {
+        int len;
+        const CANFrameRecord* run_p = snap.contiguous(i, &len);
+        QCOMPARE(run_p[0].ID, makeFrame(i).ID);
+        total += len;
+        i += len;
+    }
+    QCOMPARE(total, num);
+
+    /* a copy of a snapshot outlives the store's clear */
+    CANFrameSnapshot copy = snap;
+    store.clear();
+    view.clear();
+    snap = CANFrameSnapshot();
+    QCOMPARE(snap.count(), 0);
+    QCOMPARE(copy.count(), num);
+    QCOMPARE(copy.record(num / 2).ID, makeFrame(num / 2).ID);
+}
+
+
+/* sums the IDs of a snapshot, the frames must be the ones the snapshot was taken on */
+static quint64 sumSnapshot(CANFrameSnapshot pSnap, int pFirst)
+{
+    quint64 sum = 0;
+    for(int i=0 ; i<pSnap.count() ; i++) {
+        if(pSnap.record(i).ID != makeFrame(pFirst + i).ID)
+            return 0;
+        sum += pSnap.record(i).ID;
+    }
+    return sum;
+}
+
+void TestCANFrameStore::snapshotThread()
+{
+    CANFrameStore store;
+    const int limit = 3*STORE_BLOCK_SIZE;
+    int next = 0;
+
+    for( ; next<limit ; next++)
+        store.append(makeFrame(next));
+
+    /* readers go through their snapshot while the store keeps growing and evicting as a ring */
+    for(int round=0 ; round<8 ; round++) {
+        int first = (int) store.evictedCount();
+        CANFrameSnapshot snap = store.snapshot();
+        quint64 expected = 0;
+        for(int i=0 ; i<snap.count() ; i++)
+            expected += makeFrame(first + i).ID;
+
+        QFuture<quint64> reader = QtConcurrent::run(sumSnapshot, snap, first);
+        snap = CANFrameSnapshot();
+        for(int i=0 ; i<STORE_BLOCK_SIZE ; i++) {
+            store.append(makeFrame(next++));
+            if(store.count() > limit)
+                store.removeFirst(store.count() - limit);
+        }
+        QCOMPARE(reader.result(), expected);
+    }
+    QCOMPARE(store.count(), limit);
+    QCOMPARE(store.first().ID, makeFrame(next - limit).ID);
+}
+
+
+void TestCANFrameStore::memoryUsage_data()
+{
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("1M")     << 1000000;
+    QTest::newRow("10M")    << 10000000;
+    /* needs about 1.2GB, only run on request */
+    if(qEnvironmentVariableIsSet("SAVVYCAN_BENCH_LARGE"))
+        QTest::newRow("50M")    << 50000000;
+}
+
+
+void TestCANFrameStore::memoryUsage()
+{
+    QFETCH(int, frames);
+    CANFrameStore store;
+
+    for(int i=0 ; i<frames ; i++)
+        store.append(makeFrame(i));
+
+    qint64 packed = store.memoryUsage();
+    qint64 plain = (qint64) frames * sizeof(CANFrame);
+    qDebug() << frames << "frames:" << packed / (1024*1024) << "MB stored,"
+             << plain / (1024*1024) << "MB as CANFrame";
+
+    /* at most one partly used block */
+    QVERIFY(packed <= (qint64) (frames + STORE_BLOCK_SIZE) * 24);
+    QVERIFY(packed < plain);
+    QCOMPARE(store.at(frames - 1).ID, makeFrame(frames - 1).ID);
+}
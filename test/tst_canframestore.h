@@ -0,0 +1,25 @@
+#ifndef TST_CANFRAMESTORE_H
+#define TST_CANFRAMESTORE_H
+
+#include <QObject>
+
+class TestCANFrameStore: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void indexView();
+    void segmentedVector();
+    void ringEviction();
+    void contiguousRuns();
+    void timeIndex();
+    void timeOffset();
+    void spillToDisk();
+    void snapshot();
+    void snapshotThread();
+    void memoryUsage_data();
+    void memoryUsage();
+};
+
+#endif // TST_CANFRAMESTORE_H
@@ -0,0 +1,104 @@
+#include <QtTest>
+
+#include "canidfilter.h"
+#include "tst_canidfilter.h"
+
+
+/* traffic looking like a vehicle bus: 300 IDs, standard and extended */
+void TestCANIdFilter::initTestCase()
+{
+    quint32 seed = 4321;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 8) & 0xFFFFFF; };
+    QVector<quint32> known;
+
+    for(int i=0 ; i<300 ; i++)
+        known.append((i & 1) ? (rnd() << 5 | (rnd() & 0x1F)) & 0x1FFFFFFF : rnd() & 0x7FF);
+    mIds.clear();
+    for(int i=0 ; i<100000 ; i++)
+        mIds.append(known.at(rnd() % known.count()));
+}
+
+
+void TestCANIdFilter::sameAsMap()
+{
+    CANIdFilter filter;
+    QMap<int, bool> map;
+    quint32 seed = 99;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 4); };
+
+    for(int i=0 ; i<20000 ; i++) {
+        quint32 id = (i & 1) ? rnd() & 0x1FFFFFFF : rnd() & 0x7FF;
+        bool shown = rnd() & 1;
+        filter.insert(id, shown);
+        map.insert(id, shown);
+    }
+
+    QCOMPARE(filter.count(), map.count());
+    QCOMPARE(*filter.asMap(), map);
+    for(QMap<int, bool>::const_iterator it = map.begin() ; it != map.end() ; ++it) {
+        QVERIFY(filter.contains(it.key()));
+        QCOMPARE(filter.isShown(it.key()), it.value());
+    }
+}
+
+
+void TestCANIdFilter::checkAndSetAll()
+{
+    CANIdFilter filter;
+    bool added;
+
+    QVERIFY(filter.check(0x123, true, &added));
+    QVERIFY(added);
+    QVERIFY(!filter.check(0x18DAF110, false, &added));
+    QVERIFY(added);
+    QVERIFY(!filter.check(0x18DAF110, true, &added));
+    QVERIFY(!added);
+    QVERIFY(!filter.isShown(0x7FF));
+    QVERIFY(!filter.contains(0x7FF));
+
+    filter.setAll(true);
+    QVERIFY(filter.isShown(0x18DAF110));
+    QVERIFY(filter.isShown(0x123));
+    QVERIFY(!filter.isShown(0x7FF));
+    QCOMPARE(filter.asMap()->count(), 2);
+
+    filter.setAll(false);
+    QVERIFY(!filter.isShown(0x123));
+    QCOMPARE(filter.asMap()->value(0x18DAF110, true), false);
+
+    filter.clear();
+    QCOMPARE(filter.count(), 0);
+    QVERIFY(!filter.contains(0x123));
+}
+
+
+void TestCANIdFilter::lookup_data()
+{
+    QTest::addColumn<bool>("map");
+
+    QTest::newRow("QMap")           << true;
+    QTest::newRow("CANIdFilter")    << false;
+}
+
+
+void TestCANIdFilter::lookup()
+{
+    QFETCH(bool, map);
+    QMap<int, bool> filterMap;
+    CANIdFilter filter;
+    int shown = 0;
+
+    QBENCHMARK {
+        for(int i=0 ; i<mIds.count() ; i++) {
+            quint32 id = mIds.at(i);
+            if(map) {
+                if(!filterMap.contains(id))
+                    filterMap.insert(id, true);
+                if(filterMap[id]) shown++;
+            }
+            else if(filter.check(id, true))
+                shown++;
+        }
+    }
+    QVERIFY(shown > 0);
+}
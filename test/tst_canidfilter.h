@@ -0,0 +1,21 @@
+#ifndef TST_CANIDFILTER_H
+#define TST_CANIDFILTER_H
+
+#include <QObject>
+#include <QVector>
+
+class TestCANIdFilter: public QObject
+{
+    Q_OBJECT
+private:
+    QVector<quint32> mIds;
+
+private slots:
+    void initTestCase();
+    void sameAsMap();
+    void checkAndSetAll();
+    void lookup_data();
+    void lookup();
+};
+
+#endif // TST_CANIDFILTER_H
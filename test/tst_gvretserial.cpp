@@ -0,0 +1,139 @@
+#include <QtTest>
+
+#include "gvretserial.h"
+#include "tst_gvretserial.h"
+
+
+/* feeds GVRET byte streams to the parser without a serial port */
+class GVRetReplay : public GVRetSerial
+{
+public:
+    GVRetReplay() : GVRetSerial("replay") {}
+
+    /* previous behaviour: every byte goes through the state machine */
+    void replayBytewise(const QByteArray& pChunk) {
+        for(int i=0 ; i<pChunk.length() ; i++)
+            procRXChar(pChunk.at(i));
+    }
+
+    void replayBlock(const QByteArray& pChunk) {
+        procRXData(pChunk.constData(), pChunk.length());
+    }
+
+    void drain(QVector<CANFrame>* pFrames_p) {
+        LFQueue<CANFrame>& queue = getQueue();
+        CANFrame* first_p;
+        int count;
+        while( (count = queue.peekBatch(first_p, queue.capacity())) > 0 ) {
+            if(pFrames_p)
+                for(int i=0 ; i<count ; i++)
+                    pFrames_p->append(first_p[i]);
+            queue.dequeueBatch(count);
+        }
+    }
+};
+
+
+/*
+ * Builds a stream looking like a recorded GVRET capture: frame records of every length
+ * on both buses, standard and extended ids, a few command replies and line noise,
+ * cut into reads of random size so that records straddle read boundaries.
+ */
+void TestGVRetSerial::initTestCase()
+{
+    QByteArray stream;
+    quint32 seed = 12345;
+    auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7FFF; };
+    quint32 timestamp = 0;
+
+    for(int i=0 ; i<100000 ; i++) {
+        int kind = rnd() % 100;
+
+        if(kind == 0) {
+            /* validation reply */
+            stream.append((char) 0xF1);
+            stream.append((char) 0x09);
+            continue;
+        }
+        if(kind == 1) {
+            /* noise */
+            stream.append((char) (rnd() & 0x7F));
+            continue;
+        }
+
+        quint32 id = (kind & 1) ? ((rnd() << 14 | rnd()) & 0x1FFFFFFF) | (1u << 31) : rnd() & 0x7FF;
+        int len = rnd() % 9;
+        timestamp += rnd() % 500;
+
+        stream.append((char) 0xF1);
+        stream.append((char) 0x00);
+        for(int b=0 ; b<4 ; b++)
+            stream.append((char) (timestamp >> (8*b)));
+        for(int b=0 ; b<4 ; b++)
+            stream.append((char) (id >> (8*b)));
+        stream.append((char) (len | ((rnd() & 1) << 4)));
+        for(int b=0 ; b<len ; b++)
+            stream.append((char) rnd());
+        stream.append((char) 0);
+    }
+
+    mStream.clear();
+    for(int pos=0 ; pos<stream.length() ; ) {
+        int size = 1 + rnd() % 4096;
+        mStream.append(stream.mid(pos, size));
+        pos += size;
+    }
+}
+
+
+void TestGVRetSerial::blockParser()
+{
+    GVRetReplay bytewise;
+    GVRetReplay block;
+    QVector<CANFrame> expected;
+    QVector<CANFrame> frames;
+
+    foreach(const QByteArray& chunk, mStream) {
+        bytewise.replayBytewise(chunk);
+        bytewise.drain(&expected);
+        block.replayBlock(chunk);
+        block.drain(&frames);
+    }
+
+    QVERIFY(expected.count() > 90000);
+    QCOMPARE(frames.count(), expected.count());
+    for(int i=0 ; i<frames.count() ; i++) {
+        QCOMPARE(frames[i].ID, expected[i].ID);
+        QCOMPARE(frames[i].extended, expected[i].extended);
+        QCOMPARE(frames[i].bus, expected[i].bus);
+        QCOMPARE(frames[i].len, expected[i].len);
+        QCOMPARE(frames[i].timestamp, expected[i].timestamp);
+        QVERIFY(!memcmp(frames[i].data, expected[i].data, frames[i].len));
+    }
+}
+
+
+void TestGVRetSerial::parserThroughput_data()
+{
+    QTest::addColumn<bool>("block");
+
+    QTest::newRow("bytewise")   << false;
+    QTest::newRow("block")      << true;
+}
+
+
+void TestGVRetSerial::parserThroughput()
+{
+    QFETCH(bool, block);
+    GVRetReplay parser;
+
+    QBENCHMARK {
+        foreach(const QByteArray& chunk, mStream) {
+            if(block)
+                parser.replayBlock(chunk);
+            else
+                parser.replayBytewise(chunk);
+            parser.drain(NULL);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef TST_GVRETSERIAL_H
+#define TST_GVRETSERIAL_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+
+class TestGVRetSerial: public QObject
+{
+    Q_OBJECT
+private:
+    QList<QByteArray> mStream;
+
+private slots:
+    void initTestCase();
+    void blockParser();
+    void parserThroughput_data();
+    void parserThroughput();
+};
+
+#endif // TST_GVRETSERIAL_H
@@ -3,6 +3,7 @@
 #include <QtConcurrent/qtconcurrentrun.h>
 
 #include "utils/lfqueue.h"
+#include "can_structs.h"
 #include "tst_lfqueue.h"
 
 
@@ -83,3 +84,239 @@ void TestLFQueue::exchange()
 
     thread.waitForFinished();
 }
+
+
+void batchReaderThread(LFQueue<int>* pQueue_p, int pSize, int pBatch) {
+    int* first_p;
+    int  expected = 0;
+
+    while(expected < pSize) {
+        int n = pQueue_p->peekBatch(first_p, pBatch);
+        for(int i=0 ; i<n ; i++)
+            QCOMPARE(first_p[i], expected++);
+        if(n)
+            pQueue_p->dequeueBatch(n);
+    }
+}
+
+
+void TestLFQueue::batchExchange_data()
+{
+    QTest::addColumn<int>("queueSize");
+    QTest::addColumn<int>("batch");
+
+    /* queue sizes are rounded up to the next power of two */
+    QTest::newRow("tiny")       << 3     << 2;
+    QTest::newRow("wrap")       << 100   << 48;
+    QTest::newRow("large")      << 4000  << 256;
+}
+
+
+void TestLFQueue::batchExchange()
+{
+    LFQueue<int> queue;
+    QFETCH(int, queueSize);
+    QFETCH(int, batch);
+    const int size = 100000;
+
+    QVERIFY(queue.setSize(queueSize));
+    QVERIFY(queue.capacity() >= queueSize);
+    QCOMPARE(queue.capacity() & (queue.capacity()-1), 0);
+
+    QFuture<void> thread = QtConcurrent::run(batchReaderThread, &queue, size, batch);
+
+    int i = 0;
+    while(i < size) {
+        int* first_p;
+        int n = queue.reserve(first_p, qMin(batch, size-i));
+        for(int j=0 ; j<n ; j++)
+            first_p[j] = i++;
+        if(n)
+            queue.commit(n);
+    }
+
+    thread.waitForFinished();
+    QCOMPARE(queue.count(), 0);
+}
+
+
+/* consumer used by the throughput benchmark: mimics CANConManager::refreshConnection */
+void frameReaderThread(LFQueue<CANFrame>* pQueue_p, int pSize, bool pBatch) {
+    QVector<CANFrame> frames;
+    frames.reserve(pSize);
+
+    while(frames.count() < pSize) {
+        if(pBatch) {
+            CANFrame* first_p;
+            int n = pQueue_p->peekBatch(first_p, 256);
+            if(n) {
+                for(int i=0 ; i<n ; i++)
+                    frames.append(first_p[i]);
+                pQueue_p->dequeueBatch(n);
+            }
+        }
+        else {
+            CANFrame* frame_p = pQueue_p->peek();
+            if(frame_p) {
+                frames.append(*frame_p);
+                pQueue_p->dequeue();
+            }
+        }
+    }
+}
+
+
+void TestLFQueue::throughput_data()
+{
+    QTest::addColumn<bool>("batch");
+
+    QTest::newRow("single")     << false;
+    QTest::newRow("batch")      << true;
+}
+
+
+void TestLFQueue::throughput()
+{
+    QFETCH(bool, batch);
+    const int size = 1000000;
+
+    LFQueue<CANFrame> queue;
+    QVERIFY(queue.setSize(4096));
+
+    CANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.len = 8;
+
+    QBENCHMARK {
+        queue.flush();
+        QFuture<void> thread = QtConcurrent::run(frameReaderThread, &queue, size, batch);
+
+        int i = 0;
+        while(i < size) {
+            if(batch) {
+                CANFrame* first_p;
+                int n = queue.reserve(first_p, qMin(256, size-i));
+                for(int j=0 ; j<n ; j++) {
+                    frame.ID = i++;
+                    first_p[j] = frame;
+                }
+                if(n)
+                    queue.commit(n);
+            }
+            else {
+                CANFrame* frame_p = queue.get();
+                if(frame_p) {
+                    frame.ID = i++;
+                    *frame_p = frame;
+                    queue.queue();
+                }
+            }
+        }
+
+        thread.waitForFinished();
+    }
+}
+
+
+void TestLFQueue::grow()
+{
+    LFQueue<int> queue;
+    QVERIFY(queue.setSize(4));
+
+    /* growing is disabled until a maximum size is set */
+    QVERIFY(!queue.grow());
+    queue.setMaxSize(4+8+16);
+
+    int* val_p;
+    int i = 0;
+    while(i < 28) {
+        val_p = queue.get();
+        if(!val_p) {
+            QVERIFY(queue.grow());
+            val_p = queue.get();
+        }
+        QVERIFY(val_p);
+        *val_p = i++;
+        queue.queue();
+    }
+
+    /* memory cap reached */
+    QVERIFY(!queue.get());
+    QVERIFY(!queue.grow());
+    QCOMPARE(queue.capacity(), 28);
+
+    /* elements come out in order across rings, old rings are released */
+    for(i=0 ; i<28 ; i++) {
+        val_p = queue.peek();
+        QVERIFY(val_p);
+        QCOMPARE(*val_p, i);
+        QVERIFY(queue.dequeue());
+    }
+    QVERIFY(!queue.peek());
+    QCOMPARE(queue.capacity(), 16);
+    QCOMPARE(queue.highWaterMark(), 28);
+}
+
+
+void TestLFQueue::discard()
+{
+    LFQueue<int> queue;
+    QVERIFY(queue.setSize(4));
+    queue.setMaxSize(4+8);
+
+    /* elements in two rings */
+    int* val_p;
+    for(int i=0 ; i<10 ; i++) {
+        if( !(val_p = queue.get()) ) {
+            QVERIFY(queue.grow());
+            val_p = queue.get();
+        }
+        *val_p = i;
+        queue.queue();
+    }
+
+    QCOMPARE(queue.discard(), 10);
+    QVERIFY(!queue.peek());
+    QCOMPARE(queue.capacity(), 8);
+
+    /* the producer goes on where it was */
+    val_p = queue.get();
+    QVERIFY(val_p);
+    *val_p = 10;
+    queue.queue();
+    QCOMPARE(*queue.peek(), 10);
+    QVERIFY(queue.dequeue());
+}
+
+
+void TestLFQueue::dropOldest()
+{
+    LFQueue<int> queue;
+    QVERIFY(queue.setSize(4));
+
+    int* val_p;
+    for(int i=0 ; i<6 ; i++) {
+        while( !(val_p = queue.get()) )
+            QVERIFY(queue.dropOldest());
+        *val_p = i;
+        queue.queue();
+    }
+
+    /* the two oldest elements are gone */
+    for(int i=2 ; i<6 ; i++) {
+        val_p = queue.peek();
+        QVERIFY(val_p);
+        QCOMPARE(*val_p, i);
+        QVERIFY(queue.dequeue());
+    }
+    QVERIFY(!queue.dropOldest());
+
+    /* an element dropped between peek and dequeue is reported */
+    val_p = queue.get();
+    *val_p = 6;
+    queue.queue();
+    QVERIFY(queue.peek());
+    QVERIFY(queue.dropOldest());
+    QVERIFY(!queue.dequeue());
+    QVERIFY(!queue.peek());
+}
@@ -13,6 +13,13 @@ private slots:
     void setSize();
     void exchange_data();
     void exchange();
+    void batchExchange_data();
+    void batchExchange();
+    void throughput_data();
+    void throughput();
+    void grow();
+    void dropOldest();
+    void discard();
 };
 
 #endif // TST_LFQUEUE_H
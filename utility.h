@@ -93,6 +93,36 @@ public:
         else return formatHexNum(value);
     }
 
+    //payload bytes as formatNumber() prints them, each followed by a space.
+    //Built from a lookup table into a single buffer, this runs for every row of the main table.
+    static QString formatBytes(const unsigned char *data, int len)
+    {
+        static const char hexDigits[] = "0123456789ABCDEF";
+        QChar buffer[8 * 5];
+        int pos = 0;
+
+        if (len > 8) len = 8;
+        for (int i = 0; i < len; i++)
+        {
+            unsigned char value = data[i];
+            if (decimalMode)
+            {
+                if (value >= 100) buffer[pos++] = QLatin1Char('0' + value / 100);
+                if (value >= 10) buffer[pos++] = QLatin1Char('0' + (value / 10) % 10);
+                buffer[pos++] = QLatin1Char('0' + value % 10);
+            }
+            else
+            {
+                buffer[pos++] = QLatin1Char('0');
+                buffer[pos++] = QLatin1Char('x');
+                buffer[pos++] = QLatin1Char(hexDigits[value >> 4]);
+                buffer[pos++] = QLatin1Char(hexDigits[value & 0xF]);
+            }
+            buffer[pos++] = QLatin1Char(' ');
+        }
+        return QString(buffer, pos);
+    }
+
     static QString formatByteAsBinary(uint8_t value)
     {
         QString output;
@@ -1,91 +1,456 @@
 #ifndef LFQUEUE_H
 #define LFQUEUE_H
 
+#include <new>
 #include <QObject>
 #include <QDebug>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
 
 
-/* macros */
-#define IS_EMPTY()  (  mWIdx.load()             == mRIdx.load() )
-#define IS_FULL()   ( (mWIdx.load()+1)%mSize    == mRIdx.load() )
+/* size of a cache line, used to keep producer and consumer indices apart */
+#define LFQUEUE_CACHELINE   64
 
 
+/**
+ * Single producer / single consumer lock free queue.
+ *
+ * Capacity is always a power of two so that slots can be addressed with a mask.
+ * Read and write indices are free running counters (they wrap naturally at 2^32),
+ * the fill level is simply mWIdx - mRIdx.
+ * Each side keeps a private copy of the other side's index and only reloads it
+ * when that copy says the queue is full (producer) or empty (consumer), so in
+ * steady state producer and consumer don't touch each other's cache line.
+ *
+ * Overflow handling (both are producer side and are exclusive):
+ * - @ref grow links a ring twice as big after the current one. The producer
+ *   moves on to it immediately, the consumer switches once the old ring is drained.
+ * - @ref dropOldest discards the oldest queued element. The consumer commits
+ *   its reads with a CAS so it can tell which of the elements it copied have
+ *   been dropped (and possibly overwritten) meanwhile.
+ */
 template<class T>
 class LFQueue
 {
 public:
-    LFQueue() : mSize(0), mArray(NULL){}
+    LFQueue() : mReadRing_p(NULL), mPeekIdx(0), mWriteRing_p(NULL), mMaxSize(0) {}
 
     ~LFQueue() {setSize(0);}
 
+    /**
+     * @brief setSize
+     * @param size: requested number of slots, rounded up to the next power of two
+     * @return false if size is invalid or allocation failed
+     * @note must not be called while producer or consumer are running
+     */
     bool setSize(int size) {
         if(size<0)
             return false;
 
-        if(mArray) {
-            delete[] mArray;
-            mArray = NULL;
+        while(mReadRing_p) {
+            Ring* next_p = mReadRing_p->mNext_p.load();
+            delete mReadRing_p;
+            mReadRing_p = next_p;
         }
+        mWriteRing_p = NULL;
+        mCapacity.store(0);
+        mHighWater.store(0);
+        mPeekIdx = 0;
 
         if(size>0) {
-            mArray = new T[size];
-            if(mArray)
-                mSize = size;
-            return ( mArray!=NULL );
+            quint32 pow2 = 1;
+            while(pow2 < (quint32) size)
+                pow2 <<= 1;
+
+            Ring* ring_p = allocRing(pow2);
+            if(!ring_p)
+                return false;
+
+            mReadRing_p = mWriteRing_p = ring_p;
+            mCapacity.store(pow2);
         }
 
         return true;
     }
 
+    /**
+     * @brief setMaxSize
+     * @param size: the total number of slots @ref grow may allocate (0 disables growing)
+     */
+    void setMaxSize(int size) {
+        mMaxSize = (size > 0) ? size : 0;
+    }
+
+    /**
+     * @brief capacity
+     * @return the number of slots currently allocated
+     */
+    int capacity() const {
+        return mCapacity.load();
+    }
+
+    /**
+     * @brief count
+     * @return the number of queued elements
+     * @note consumer side
+     */
+    int count() const {
+        quint32 depth = 0;
+        for(Ring* ring_p = mReadRing_p ; ring_p ; ring_p = ring_p->mNext_p.loadAcquire())
+            depth += ring_p->mWIdx.loadAcquire() - ring_p->mRIdx.loadAcquire();
+        return (int) depth;
+    }
+
+    /**
+     * @brief highWaterMark
+     * @return the highest fill level seen by the consumer since the last reset
+     */
+    int highWaterMark() const {
+        return mHighWater.load();
+    }
+
+    void resetHighWaterMark() {
+        mHighWater.store(0);
+    }
+
+    /**
+     * @brief flush
+     * @note called by the producer while the consumer is not accessing the queue
+     */
     void flush() {
-        mRIdx.store(0);
-        mWIdx.store(0);
+        while( mReadRing_p && (mReadRing_p != mWriteRing_p) ) {
+            Ring* next_p = mReadRing_p->mNext_p.load();
+            mCapacity.fetchAndAddRelaxed(-(int) mReadRing_p->mSize);
+            delete mReadRing_p;
+            mReadRing_p = next_p;
+        }
+
+        if(mWriteRing_p)
+            mWriteRing_p->reset();
+        mPeekIdx = 0;
     }
 
+    /**************************************************************/
+    /***********            producer side                   *******/
+    /**************************************************************/
+
     T* get() {
-        if(IS_FULL())
+        Ring* ring_p = mWriteRing_p;
+        if(!ring_p)
             return NULL;
 
-        return &(mArray[mWIdx.loadAcquire()]); /* prevent memory reordering (belt and braces) */
+        quint32 wIdx = ring_p->mWIdx.load();
+
+        if( (wIdx - ring_p->mRCache) == ring_p->mSize ) {
+            ring_p->mRCache = ring_p->mRIdx.loadAcquire();
+            if( (wIdx - ring_p->mRCache) == ring_p->mSize )
+                return NULL;
+        }
+
+        return &(ring_p->mArray[wIdx & ring_p->mMask]);
     }
 
 
     void queue() {
+        Ring* ring_p = mWriteRing_p;
+
         #ifdef QT_DEBUG
-        if(IS_FULL())
+        if( (ring_p->mWIdx.load() - ring_p->mRIdx.load()) >= ring_p->mSize )
             qCritical() << "BUG: queueing in full queue";
         #endif
 
-        int wIdx = mWIdx.load();
-        mWIdx.storeRelease((wIdx+1)%mSize);
+        ring_p->mWIdx.storeRelease(ring_p->mWIdx.load()+1);
     }
 
 
-    T* peek() {
-        if(IS_EMPTY())
+    /**
+     * @brief reserve up to pMax contiguous free slots
+     * @param pFirst_p: set to the first reserved slot
+     * @param pMax: the maximum number of slots wanted
+     * @return the number of contiguous slots available (may be less than pMax, 0 if queue is full)
+     * @note slots are only visible to the consumer once @ref commit has been called
+     */
+    int reserve(T*& pFirst_p, int pMax) {
+        Ring* ring_p = mWriteRing_p;
+        if(!ring_p)
+            return 0;
+
+        quint32 wIdx = ring_p->mWIdx.load();
+        quint32 avail = ring_p->mSize - (wIdx - ring_p->mRCache);
+
+        if( avail < (quint32) pMax ) {
+            ring_p->mRCache = ring_p->mRIdx.loadAcquire();
+            avail = ring_p->mSize - (wIdx - ring_p->mRCache);
+        }
+
+        /* do not wrap around the end of the array */
+        quint32 contiguous = ring_p->mSize - (wIdx & ring_p->mMask);
+        if( avail > contiguous )
+            avail = contiguous;
+        if( avail > (quint32) pMax )
+            avail = pMax;
+
+        pFirst_p = &(ring_p->mArray[wIdx & ring_p->mMask]);
+        return (int) avail;
+    }
+
+
+    /**
+     * @brief publish pCount slots previously obtained with @ref reserve
+     */
+    void commit(int pCount) {
+        Ring* ring_p = mWriteRing_p;
+
+        #ifdef QT_DEBUG
+        if( (ring_p->mWIdx.load() + pCount - ring_p->mRIdx.load()) > ring_p->mSize )
+            qCritical() << "BUG: committing more slots than reserved";
+        #endif
+
+        ring_p->mWIdx.storeRelease(ring_p->mWIdx.load()+pCount);
+    }
+
+
+    /**
+     * @brief producerCount
+     * @return the number of elements queued in the ring the producer writes to
+     * @note producer side, loads the consumer index so don't call it per element
+     */
+    int producerCount() {
+        Ring* ring_p = mWriteRing_p;
+        if(!ring_p)
+            return 0;
+
+        ring_p->mRCache = ring_p->mRIdx.loadAcquire();
+        return (int) (ring_p->mWIdx.load() - ring_p->mRCache);
+    }
+
+
+    /**
+     * @brief grow the queue by linking a ring twice as big as the current one
+     * @return false if the growth would exceed the size set with @ref setMaxSize or allocation failed
+     */
+    bool grow() {
+        Ring* ring_p = mWriteRing_p;
+        if(!ring_p)
+            return false;
+
+        quint32 newSize = ring_p->mSize * 2;
+        if( (quint32) mCapacity.load() + newSize > mMaxSize )
+            return false;
+
+        Ring* next_p = allocRing(newSize);
+        if(!next_p)
+            return false;
+
+        mCapacity.fetchAndAddRelaxed(newSize);
+        /* we never write to ring_p again, consumer will free it once drained */
+        ring_p->mNext_p.storeRelease(next_p);
+        mWriteRing_p = next_p;
+
+        return true;
+    }
+
+
+    /**
+     * @brief drop the oldest queued element to make room for a new one
+     * @return the dropped element (valid until the next write to the queue) or NULL if nothing was dropped
+     * @note when NULL is returned, the consumer may have made room meanwhile, so @ref get should be retried
+     */
+    T* dropOldest() {
+        Ring* ring_p = mWriteRing_p;
+        if(!ring_p)
+            return NULL;
+
+        quint32 rIdx = ring_p->mRIdx.loadAcquire();
+        if( rIdx == ring_p->mWIdx.load() )
             return NULL;
 
-        return &(mArray[mRIdx.loadAcquire()]); /* prevent memory reordering (belt and braces) */
+        if( !ring_p->mRIdx.testAndSetOrdered(rIdx, rIdx+1) )
+            return NULL;
+
+        ring_p->mRCache = rIdx+1;
+        return &(ring_p->mArray[rIdx & ring_p->mMask]);
+    }
+
+
+    /**************************************************************/
+    /***********            consumer side                   *******/
+    /**************************************************************/
+
+    T* peek() {
+        T* first_p;
+        return peekBatch(first_p, 1) ? first_p : NULL;
+    }
+
+
+    /**
+     * @brief dequeue the element returned by the last call to @ref peek
+     * @return false if the element has been dropped by the producer meanwhile (its copy must be discarded)
+     */
+    bool dequeue() {
+        return (dequeueBatch(1) == 0);
+    }
+
+
+    /**
+     * @brief get up to pMax contiguous queued elements
+     * @param pFirst_p: set to the first queued element
+     * @param pMax: the maximum number of elements wanted
+     * @return the number of contiguous elements available (0 if queue is empty)
+     * @note elements stay valid until @ref dequeueBatch is called
+     */
+    int peekBatch(T*& pFirst_p, int pMax) {
+        Ring* ring_p = mReadRing_p;
+        if(!ring_p)
+            return 0;
+
+        /* acquire: the producer moves mRIdx itself when dropping the oldest elements */
+        quint32 rIdx = ring_p->mRIdx.loadAcquire();
+        quint32 avail = ring_p->mWCache - rIdx;
+
+        if( (qint32) avail < pMax ) {
+            /* load next first: once it is published, mWIdx of this ring is final */
+            Ring* next_p = ring_p->mNext_p.loadAcquire();
+            ring_p->mWCache = ring_p->mWIdx.loadAcquire();
+            avail = ring_p->mWCache - rIdx;
+
+            if( (avail == 0) && next_p ) {
+                /* this ring is drained and the producer moved on */
+                mReadRing_p = next_p;
+                mCapacity.fetchAndAddRelaxed(-(int) ring_p->mSize);
+                delete ring_p;
+                return peekBatch(pFirst_p, pMax);
+            }
+
+            /* track high water mark once per refill */
+            int depth = count();
+            if( depth > mHighWater.load() )
+                mHighWater.store(depth);
+        }
+
+        /* do not wrap around the end of the array */
+        quint32 contiguous = ring_p->mSize - (rIdx & ring_p->mMask);
+        if( avail > contiguous )
+            avail = contiguous;
+        if( avail > (quint32) pMax )
+            avail = pMax;
+
+        mPeekIdx = rIdx;
+        pFirst_p = &(ring_p->mArray[rIdx & ring_p->mMask]);
+        return (int) avail;
+    }
+
+
+    /**
+     * @brief drop all queued elements
+     * @return the number of elements dropped
+     * @note consumer side counterpart of @ref flush, the producer may keep running
+     */
+    int discard() {
+        T* first_p;
+        int count;
+        int total = 0;
+        while( (count = peekBatch(first_p, capacity())) > 0 ) {
+            dequeueBatch(count);
+            total += count;
+        }
+        return total;
     }
 
 
-    void dequeue() {
+    /**
+     * @brief release pCount elements previously obtained with @ref peekBatch
+     * @return the number of elements at the beginning of the batch that were dropped
+     * by the producer meanwhile (their copies must be discarded), 0 in the usual case
+     */
+    int dequeueBatch(int pCount) {
+        Ring* ring_p = mReadRing_p;
+        quint32 rIdx = mPeekIdx;
+        quint32 current;
+
         #ifdef QT_DEBUG
-        if(IS_EMPTY())
-            qCritical() << "BUG: dequeueing an empty queue";
+        if( (quint32) pCount > (ring_p->mWIdx.load() - mPeekIdx) )
+            qCritical() << "BUG: dequeueing more elements than queued";
         #endif
 
-        int rIdx = mRIdx.load();
-        mRIdx.storeRelease((rIdx+1)%mSize);
+        while( !ring_p->mRIdx.testAndSetOrdered(rIdx, mPeekIdx + pCount, current) ) {
+            /* the producer dropped elements under our feet */
+            if( (qint32) (current - mPeekIdx) >= pCount ) {
+                mPeekIdx = current;
+                return pCount;
+            }
+            rIdx = current;
+        }
+
+        int dropped = (int) (rIdx - mPeekIdx);
+        mPeekIdx += pCount;
+        return dropped;
     }
 
 
 private:
-    int mSize;
-    T*  mArray;
+    struct Ring
+    {
+        Ring(quint32 pSize) :
+            mSize(pSize),
+            mMask(pSize - 1),
+            mArray(new (std::nothrow) T[pSize]),
+            mWCache(0),
+            mRCache(0),
+            mNext_p(NULL) {}
+
+        ~Ring() { delete[] mArray; }
+
+        void reset() {
+            mRIdx.store(0);
+            mWIdx.store(0);
+            mWCache = 0;
+            mRCache = 0;
+        }
+
+        /* read only once allocated */
+        const quint32   mSize;
+        const quint32   mMask;
+        T* const        mArray;
+
+        char    mPad0[LFQUEUE_CACHELINE];
+
+        /* consumer cache line */
+        QAtomicInteger<quint32> mRIdx;
+        quint32                 mWCache; /* consumer copy of mWIdx */
+        char    mPad1[LFQUEUE_CACHELINE - sizeof(QAtomicInteger<quint32>) - sizeof(quint32)];
+
+        /* producer cache line */
+        QAtomicInteger<quint32> mWIdx;
+        quint32                 mRCache; /* producer copy of mRIdx */
+        char    mPad2[LFQUEUE_CACHELINE - sizeof(QAtomicInteger<quint32>) - sizeof(quint32)];
+
+        /* set by the producer when it moves to a bigger ring */
+        QAtomicPointer<Ring>    mNext_p;
+    };
+
+    static Ring* allocRing(quint32 pSize) {
+        Ring* ring_p = new (std::nothrow) Ring(pSize);
+        if( ring_p && !ring_p->mArray ) {
+            delete ring_p;
+            ring_p = NULL;
+        }
+        return ring_p;
+    }
+
+    /* consumer owned */
+    Ring*       mReadRing_p;
+    quint32     mPeekIdx;
+    char        mPad0[LFQUEUE_CACHELINE];
+
+    /* producer owned */
+    Ring*       mWriteRing_p;
+    quint32     mMaxSize;
+    char        mPad1[LFQUEUE_CACHELINE];
 
-    QAtomicInt mRIdx;
-    QAtomicInt mWIdx;
+    /* statistics */
+    QAtomicInt  mCapacity;
+    QAtomicInt  mHighWater;
 };
 
 #endif // LFQUEUE_H